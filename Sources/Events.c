@@ -31,10 +31,15 @@ extern "C" {
 /* User includes (#include below this line is not maintained by Processor Expert) */
 #include "ipc_i2c.h"
 #include "boot.h"
+#include "flash.h"
+#include "ext_flash.h"
+#include "trace.h"
+#include "perf.h"
 
 /*! i2cCom1 IRQ handler */
 void i2cCom1_IRQHandler(void)
 {
+  PERF_COUNT(PERF_I2C_IRQS, 1);
   I2C_DRV_IRQHandler(FSL_I2CCOM1);
 }
 
@@ -44,7 +49,8 @@ void i2cCom1_Callback0(uint8_t instance,i2c_slave_event_t slaveEvent,void *userD
 	i2cCom1_Handler(slaveEvent);
 }
 
-void flash1_Callback(void)
+/*! called from FlashCommandSequence while flash is busy, so must run from RAM */
+RAMFUNC void flash1_Callback(void)
 {
     /* Write your code here ... */
 }
@@ -59,10 +65,17 @@ void SPI0_IRQHandler(void)
   /* Write your code here ... */
 }
 
+/*! SPI1 IRQ handler, the external staging flash (EXT_init) */
+void SPI1_IRQHandler(void)
+{
+  SPI_DRV_IRQHandler(EXT_STAGING);
+}
+
 void lpuartUblox_RxCallback(uint32_t instance, void * lpuartState)
 {
     lpuart_state_t * ptr =  (lpuart_state_t *)lpuartState;
     RING_push(&ublox_ring, *(ptr->rxBuff));
+    TRACE_byte(TRACE_UART_RX, *(ptr->rxBuff));
 }
 
 /* END Events */
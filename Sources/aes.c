@@ -0,0 +1,145 @@
+/*
+  aes.c - AES-128 counter mode for encrypted images
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "aes.h"
+
+#include <string.h>
+
+//Encryption only, which is all counter mode needs.  The M0+ has no data
+//cache, so a byte S-box held in SRAM (not flash, which sits behind the
+//flash controller's cache) is looked up in constant time; no T-tables.
+static uint8_t sbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16,
+};
+
+static uint8_t xtime(uint8_t x)
+{
+    //multiply by x in GF(2^8) without a data dependent branch
+    return (x << 1) ^ (0x1B & -(x >> 7));
+}
+
+void AES_init(aes_t *ctx, const uint8_t *key)
+{
+    uint8_t *rk = ctx->round_key;
+    uint8_t rcon = 1;
+
+    memcpy(rk, key, AES_KEY_SIZE);
+    for(uint32_t i = AES_KEY_SIZE; i < sizeof(ctx->round_key); i += 4)
+    {
+        uint8_t t0 = rk[i-4], t1 = rk[i-3], t2 = rk[i-2], t3 = rk[i-1];
+        if((i & (AES_KEY_SIZE - 1)) == 0)
+        {
+            uint8_t t = t0;
+            t0 = sbox[t1] ^ rcon;
+            t1 = sbox[t2];
+            t2 = sbox[t3];
+            t3 = sbox[t];
+            rcon = xtime(rcon);
+        }
+        rk[i+0] = rk[i-16] ^ t0;
+        rk[i+1] = rk[i-15] ^ t1;
+        rk[i+2] = rk[i-14] ^ t2;
+        rk[i+3] = rk[i-13] ^ t3;
+    }
+}
+
+void AES_encrypt(const aes_t *ctx, const uint8_t *in, uint8_t *out)
+{
+    const uint8_t *rk = ctx->round_key;
+    uint8_t s[AES_BLOCK_SIZE];
+    uint8_t t[AES_BLOCK_SIZE];
+    uint32_t i, round;
+
+    for(i = 0; i < AES_BLOCK_SIZE; i++)
+        s[i] = in[i] ^ rk[i];
+
+    for(round = 1; round <= AES_ROUNDS; round++)
+    {
+        rk += AES_BLOCK_SIZE;
+
+        //SubBytes and ShiftRows together, state is column major
+        for(i = 0; i < AES_BLOCK_SIZE; i++)
+            t[i] = sbox[s[(i + 4 * (i & 3)) & 15]];
+
+        if(round == AES_ROUNDS)
+        {
+            for(i = 0; i < AES_BLOCK_SIZE; i++)
+                out[i] = t[i] ^ rk[i];
+            break;
+        }
+
+        //MixColumns and AddRoundKey
+        for(i = 0; i < AES_BLOCK_SIZE; i += 4)
+        {
+            uint8_t a0 = t[i], a1 = t[i+1], a2 = t[i+2], a3 = t[i+3];
+            uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+            s[i+0] = a0 ^ all ^ xtime(a0 ^ a1) ^ rk[i+0];
+            s[i+1] = a1 ^ all ^ xtime(a1 ^ a2) ^ rk[i+1];
+            s[i+2] = a2 ^ all ^ xtime(a2 ^ a3) ^ rk[i+2];
+            s[i+3] = a3 ^ all ^ xtime(a3 ^ a0) ^ rk[i+3];
+        }
+    }
+}
+
+//XOR data with the keystream for image byte offset pos; the counter
+//block is nonce || big endian (counter_hi | pos / 16)
+void AES_ctr(const aes_t *ctx, const uint8_t *nonce, uint32_t counter_hi, uint32_t pos, uint8_t *data, uint32_t size)
+{
+    uint8_t block[AES_BLOCK_SIZE];
+    uint8_t stream[AES_BLOCK_SIZE];
+
+    memcpy(block, nonce, AES_NONCE_SIZE);
+    while(size)
+    {
+        uint32_t counter = counter_hi | (pos / AES_BLOCK_SIZE);
+        uint32_t offset = pos & (AES_BLOCK_SIZE - 1);
+        uint32_t len = AES_BLOCK_SIZE - offset;
+
+        block[12] = counter >> 24;
+        block[13] = counter >> 16;
+        block[14] = counter >> 8;
+        block[15] = counter;
+        AES_encrypt(ctx, block, stream);
+
+        if(len > size)
+            len = size;
+        for(uint32_t i = 0; i < len; i++)
+            *data++ ^= stream[offset + i];
+        pos += len;
+        size -= len;
+    }
+}
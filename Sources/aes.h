@@ -0,0 +1,42 @@
+/*
+  aes.h - AES-128 counter mode for encrypted images
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_AES_H_
+#define SOURCES_AES_H_
+
+#include <stdint.h>
+
+#define AES_KEY_SIZE    (16)
+#define AES_BLOCK_SIZE  (16)
+#define AES_NONCE_SIZE  (12)
+#define AES_ROUNDS      (10)
+
+typedef struct
+{
+    uint8_t round_key[(AES_ROUNDS + 1) * AES_BLOCK_SIZE];
+}aes_t;
+
+void AES_init(aes_t *ctx, const uint8_t *key);
+void AES_encrypt(const aes_t *ctx, const uint8_t *in, uint8_t *out);
+void AES_ctr(const aes_t *ctx, const uint8_t *nonce, uint32_t counter_hi, uint32_t pos, uint8_t *data, uint32_t size);
+
+#endif /* SOURCES_AES_H_ */
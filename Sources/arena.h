@@ -0,0 +1,41 @@
+/*
+  arena.h - mode overlay placement for static buffers
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_ARENA_H_
+#define SOURCES_ARENA_H_
+
+#include "periph.h"
+
+//A boot either applies the flag update (or runs a factory session) or runs the
+//I2C command loop, never both, so buffers used by only one of them are overlaid
+//by the linker (.arena_* in dash_system_boot.ld). Uninitialized only: startup
+//does not clear the arena and the other mode may have left anything in it.
+#define ARENA_UPDATE        __attribute__((section(".bss.arena_update")))
+#define ARENA_I2C           __attribute__((section(".bss.arena_i2c")))
+
+//The peripherals that fill each arena from interrupts. PERIPH_init won't
+//bring up one mode's while the other's are up (test/test_periph.c).
+#define ARENA_UPDATE_UNITS  (PERIPH_UBLOX)
+#define ARENA_I2C_UNITS     (PERIPH_I2C)
+#define ARENA_OVERLAP(units) (((units) & ARENA_UPDATE_UNITS) && ((units) & ARENA_I2C_UNITS))
+
+#endif /* SOURCES_ARENA_H_ */
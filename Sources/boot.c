@@ -21,7 +21,7 @@
 */
 
 #include <string.h>
-#include <stdio.h>
+#include <stdlib.h>
 #include "Cpu.h"
 #include "boot.h"
 #include "spiComEZPort.h"
@@ -29,15 +29,48 @@
 #include "ext_flash.h"
 #include "gpio1.h"
 #include "lpuartUblox.h"
-
-#define BOOT_FLAG_ADDRESS (SYSTEM_APP_ADDRESS - FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE)
-#define BOOT_FLAG_ERASED (0xFFFFFFFF)
-
-#define USER_WRITE_SIZE (16)
-#define USER_SECTOR_SIZE (4096)
+#include "crc.h"
+#include "stage.h"
+#include "sha256.h"
+#include "ed25519.h"
+#include "aes.h"
+#include "osa_timer.h"
+#include "perf.h"
+#include "trace.h"
+#include "arena.h"
+#include "periph.h"
+
+#define USER_WRITE_SIZE (EXT_EZPORT_WRITE_SIZE)
 #define UBLOX_READ_SIZE (32)
+#define UBLOX_READ_MAX (512)
+#define UBLOX_GROW_AFTER (4)
+#define UBLOX_READ_RETRIES (6)
+#define UBLOX_RETRY_DELAY_MS (10)
+
+#define UBLOX_PROBE_MIN_MS (50)
+#define UBLOX_PROBE_MAX_MS (800)
+#define UBLOX_RESET_AFTER_MS (8000)
+#define UBLOX_CONNECT_MS    (30000)
+#define UBLOX_RING_HIGH     (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE*3/2)
+#define UBLOX_RING_LOW      (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE/2)
+#define UBLOX_TX_SIZE       (320)
+#define XON                 (0x11)
+#define XOFF                (0x13)
+#define UBLOX_SOCKET_WAIT_MS (10000)
+#define HTTP_HEADER_MAX     (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE)
+
+#define BOOT_FRAME_PAYLOAD (512)
+#define BOOT_FRAME_OVERHEAD (4)
+#define BOOT_FRAME_SIZE (BOOT_FRAME_PAYLOAD + BOOT_FRAME_OVERHEAD)
 
 #define MAX(a,b) (a>b?a:b)
+#define MIN(a,b) (a<b?a:b)
+
+//#define BOOT_SIGNED_UPDATES
+//#define BOOT_ENCRYPTED_UPDATES
+
+//counter_hi for each image's AES-CTR keystream
+#define IMAGE_COUNTER(image) ((uint32_t)(image) << 28)
 
 #define UBLOX_RESET_N GPIO_MAKE_PIN(GPIOA_IDX, 1U)
 static const gpio_input_pin_user_config_t ublox_reset_input_config = {
@@ -65,103 +98,788 @@ konekt_flash_id_t __attribute__((section (".idSection"))) id __attribute__ ((ali
     "System Bootloader"
 };
 
-static uint8_t pgm_buffer[MAX(USER_WRITE_SIZE, FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE)];
-static uint8_t lpuart_ublox_rxbuffer[FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE*2];
+static uint8_t pgm_buffer[MAX(USER_WRITE_SIZE, FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE)] ARENA_UPDATE;
+static uint8_t lpuart_ublox_rxbuffer[FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE*2] ARENA_UPDATE;
 unsigned char ublox_rx[8];
+static uint32_t transfer_mode = BOOT_FLAG_ERASED;
+static uint32_t image_source = BOOT_FLAG_ERASED;
+static char ublox_tx[UBLOX_TX_SIZE] ARENA_UPDATE;
+static int32_t http_socket = -1;
+static uint32_t http_next;              //file offset the open response delivers next
+static uint32_t clean_reads;
+static stage_t stage;
+static sha256_t sha ARENA_UPDATE;
+static boot_bundle_t bundle ARENA_UPDATE;
+static aes_t aes ARENA_UPDATE;
+static const uint8_t *image_nonce;
+
+boot_ublox_stats_t ublox_stats = {
+        .read_size = UBLOX_READ_SIZE,
+};
+
+#ifdef BOOT_SIGNED_UPDATES
+//Ed25519 key whose signature over the three image digests in the boot
+//flags authorizes an update; replace with the production key
+static const uint8_t boot_public_key[ED25519_KEY_SIZE] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+#endif
+
+#ifdef BOOT_ENCRYPTED_UPDATES
+//AES-128 key shared with the image packager; replace with the production key
+static const uint8_t boot_image_key[AES_KEY_SIZE] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+#endif
+
+static void BOOT_ublox_throttle(bool stop);
 
 ring_t ublox_ring = {
         .buffer = lpuart_ublox_rxbuffer,
         .size = FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE*2,
         .head = 0,
-        .tail = 0
+        .tail = 0,
+        .high = UBLOX_RING_HIGH,
+        .low = UBLOX_RING_LOW,
+        .throttle = BOOT_ublox_throttle
 };
 
-bool BOOT_ublox_echo_off(void)
+static char *BOOT_utoa(char *p, uint32_t value)
+{
+    //by subtraction; the M0+ has no divide instruction and the library
+    //division sprintf leans on costs more than the whole conversion
+    static const uint32_t pow10[] = {
+        1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10
+    };
+    uint32_t i = 0;
+
+    while(i < 9 && value < pow10[i])
+        i++;
+    for(; i < 9; i++)
+    {
+        char digit = '0';
+        while(value >= pow10[i])
+        {
+            value -= pow10[i];
+            digit++;
+        }
+        *p++ = digit;
+    }
+    *p++ = '0' + value;
+    return p;
+}
+
+static char *BOOT_append(char *p, const char *s, uint32_t size)
+{
+    memcpy(p, s, size);
+    return p + size;
+}
+
+#define BOOT_APPEND(p, s) BOOT_append(p, s, sizeof(s) - 1)
+
+static char *BOOT_ublox_tx(void)
+{
+    //the previous command has to be out before its buffer is rewritten
+    uint32_t remaining;
+    while(LPUART_DRV_GetTransmitStatus(FSL_LPUARTUBLOX, &remaining) == kStatus_LPUART_TxBusy) {}
+    return ublox_tx;
+}
+
+static void BOOT_ublox_send(const void *data, uint32_t size)
+{
+    //returns once the first byte is queued, leaving the interrupt to send
+    //the rest while we wait on the response; data has to stay put until
+    //the next send, which waits for this one to finish; a lone XON/XOFF
+    //can start in between, so retry until the driver takes it
+    BOOT_ublox_tx();
+    TRACE_block(TRACE_UART_TX, data, size);
+    while(LPUART_DRV_SendData(FSL_LPUARTUBLOX, data, size) == kStatus_LPUART_TxBusy) {}
+}
+
+bool BOOT_ublox_echo_off(uint32_t timeout_ms)
 {
     //ATE0\r
     //wait for
-    //u-blox
+    //OK
+    //output without the answer, a startup banner or URC, ends the wait at
+    //the next UBLOX_PROBE_MIN_MS: the modem is up and the next probe lands
+    uint32_t start = OSA_TimeGetMsec();
+    uint32_t received;
+
     RING_flush(&ublox_ring);
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, "ATE0\r", 5, 1000);
-    if(!RING_find_string(&ublox_ring, "OK", 10000)) return false;
-    return true;
+    received = ublox_ring.received;
+    BOOT_ublox_send("ATE0\r", 5);
+    do
+    {
+        if(RING_find_string(&ublox_ring, "OK", UBLOX_PROBE_MIN_MS)) return true;
+    }while(ublox_ring.received == received && OSA_TimeGetMsec() - start < timeout_ms);
+    return false;
+}
+
+static bool BOOT_ublox_command(const char *cmd, uint32_t size, uint32_t timeout_ms)
+{
+    RING_flush(&ublox_ring);
+    BOOT_ublox_send(cmd, size);
+    return RING_find_string(&ublox_ring, "OK", timeout_ms);
+}
+
+//XON/XOFF go out through the driver, between two bytes of whatever send
+//is in flight, so they neither wait behind a long block nor land in the
+//data register under it
+static volatile uint8_t ublox_flow;     //waiting for the transmitter, 0 none
+static uint8_t ublox_flow_tx;           //the one being sent
+static bool ublox_flow_out;
+static const uint8_t *ublox_resume_buff;
+static size_t ublox_resume_size;
+
+static void BOOT_ublox_tx_next(uint32_t instance, void *state)
+{
+    //the driver has just written *txBuff and calls this to advance
+    lpuart_state_t *lpuart = (lpuart_state_t *)state;
+
+    if(ublox_flow_out)
+    {
+        ublox_flow_out = false;
+        lpuart->txBuff = ublox_resume_buff;
+        lpuart->txSize = ublox_resume_size;
+    }
+    else
+    {
+        lpuart->txBuff++;
+        lpuart->txSize--;
+    }
+    if(ublox_flow)
+    {
+        ublox_flow_tx = ublox_flow;
+        ublox_flow = 0;
+        ublox_resume_buff = lpuart->txBuff;
+        ublox_resume_size = lpuart->txSize;
+        ublox_flow_out = true;
+        lpuart->txBuff = &ublox_flow_tx;
+        lpuart->txSize = 1;
+    }
+}
+
+static void BOOT_ublox_throttle(bool stop)
+{
+    //called from the receive interrupt as ublox_ring fills and from the
+    //reader, interrupts masked, as it drains; a later call replaces one
+    //still queued, as only the last state matters to the modem
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    TRACE_byte(TRACE_UART_TX, stop ? XOFF : XON);
+    if(lpuartUblox_State.isTxBusy)
+    {
+        ublox_flow = stop ? XOFF : XON;
+    }
+    else
+    {
+        ublox_flow = 0;
+        ublox_flow_tx = stop ? XOFF : XON;
+        LPUART_DRV_SendData(FSL_LPUARTUBLOX, &ublox_flow_tx, 1);
+    }
+    __set_PRIMASK(primask);
+}
+
+static void BOOT_ublox_reset(void)
+{
+    GPIO_DRV_InputPinInit(&ublox_reset_input_config);
+    GPIO_DRV_ClearPinOutput(UBLOX_RESET_N);
+    GPIO_DRV_SetPinDir(UBLOX_RESET_N, kGpioDigitalOutput);
+    OSA_TimeDelayUsec(60);
+    GPIO_DRV_SetPinDir(UBLOX_RESET_N, kGpioDigitalInput);
+}
+
+void BOOT_ublox_wait_ready(void)
+{
+    //probe with short ATE0 exchanges, backing off exponentially; any
+    //output from the modem (startup banner, URCs) cuts the probe short
+    //and restarts the schedule, so the next lands as soon as it can answer
+    uint32_t start = OSA_TimeGetMsec();
+    uint32_t last_reset = start;
+    uint32_t timeout = UBLOX_PROBE_MIN_MS;
+    uint32_t received;
+
+    PERIPH_init(PERIPH_UBLOX);
+    //before the first send, as installing resets the driver's buffer
+    LPUART_DRV_InstallTxCallback(FSL_LPUARTUBLOX, BOOT_ublox_tx_next, (uint8_t *)ublox_tx, NULL);
+    //a failed probe has already drained whatever arrived while it waited,
+    //so activity is judged by the ring's receive count, not what is left
+    for(;;)
+    {
+        received = ublox_ring.received;
+        if(BOOT_ublox_echo_off(timeout))
+            break;
+        ublox_stats.probes++;
+        if(OSA_TimeGetMsec() - last_reset >= UBLOX_RESET_AFTER_MS)
+        {
+            BOOT_ublox_reset();
+            ublox_stats.resets++;
+            last_reset = OSA_TimeGetMsec();
+            timeout = UBLOX_PROBE_MIN_MS;
+        }
+        else if(ublox_ring.received != received)
+        {
+            timeout = UBLOX_PROBE_MIN_MS;
+        }
+        else
+        {
+            BOOT_ublox_send("\x11", 1);
+            if(timeout < UBLOX_PROBE_MAX_MS)
+                timeout <<= 1;
+        }
+    }
+    ublox_stats.ready_ms = OSA_TimeGetMsec() - start;
+
+    //have the modem honour the XON/XOFF sent as ublox_ring fills
+    BOOT_ublox_command("AT+IFC=1,1\r", 11, 1000);
 }
 
 uint32_t BOOT_ReadFromUblox(const char *filename, uint32_t offset, uint8_t *buffer, uint32_t size)
 {
     //AT+URDBLOCK="<filename>",<offset>,<size>\r
     //wait for
-    //+URDBLOCK: "<filename>",<size>,"<data>"\r\nOK\r\n
-    uint8_t b[8];
+    //+URDBLOCK: "<filename>",<size>,"<data>"\r\n\r\nOK\r\n
+    char b[8];
+    char *p = BOOT_ublox_tx();
+
+    p = BOOT_APPEND(p, "AT+URDBLOCK=\"");
+    p = BOOT_append(p, filename, strlen(filename));
+    p = BOOT_APPEND(p, "\",");
+    p = BOOT_utoa(p, offset);
+    p = BOOT_APPEND(p, ",");
+    p = BOOT_utoa(p, size);
+    p = BOOT_APPEND(p, "\r");
 
     RING_flush(&ublox_ring);
+    BOOT_ublox_send(ublox_tx, p - ublox_tx);
 
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, "AT+URDBLOCK=\"", 13, 1000);
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, filename, strlen(filename), 1000);
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, "\",", 2, 1000);
-    sprintf(b, "%d", offset);
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, b, strlen(b), 1000);
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, ",", 1, 1000);
-    sprintf(b, "%d", size);
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, b, strlen(b), 1000);
-    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, "\r", 1, 1000);
-
+    //only the response prefix is searched for; the rest is parsed
+    //field by field and the payload is taken by its length
     if(!RING_find_string(&ublox_ring, "+URDBLOCK: \"", 10000)) return 0;
-    if(!RING_find_string(&ublox_ring, filename, 1000)) return 0;
-    if(!RING_find_string(&ublox_ring, "\",", 1000)) return 0;
-    if(!RING_get_until(&ublox_ring, b, ',', 1000)) return 0;
+    if(!RING_get_until(&ublox_ring, NULL, 0, ',', 1000)) return 0;
+    if(!RING_get_until(&ublox_ring, b, sizeof(b), ',', 1000)) return 0;
     int32_t size_read = strtol(b, NULL, 0);
     if(size_read < 0 || size_read > size) return 0;
-    if(!RING_find_string(&ublox_ring, "\"", 1000)) return 0;
-    uint32_t actual_read = RING_get(&ublox_ring, pgm_buffer, size_read, 1000);
+    if(RING_get(&ublox_ring, b, 1, 1000) != 1 || b[0] != '"') return 0;
+    uint32_t actual_read = RING_get(&ublox_ring, buffer, size_read, 1000);
+    if(actual_read != size_read) return 0;
+    //the information text ends in its own \r\n before the result code's
+    if(RING_get(&ublox_ring, b, 1, 1000) != 1 || b[0] != '"') return 0;
     if(!RING_find_string(&ublox_ring, "\r\nOK\r\n", 10000)) return 0;
 
     return actual_read;
 }
 
-void BOOT_LoadSystemFromUblox(const char *filename, uint32_t image_size, uint32_t offset)
+uint32_t BOOT_ReadFramedFromUblox(const char *filename, uint32_t offset, uint32_t pos, uint8_t *buffer)
 {
-    //write to internal memory from ublox flash
-    uint32_t dst = SYSTEM_APP_ADDRESS;
-    uint32_t src = offset;
-    uint32_t end = dst + image_size;
+    //<len:2 LE><payload:len><crc16:2 LE over len+payload>
+    //frames start at offset; every frame but the last carries a full
+    //payload, so the one holding payload position pos is at a fixed file
+    //offset, and a pos inside it returns only the rest of its payload
+    uint32_t skip = pos % BOOT_FRAME_PAYLOAD;
+    uint32_t size_read = BOOT_ReadFromUblox(filename, offset + (pos / BOOT_FRAME_PAYLOAD) * BOOT_FRAME_SIZE,
+            buffer, BOOT_FRAME_SIZE);
+    if(size_read < BOOT_FRAME_OVERHEAD) return 0;
+
+    uint32_t len = buffer[0] | (buffer[1] << 8);
+    if(len == 0 || len > BOOT_FRAME_PAYLOAD || len + BOOT_FRAME_OVERHEAD > size_read) return 0;
+
+    uint16_t crc = buffer[len + 2] | (buffer[len + 3] << 8);
+    if(CRC_crc16(CRC16_INIT, buffer, len + 2) != crc) return 0;
+    if(len <= skip) return 0;
+
+    memmove(buffer, &buffer[2 + skip], len - skip);
+    return len - skip;
+}
 
-    while(dst < end)
+static void BOOT_HttpClose(void)
+{
+    //AT+USOCL=<socket>\r
+    char *p;
+
+    if(http_socket < 0)
+        return;
+    p = BOOT_APPEND(BOOT_ublox_tx(), "AT+USOCL=");
+    p = BOOT_utoa(p, http_socket);
+    p = BOOT_APPEND(p, "\r");
+    BOOT_ublox_command(ublox_tx, p - ublox_tx, 1000);
+    http_socket = -1;
+}
+
+static uint32_t BOOT_SocketRead(uint8_t *buffer, uint32_t size)
+{
+    //AT+USORD=<socket>,<size>\r
+    //wait for
+    //+USORD: <socket>,<len>,"<data>"\r\n\r\nOK\r\n
+    //polling while the modem has nothing buffered yet
+    char b[8];
+    char *p;
+    uint32_t start = OSA_TimeGetMsec();
+
+    do
     {
-        if((dst & (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE-1)) == 0)
-            FLASH_erase_sector(dst);
-        uint32_t len = BOOT_ReadFromUblox(filename, src, pgm_buffer, end - dst < UBLOX_READ_SIZE ? end - dst : UBLOX_READ_SIZE);
-        if(len == 0) {
-            continue;
+        p = BOOT_APPEND(BOOT_ublox_tx(), "AT+USORD=");
+        p = BOOT_utoa(p, http_socket);
+        p = BOOT_APPEND(p, ",");
+        p = BOOT_utoa(p, size);
+        p = BOOT_APPEND(p, "\r");
+        RING_flush(&ublox_ring);
+        BOOT_ublox_send(ublox_tx, p - ublox_tx);
+
+        if(!RING_find_string(&ublox_ring, "+USORD: ", 1000)) return 0;
+        if(!RING_get_until(&ublox_ring, NULL, 0, ',', 1000)) return 0;
+        if(!RING_get_until(&ublox_ring, b, sizeof(b), ',', 1000)) return 0;
+        int32_t size_read = strtol(b, NULL, 0);
+        if(size_read < 0 || size_read > size) return 0;
+        if(RING_get(&ublox_ring, b, 1, 1000) != 1 || b[0] != '"') return 0;
+        if(RING_get(&ublox_ring, buffer, size_read, 1000) != size_read) return 0;
+        if(!RING_find_string(&ublox_ring, "OK", 1000)) return 0;
+        if(size_read)
+            return size_read;
+
+        OSA_TimeDelay(UBLOX_RETRY_DELAY_MS);
+    }while(OSA_TimeGetMsec() - start < UBLOX_SOCKET_WAIT_MS);
+    return 0;
+}
+
+static bool BOOT_HttpOpen(const char *url, uint32_t first, uint32_t last, uint8_t *buffer, uint32_t *body)
+{
+    //GET the byte range [first, last] on a fresh socket; body is how many
+    //bytes of it arrived with the headers, left at the start of buffer
+    char b[8];
+    char *p;
+    const char *host;
+    const char *path;
+    uint32_t host_len;
+    uint32_t port = 80;
+    bool tls = false;
+    uint32_t fill = 0;
+    uint32_t len;
+
+    if(strncmp(url, "https://", 8) == 0) {
+        url += 8;
+        port = 443;
+        tls = true;
+    } else if(strncmp(url, "http://", 7) == 0) {
+        url += 7;
+    }
+    host = url;
+    host_len = strcspn(host, ":/");
+    if(host[host_len] == ':')
+        port = strtol(&host[host_len + 1], NULL, 10);
+    path = strchr(host, '/');
+    if(path == NULL)
+        path = "/";
+
+    //AT+USOCR=6\r
+    //wait for
+    //+USOCR: <socket>\r\n\r\nOK\r\n
+    RING_flush(&ublox_ring);
+    BOOT_ublox_send("AT+USOCR=6\r", 11);
+    if(!RING_find_string(&ublox_ring, "+USOCR: ", 1000)) return false;
+    if(!RING_get_until(&ublox_ring, b, sizeof(b), '\r', 1000)) return false;
+    http_socket = strtol(b, NULL, 10);
+    if(!RING_find_string(&ublox_ring, "OK", 1000)) return false;
+
+    if(tls) {
+        p = BOOT_APPEND(BOOT_ublox_tx(), "AT+USOSEC=");
+        p = BOOT_utoa(p, http_socket);
+        p = BOOT_APPEND(p, ",1,0\r");
+        if(!BOOT_ublox_command(ublox_tx, p - ublox_tx, 1000)) return false;
+    }
+
+    //AT+USOCO=<socket>,"<host>",<port>\r
+    p = BOOT_APPEND(BOOT_ublox_tx(), "AT+USOCO=");
+    p = BOOT_utoa(p, http_socket);
+    p = BOOT_APPEND(p, ",\"");
+    p = BOOT_append(p, host, MIN(host_len, UBLOX_TX_SIZE - 32));
+    p = BOOT_APPEND(p, "\",");
+    p = BOOT_utoa(p, port);
+    p = BOOT_APPEND(p, "\r");
+    if(!BOOT_ublox_command(ublox_tx, p - ublox_tx, UBLOX_CONNECT_MS)) return false;
+
+    //GET <path> HTTP/1.1\r\nHost: <host>\r\nRange: bytes=<first>-<last>\r\n...
+    //the host is bounded as above and the path to what's left of the buffer
+    p = BOOT_APPEND((char *)buffer, "GET ");
+    p = BOOT_append(p, path, MIN(strlen(path), HTTP_HEADER_MAX - UBLOX_TX_SIZE));
+    p = BOOT_APPEND(p, " HTTP/1.1\r\nHost: ");
+    p = BOOT_append(p, host, MIN(host_len, UBLOX_TX_SIZE - 32));
+    p = BOOT_APPEND(p, "\r\nRange: bytes=");
+    p = BOOT_utoa(p, first);
+    p = BOOT_APPEND(p, "-");
+    p = BOOT_utoa(p, last);
+    p = BOOT_APPEND(p, "\r\nConnection: close\r\n\r\n");
+    len = p - (char *)buffer;
+
+    //AT+USOWR=<socket>,<len>\r
+    //wait for the @ prompt, then the raw request
+    p = BOOT_APPEND(BOOT_ublox_tx(), "AT+USOWR=");
+    p = BOOT_utoa(p, http_socket);
+    p = BOOT_APPEND(p, ",");
+    p = BOOT_utoa(p, len);
+    p = BOOT_APPEND(p, "\r");
+    RING_flush(&ublox_ring);
+    BOOT_ublox_send(ublox_tx, p - ublox_tx);
+    if(!RING_find_string(&ublox_ring, "@", 5000)) return false;
+    OSA_TimeDelay(50);
+    BOOT_ublox_send(buffer, len);
+    if(!RING_find_string(&ublox_ring, "OK", 10000)) return false;
+
+    //HTTP/1.x 206, or 200 when the range starts at the top of the file
+    while(1)
+    {
+        if(fill == HTTP_HEADER_MAX) return false;
+        len = BOOT_SocketRead(&buffer[fill], MIN(HTTP_HEADER_MAX - fill, UBLOX_READ_MAX));
+        if(len == 0) return false;
+        fill += len;
+
+        for(uint32_t i = 3; i < fill; i++)
+        {
+            if(memcmp(&buffer[i - 3], "\r\n\r\n", 4) != 0)
+                continue;
+            if(i < 12 || memcmp(buffer, "HTTP/1.", 7) != 0)
+                return false;
+            if(memcmp(&buffer[9], "206", 3) != 0 && (first != 0 || memcmp(&buffer[9], "200", 3) != 0))
+                return false;
+            *body = fill - i - 1;
+            memmove(buffer, &buffer[i + 1], *body);
+            return true;
         }
+    }
+}
 
-        FLASH_write_block(dst, pgm_buffer, UBLOX_READ_SIZE);
-        dst += len;
-        src += len;
+static uint32_t BOOT_ReadFromHttp(const char *url, uint32_t address, uint8_t *buffer, uint32_t max)
+{
+    //one ranged GET streams consecutive reads; any failure or a jump
+    //elsewhere in the file reconnects from the byte that's needed next
+    uint32_t len = 0;
+
+    if(http_socket < 0 || http_next != address)
+    {
+        BOOT_HttpClose();
+        if(!BOOT_HttpOpen(url, address, address + max - 1, buffer, &len))
+        {
+            BOOT_HttpClose();
+            return 0;
+        }
+        http_next = address;
     }
+    if(len == 0)
+        len = BOOT_SocketRead(buffer, MIN(max, UBLOX_READ_MAX));
+    if(len == 0 || len > max)
+    {
+        //a 200 carries more than was asked for; drop the rest
+        BOOT_HttpClose();
+        if(len == 0) return 0;
+        len = max;
+    }
+    http_next += len;
+    return len;
 }
 
-void BOOT_LoadUserFromUblox(uint32_t dst, const char* filename, uint32_t image_size, uint32_t offset)
+static uint32_t BOOT_ReadChunk(const char *filename, uint32_t offset, uint32_t pos, uint32_t max)
 {
-    //write to internal memory from ublox flash
-    uint32_t src = offset;
-    uint32_t end = dst + image_size;
+    uint32_t len;
+    uint32_t size;
 
-    while(dst < end)
+    if(image_source == BOOT_SOURCE_EXTERNAL)
     {
-        if((dst & (USER_SECTOR_SIZE-1)) == 0)
-            EXT_erase_sector(FSL_SPICOMEZPORT, dst);
-        uint32_t len = BOOT_ReadFromUblox(filename, src, pgm_buffer, end - dst < UBLOX_READ_SIZE ? end - dst : UBLOX_READ_SIZE);
-        if(len == 0) {
-            return;
+        //SPI reads don't fail short; the digest catches a bad copy
+        size = max < sizeof(pgm_buffer) ? max : sizeof(pgm_buffer);
+        EXT_read_block(EXT_STAGING, offset + pos, pgm_buffer, size);
+        PERF_COUNT(PERF_SPI_BYTES, size);
+        return size;
+    }
+
+    for(uint32_t retry = 0; retry < UBLOX_READ_RETRIES; retry++)
+    {
+        if(retry)
+            OSA_TimeDelay(UBLOX_RETRY_DELAY_MS << (retry - 1));
+
+        ublox_stats.reads++;
+        if(image_source == BOOT_SOURCE_HTTP)
+        {
+            len = BOOT_ReadFromHttp(filename, offset + pos, pgm_buffer, max);
+            if(len)
+            {
+                PERF_COUNT(PERF_HTTP_BYTES, len);
+                return len;
+            }
+        }
+        else if(transfer_mode == BOOT_TRANSFER_FRAMED)
+        {
+            len = BOOT_ReadFramedFromUblox(filename, offset, pos, pgm_buffer);
+            if(len)
+            {
+                len = len > max ? max : len;
+                PERF_COUNT(PERF_UBLOX_BYTES, len);
+                return len;
+            }
         }
+        else
+        {
+            size = ublox_stats.read_size < max ? ublox_stats.read_size : max;
+            //max stops at the end of the image, so fewer bytes is a damaged reply
+            if(BOOT_ReadFromUblox(filename, offset + pos, pgm_buffer, size) == size)
+            {
+                if(++clean_reads >= UBLOX_GROW_AFTER && ublox_stats.read_size < UBLOX_READ_MAX)
+                {
+                    ublox_stats.read_size <<= 1;
+                    clean_reads = 0;
+                }
+                PERF_COUNT(PERF_UBLOX_BYTES, size);
+                return size;
+            }
+            if(ublox_stats.read_size > UBLOX_READ_SIZE)
+                ublox_stats.read_size >>= 1;
+        }
+        clean_reads = 0;
+        ublox_stats.read_errors++;
+        PERF_COUNT(PERF_READ_RETRIES, 1);
+    }
+    ublox_stats.failed_chunks++;
+    return 0;
+}
 
-        EXT_write_block(FSL_SPICOMEZPORT, dst, pgm_buffer, UBLOX_READ_SIZE);
+static bool BOOT_Erased(const uint8_t *field, uint32_t size)
+{
+    for(uint32_t i = 0; i < size; i++)
+        if(field[i] != 0xFF)
+            return false;
+    return true;
+}
+
+static bool BOOT_DigestSet(const uint8_t *digest)
+{
+    return !BOOT_Erased(digest, SHA256_DIGEST_SIZE);
+}
+
+static bool BOOT_NonceSet(const uint8_t *nonce)
+{
+    return !BOOT_Erased(nonce, AES_NONCE_SIZE);
+}
+
+static RAMFUNC bool BOOT_LoadImage(uint32_t target, uint32_t dst, const char *filename, uint32_t image_size, uint32_t offset, const uint8_t *digest, uint32_t image)
+{
+    //stream from ublox or staging flash into the target, hashing on the way through;
+    //the vectors are only written once the digest matches
+    //runs from RAM with STAGE_write; the reads, hashing and decryption it
+    //calls stay in flash, which is readable between flash commands
+    uint32_t pos = 0;
+    uint8_t actual[SHA256_DIGEST_SIZE];
+
+    STAGE_init(&stage, target);
+    STAGE_hold(&stage, dst);
+    SHA256_init(&sha);
+    while(pos < image_size)
+    {
+        uint32_t len = BOOT_ReadChunk(filename, offset, pos, image_size - pos);
+        if(len == 0) {
+            STAGE_flush(&stage);
+            return false;
+        }
+        if(image_nonce)
+            AES_ctr(&aes, image_nonce, image, pos, pgm_buffer, len);
+        SHA256_update(&sha, pgm_buffer, len);
+        if(!STAGE_write(&stage, dst, pgm_buffer, len)) {
+            return false;
+        }
         dst += len;
-        src += len;
+        pos += len;
+    }
+    if(!STAGE_flush(&stage))
+        return false;
+
+    SHA256_final(&sha, actual);
+    if(BOOT_DigestSet(digest) && memcmp(actual, digest, SHA256_DIGEST_SIZE) != 0)
+        return false;
+
+    return STAGE_release(&stage);
+}
+
+bool BOOT_LoadSystemFromUblox(const char *filename, uint32_t image_size, uint32_t offset, const uint8_t *digest)
+{
+    //write to internal memory from ublox or staging flash
+    uint32_t start = PERF_start();
+    bool ok = BOOT_LoadImage(STAGE_INTERNAL, SYSTEM_APP_ADDRESS, filename, image_size, offset, digest,
+            IMAGE_COUNTER(BOOT_IMAGE_SYSTEM));
+    PERF_stop(PERF_PHASE_SYSTEM, start);
+    return ok;
+}
+
+bool BOOT_LoadUserFromUblox(uint32_t dst, const char* filename, uint32_t image_size, uint32_t offset, const uint8_t *digest)
+{
+    //write to the user module over EZPort from ublox or staging flash
+    uint32_t start = PERF_start();
+    bool ok = BOOT_LoadImage(FSL_SPICOMEZPORT, dst, filename, image_size, offset, digest,
+            IMAGE_COUNTER(dst == 0 ? BOOT_IMAGE_USERBOOT : BOOT_IMAGE_USER));
+    PERF_stop(PERF_PHASE_USER, start);
+    return ok;
+}
+
+void BOOT_UserEnterStep(uint32_t step)
+{
+    //RESET User module into EZPort: EZPCS held low through the reset
+    switch(step)
+    {
+    case 0:
+        GPIO_DRV_ClearPinOutput(M1_EZPCS);
+        GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalOutput);
+        GPIO_DRV_ClearPinOutput(M1_RESET);
+        break;
+    case 1:
+        GPIO_DRV_SetPinOutput(M1_RESET);
+        break;
+    default:
+        GPIO_DRV_SetPinOutput(M1_EZPCS);
+        break;
+    }
+}
+
+void BOOT_UserEnter(void)
+{
+    for(uint32_t step = 0; step < BOOT_USER_ENTER_STEPS; step++)
+    {
+        if(step)
+            OSA_TimeDelay(BOOT_USER_RESET_MS);
+        BOOT_UserEnterStep(step);
+    }
+}
+
+void BOOT_UserExitStep(uint32_t step)
+{
+    //RESET User module into run mode
+    if(step == 0)
+        GPIO_DRV_ClearPinOutput(M1_RESET);
+    else
+        GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalInput);
+}
+
+void BOOT_UserExit(void)
+{
+    for(uint32_t step = 0; step < BOOT_USER_EXIT_STEPS; step++)
+    {
+        if(step)
+            OSA_TimeDelay(BOOT_USER_RESET_MS);
+        BOOT_UserExitStep(step);
     }
 }
 
+static bool BOOT_ReadBlock(const char *filename, uint32_t offset, uint8_t *dst, uint32_t size)
+{
+    uint32_t pos = 0;
+
+    while(pos < size)
+    {
+        uint32_t len = BOOT_ReadChunk(filename, offset, pos, size - pos);
+        if(len == 0)
+            return false;
+        memcpy(&dst[pos], pgm_buffer, len);
+        pos += len;
+    }
+    return true;
+}
+
+static bool BOOT_LoadBundle(const char *filename, uint32_t offset, const uint8_t *digest)
+{
+    //one manifest fetch, then every image streamed in the order the
+    //packager laid them out; with framed transfers each image must
+    //start on a frame boundary
+    uint8_t actual[SHA256_DIGEST_SIZE];
+    bool user = false;
+
+#ifdef BOOT_SIGNED_UPDATES
+    //the signature reaches the manifest, and through it the images, only by digest
+    if(!BOOT_DigestSet(digest))
+        return false;
+#endif
+    if(!BOOT_ReadBlock(filename, offset, (uint8_t *)&bundle, sizeof(bundle)))
+        return false;
+
+    SHA256_init(&sha);
+    SHA256_update(&sha, (uint8_t *)&bundle, sizeof(bundle));
+    SHA256_final(&sha, actual);
+    if(BOOT_DigestSet(digest) && memcmp(actual, digest, SHA256_DIGEST_SIZE) != 0)
+        return false;
+
+    if(bundle.magic != BOOT_BUNDLE_MAGIC || bundle.count > BOOT_BUNDLE_MAX)
+        return false;
+
+    for(uint32_t i = 0; i < bundle.count; i++)
+    {
+        boot_bundle_entry_t *entry = &bundle.entry[i];
+
+        //no decompressor in the bootloader
+        if(entry->flags != 0)
+            return false;
+#ifdef BOOT_SIGNED_UPDATES
+        if(!BOOT_DigestSet(entry->sha256))
+            return false;
+#endif
+
+        if(entry->target == BOOT_IMAGE_SYSTEM)
+        {
+            if(!BOOT_LoadSystemFromUblox(filename, entry->size, offset + entry->offset, entry->sha256))
+                return false;
+        }
+        else if(entry->target == BOOT_IMAGE_USERBOOT || entry->target == BOOT_IMAGE_USER)
+        {
+            if(!user)
+            {
+                PERIPH_init(PERIPH_EZPORT);
+                BOOT_UserEnter();
+                user = true;
+            }
+            //user module failures are left for it to report, as with single files
+            BOOT_LoadUserFromUblox(entry->target == BOOT_IMAGE_USER ? USER_APP_ADDRESS : 0x0,
+                    filename, entry->size, offset + entry->offset, entry->sha256);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if(user)
+        BOOT_UserExit();
+    return true;
+}
+
+#ifdef BOOT_SIGNED_UPDATES
+static bool BOOT_Authenticate(konekt_boot_flags_t *boot_flags)
+{
+    //the signature covers the digests; every image to be installed must
+    //carry one so the streamed SHA-256 ties its contents to the signature
+    if(boot_flags->userboot_size != BOOT_FLAG_ERASED && !BOOT_DigestSet(boot_flags->userboot_sha256))
+        return false;
+    if(boot_flags->user_size != BOOT_FLAG_ERASED && !BOOT_DigestSet(boot_flags->user_sha256))
+        return false;
+    if((boot_flags->system_size != BOOT_FLAG_ERASED || boot_flags->internal_system_size != BOOT_FLAG_ERASED) &&
+       !BOOT_DigestSet(boot_flags->system_sha256))
+        return false;
+    //a bundle's manifest digest travels in system_sha256
+    if(boot_flags->bundle_offset != BOOT_FLAG_ERASED && !BOOT_DigestSet(boot_flags->system_sha256))
+        return false;
+
+    if(boot_flags->internal_system_src != BOOT_FLAG_ERASED &&
+       boot_flags->internal_system_size != BOOT_FLAG_ERASED)
+    {
+        uint8_t actual[SHA256_DIGEST_SIZE];
+        SHA256_init(&sha);
+        SHA256_update(&sha, (const uint8_t *)boot_flags->internal_system_src, boot_flags->internal_system_size);
+        SHA256_final(&sha, actual);
+        if(memcmp(actual, boot_flags->system_sha256, SHA256_DIGEST_SIZE) != 0)
+            return false;
+    }
+
+    return ED25519_verify(boot_flags->signature, boot_public_key,
+            boot_flags->userboot_sha256, 3 * SHA256_DIGEST_SIZE);
+}
+#endif
+
 void BOOT_LoadSystemFromInternal(uint32_t src, uint32_t size)
 {
     //write to internal memory from internal flash
@@ -177,51 +895,12 @@ void BOOT_LoadSystemFromInternal(uint32_t src, uint32_t size)
     }
 }
 
-static __inline__ void delayMicroseconds( uint32_t usec )
-{
-  if ( usec == 0 )
-  {
-    return ;
-  }
-
-  /*
-   *  The following loop:
-   *
-   *    for (; ul; ul--) {
-   *      __asm__ volatile("");
-   *    }
-   *
-   *  produce the following assembly code:
-   *
-   *    loop:
-   *      subs r3, #1        // 1 Core cycle
-   *      bne.n loop         // 1 Core cycle + 1 if branch is taken
-   */
-
-  // VARIANT_MCK / 1000000 == cycles needed to delay 1uS
-  //                     3 == cycles used in a loop
-  uint32_t n = usec * (SystemCoreClock / 1000000) / 3;
-  __asm__ __volatile__(
-    "1:              \n"
-    "   sub %0, #1   \n" // substract 1 from %0 (n)
-    "   bne 1b       \n" // if result is not 0 jump to 1
-    : "+r" (n)           // '%0' is n variable with RW constraints
-    :                    // no input
-    :                    // no clobber
-  );
-  // https://gcc.gnu.org/onlinedocs/gcc/Extended-Asm.html
-  // https://gcc.gnu.org/onlinedocs/gcc/Extended-Asm.html#Volatile
-}
-
-
 void BOOT_CheckFlag(void)
 {
     konekt_boot_flags_t *boot_flags = (konekt_boot_flags_t *)BOOT_FLAG_ADDRESS;
 
     if(boot_flags->special_code == BOOT_SPECIAL_EXT) {
-        PE_low_level_init();
-        FLASH_init_ram();
-        __ISB();
+        PERIPH_init(PERIPH_FLASH);
         FLASH_erase_sector(BOOT_FLAG_ADDRESS);
         return;
     }
@@ -230,9 +909,35 @@ void BOOT_CheckFlag(void)
        boot_flags->end_code != BOOT_SPECIAL_UBLOX)
         return;
 
-    PE_low_level_init();
-    FLASH_init_ram();
-    __ISB();
+    //the rest is brought up by the steps that use it: an internal copy or
+    //a flag with nothing to install never touches the modem, SPI or I2C
+    PERIPH_init(PERIPH_FLASH);
+    TRACE_init();
+    uint32_t update_start = PERF_start();
+
+    transfer_mode = boot_flags->transfer_mode;
+    image_source = boot_flags->image_source;
+
+    //an erased nonce means the images on the modem are plaintext
+    if(BOOT_NonceSet(boot_flags->nonce))
+    {
+#ifdef BOOT_ENCRYPTED_UPDATES
+        AES_init(&aes, boot_image_key);
+        image_nonce = boot_flags->nonce;
+#else
+        FLASH_erase_sector(BOOT_FLAG_ADDRESS);
+        NVIC_SystemReset();
+#endif
+    }
+
+#ifdef BOOT_SIGNED_UPDATES
+    //checked once per update; normal boots never get here
+    if(!BOOT_Authenticate(boot_flags))
+    {
+        FLASH_erase_sector(BOOT_FLAG_ADDRESS);
+        NVIC_SystemReset();
+    }
+#endif
 
     if(boot_flags->internal_system_src != BOOT_FLAG_ERASED &&
        boot_flags->internal_system_size != BOOT_FLAG_ERASED)
@@ -241,55 +946,68 @@ void BOOT_CheckFlag(void)
     }
 
 
-    if( (boot_flags->system_size != BOOT_FLAG_ERASED) || (boot_flags->userboot_size != BOOT_FLAG_ERASED) || (boot_flags->user_size != BOOT_FLAG_ERASED))
+    if( (boot_flags->bundle_offset != BOOT_FLAG_ERASED) || (boot_flags->system_size != BOOT_FLAG_ERASED) || (boot_flags->userboot_size != BOOT_FLAG_ERASED) || (boot_flags->user_size != BOOT_FLAG_ERASED))
     {
-        uint32_t retry = 3;
-        while(!BOOT_ublox_echo_off())
+        //images already copied to the staging flash install without the modem
+        if(image_source == BOOT_SOURCE_EXTERNAL)
         {
-            LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, "\x11", 1, 1000);
-            if(--retry == 0) {
-                retry = 3;
-                GPIO_DRV_InputPinInit(&ublox_reset_input_config);
-                GPIO_DRV_ClearPinOutput(UBLOX_RESET_N);
-                GPIO_DRV_SetPinDir(UBLOX_RESET_N, kGpioDigitalOutput);
-                delayMicroseconds(60);
-                GPIO_DRV_SetPinDir(UBLOX_RESET_N, kGpioDigitalInput);
-                OSA_TimeDelay(3000);
-            }
-            OSA_TimeDelay(1000);
+            EXT_init(EXT_STAGING);
         }
-
-        if(boot_flags->system_size != BOOT_FLAG_ERASED)
+        else
         {
-            BOOT_LoadSystemFromUblox(boot_flags->system_filename, boot_flags->system_size, boot_flags->system_offset);
+            uint32_t start = PERF_start();
+            BOOT_ublox_wait_ready();
+            PERF_stop(PERF_PHASE_MODEM, start);
         }
 
-        if( (boot_flags->userboot_size != BOOT_FLAG_ERASED) || (boot_flags->user_size != BOOT_FLAG_ERASED)) {
-            //RESET User module into EZPort
-            GPIO_DRV_ClearPinOutput(M1_EZPCS);
-            GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalOutput);
-            GPIO_DRV_ClearPinOutput(M1_RESET);
-            OSA_TimeDelay(10);
-            GPIO_DRV_SetPinOutput(M1_RESET);
-            OSA_TimeDelay(10);
-            GPIO_DRV_SetPinOutput(M1_EZPCS);
-
-            if(boot_flags->userboot_size != BOOT_FLAG_ERASED)
+        if(boot_flags->bundle_offset != BOOT_FLAG_ERASED)
+        {
+            //as with a single system image, a failure retries on the next reset
+            if(!BOOT_LoadBundle(boot_flags->system_filename, boot_flags->bundle_offset, boot_flags->system_sha256))
             {
-                BOOT_LoadUserFromUblox(0x0, boot_flags->userboot_filename, boot_flags->userboot_size, boot_flags->userboot_offset);
+                BOOT_HttpClose();
+                NVIC_SystemReset();
             }
-            if(boot_flags->user_size != BOOT_FLAG_ERASED)
+        }
+        else
+        {
+            if(boot_flags->system_size != BOOT_FLAG_ERASED)
             {
-                BOOT_LoadUserFromUblox(USER_APP_ADDRESS, boot_flags->user_filename, boot_flags->user_size, boot_flags->user_offset);
+                //leave the flag set so the next reset retries the whole image;
+                //a digest mismatch leaves the vectors erased so it can't boot
+                if(!BOOT_LoadSystemFromUblox(boot_flags->system_filename, boot_flags->system_size, boot_flags->system_offset, boot_flags->system_sha256))
+                {
+                    BOOT_HttpClose();
+                    NVIC_SystemReset();
+                }
             }
 
-            //RESET User module into run mode
-            GPIO_DRV_ClearPinOutput(M1_RESET);
-            OSA_TimeDelay(10);
-            GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalInput);
+            if( (boot_flags->userboot_size != BOOT_FLAG_ERASED) || (boot_flags->user_size != BOOT_FLAG_ERASED)) {
+                PERIPH_init(PERIPH_EZPORT);
+                BOOT_UserEnter();
+
+                if(boot_flags->userboot_size != BOOT_FLAG_ERASED)
+                {
+                    BOOT_LoadUserFromUblox(0x0, boot_flags->userboot_filename, boot_flags->userboot_size, boot_flags->userboot_offset, boot_flags->userboot_sha256);
+                }
+                if(boot_flags->user_size != BOOT_FLAG_ERASED)
+                {
+                    BOOT_LoadUserFromUblox(USER_APP_ADDRESS, boot_flags->user_filename, boot_flags->user_size, boot_flags->user_offset, boot_flags->user_sha256);
+                }
+
+                BOOT_UserExit();
+            }
         }
+
+        //the modem outlives our reset, so don't leak its socket
+        BOOT_HttpClose();
     }
 
+    //left in its own sector for the application to collect
+    perf.counter[PERF_RING_OVERRUNS] = ublox_ring.overruns;
+    perf.counter[PERF_RING_STALLS] = ublox_ring.stalls;
+    PERF_stop(PERF_PHASE_UPDATE, update_start);
+    PERF_save(BOOT_PERF_ADDRESS);
     FLASH_erase_sector(BOOT_FLAG_ADDRESS);
 
     OSA_TimeDelay(3000);
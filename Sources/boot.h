@@ -40,8 +40,41 @@ typedef struct
     uint32_t internal_system_src;       //0x031C
     uint32_t internal_system_size;      //0x0320
     uint32_t end_code;                  //0x0324
+    uint32_t transfer_mode;             //0x0328
+    uint8_t  userboot_sha256[32];       //0x032C
+    uint8_t  user_sha256[32];           //0x034C
+    uint8_t  system_sha256[32];         //0x036C
+    uint8_t  signature[64];             //0x038C Ed25519 over the three digests
+    uint8_t  nonce[12];                 //0x03CC AES-CTR nonce, erased for plaintext images
+    uint32_t image_source;              //0x03D8
+    uint32_t bundle_offset;             //0x03DC
 }konekt_boot_flags_t;
 
+//bundle_offset, when set, locates a bundle in system_filename holding every
+//image; system_sha256 then digests the manifest, which digests each image
+#define BOOT_BUNDLE_MAGIC   0x4C444E42 //'BNDL'
+#define BOOT_BUNDLE_MAX     (3)
+
+#define BOOT_IMAGE_USERBOOT (0)
+#define BOOT_IMAGE_USER     (1)
+#define BOOT_IMAGE_SYSTEM   (2)
+
+typedef struct
+{
+    uint32_t target;                    //BOOT_IMAGE_*
+    uint32_t offset;                    //from the start of the bundle
+    uint32_t size;
+    uint32_t flags;                     //compression, must be 0
+    uint8_t  sha256[32];
+}boot_bundle_entry_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t count;                     //entries installed in order
+    boot_bundle_entry_t entry[BOOT_BUNDLE_MAX];
+}boot_bundle_t;
+
 typedef struct
 {
     uint32_t id;
@@ -58,17 +91,52 @@ typedef struct
     char     desc[32];
 }konekt_flash_id_t;
 
+typedef struct
+{
+    uint32_t read_size;         //current URDBLOCK request size
+    uint32_t reads;             //URDBLOCK requests issued
+    uint32_t read_errors;       //timeouts, parse errors and short reads
+    uint32_t failed_chunks;     //chunks given up after UBLOX_READ_RETRIES
+    uint32_t probes;            //unanswered readiness probes
+    uint32_t resets;            //UBLOX_RESET_N pulses
+    uint32_t ready_ms;          //time from first probe to modem ready
+}boot_ublox_stats_t;
+
 extern konekt_flash_id_t id;
 extern ring_t ublox_ring;
+extern boot_ublox_stats_t ublox_stats;
 
 void BOOT_CheckFlag(void);
+void BOOT_UserEnter(void);
+void BOOT_UserExit(void);
+
+//the same in steps BOOT_USER_RESET_MS apart, for tasks that mustn't block
+#define BOOT_USER_RESET_MS          (10)
+#define BOOT_USER_ENTER_STEPS       (3)
+#define BOOT_USER_EXIT_STEPS        (2)
+void BOOT_UserEnterStep(uint32_t step);
+void BOOT_UserExitStep(uint32_t step);
 
 #define USER_APP_ADDRESS            0x00008000
 #define SYSTEM_APP_ADDRESS          0x00006000
 
+#define BOOT_FLAG_ADDRESS (SYSTEM_APP_ADDRESS - FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE)
+#define BOOT_FLAG_ERASED (0xFFFFFFFF)
+//the last update's perf_t, in its own sector so the app owns the flags
+#define BOOT_PERF_ADDRESS (BOOT_FLAG_ADDRESS - FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE)
+
 #define HOLO (0x4F4C4F48)
 
 #define BOOT_SPECIAL_EXT   0x746F6F62 //'boot'
 #define BOOT_SPECIAL_UBLOX 0x544F4F42 //'BOOT'
 
+//an erased (all 0xFF) *_sha256 skips the digest check for that image
+
+//transfer_mode, left erased for plain URDBLOCK reads of the raw image
+#define BOOT_TRANSFER_FRAMED 0x4D415246 //'FRAM' file is CRC16 framed
+
+//image_source, left erased to read the images from the ublox file system
+#define BOOT_SOURCE_EXTERNAL 0x46495053 //'SPIF' *_offset is an address in the staging flash
+#define BOOT_SOURCE_HTTP     0x50545448 //'HTTP' *_filename is [http[s]://]host[:port]/path
+
 #endif /* SOURCES_BOOT_H_ */
@@ -0,0 +1,84 @@
+/*
+  crc.c - checksums and block hashes
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "crc.h"
+
+//CRC-16/CCITT (poly 0x1021), one nibble at a time to keep the table small
+static const uint16_t crc16_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t CRC_crc16(uint16_t crc, const uint8_t *data, uint32_t size)
+{
+    while(size--)
+    {
+        uint8_t b = *data++;
+        crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (b >> 4)];
+        crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (b & 0x0F)];
+    }
+    return crc;
+}
+
+static __inline__ uint32_t rotl32(uint32_t x, uint32_t r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+static __inline__ uint32_t hash32_mix(uint32_t h, uint32_t k)
+{
+    k *= 0xCC9E2D51;
+    k = rotl32(k, 15);
+    k *= 0x1B873593;
+    h ^= k;
+    h = rotl32(h, 13);
+    return h * 5 + 0xE6546B64;
+}
+
+//MurmurHash3_x86_32 with seed 0 over whole aligned words, so a host can
+//reproduce it with any stock implementation; the M0+ has a single cycle
+//multiplier, unrolled by four to keep the loop overhead down
+uint32_t CRC_hash32(const uint32_t *data, uint32_t words)
+{
+    uint32_t h = 0;
+    uint32_t n = words >> 2;
+
+    while(n--)
+    {
+        h = hash32_mix(h, data[0]);
+        h = hash32_mix(h, data[1]);
+        h = hash32_mix(h, data[2]);
+        h = hash32_mix(h, data[3]);
+        data += 4;
+    }
+    n = words & 3;
+    while(n--)
+        h = hash32_mix(h, *data++);
+
+    h ^= words * 4;
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
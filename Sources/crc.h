@@ -0,0 +1,33 @@
+/*
+  crc.h - checksums and block hashes
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_CRC_H_
+#define SOURCES_CRC_H_
+
+#include <stdint.h>
+
+#define CRC16_INIT (0xFFFF)
+
+uint16_t CRC_crc16(uint16_t crc, const uint8_t *data, uint32_t size);
+uint32_t CRC_hash32(const uint32_t *data, uint32_t words);
+
+#endif /* SOURCES_CRC_H_ */
@@ -0,0 +1,532 @@
+/*
+  ed25519.c - Ed25519 signature verification
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ed25519.h"
+#include "arena.h"
+
+#include <string.h>
+
+//Verify only, no heap and no secret data so nothing here needs to be
+//constant time.  Field elements are 16 limbs of 16 bits held in 32 bit
+//words and kept carried below 2^16, so every limb product fits the
+//M0+ 32x32->32 multiplier and only the column sums need 64 bits.
+//Nothing recurses, so the large temporaries are static in the update
+//arena rather than on the 1 KB stack; only fe_mul's columns stay local.
+
+typedef uint32_t fe[16];
+
+typedef struct
+{
+    fe X, Y, Z, T;
+}ge;
+
+static const fe FE_D2 = {0xF159, 0x26B2, 0x9B94, 0xEBD6, 0xB156, 0x8283, 0x149A, 0x00E0, 0xD130, 0xEEF3, 0x80F2, 0x198E, 0xFCE7, 0x56DF, 0xD9DC, 0x2406};
+static const fe FE_D  = {0x78A3, 0x1359, 0x4DCA, 0x75EB, 0xD8AB, 0x4141, 0x0A4D, 0x0070, 0xE898, 0x7779, 0x4079, 0x8CC7, 0xFE73, 0x2B6F, 0x6CEE, 0x5203};
+static const fe FE_I  = {0xA0B0, 0x4A0E, 0x1B27, 0xC4EE, 0xE478, 0xAD2F, 0x1806, 0x2F43, 0xD7A7, 0x3DFB, 0x0099, 0x2B4D, 0xDF0B, 0x4FC1, 0x2480, 0x2B83};
+
+//base point in extended coordinates
+static const ge GE_B = {
+    {0xD51A, 0x8F25, 0x2D60, 0xC956, 0xA7B2, 0x9525, 0xC760, 0x692C, 0xDC5C, 0xFDD6, 0xE231, 0xC0A4, 0x53FE, 0xCD6E, 0x36D3, 0x2169},
+    {0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666},
+    {1},
+    {0xDDA3, 0xA5B7, 0x8AB3, 0x6DDE, 0x52F5, 0x7751, 0x9F80, 0x20F0, 0xE37D, 0x64AB, 0x4E8E, 0x66EA, 0x7665, 0xD78B, 0x5F0F, 0x6787}
+};
+
+//group order, little endian
+static const uint8_t L[32] = {
+    0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58, 0xD6, 0x9C, 0xF7, 0xA2, 0xDE, 0xF9, 0xDE, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+static void fe_carry(fe o)
+{
+    uint32_t c;
+    uint32_t i;
+
+    //2^256 == 38 mod p; repeat until the wrap into limb 0 stops carrying
+    do {
+        c = 0;
+        for(i = 0; i < 16; i++)
+        {
+            o[i] += c;
+            c = o[i] >> 16;
+            o[i] &= 0xFFFF;
+        }
+        o[0] += 38 * c;
+    } while(o[0] > 0xFFFF);
+}
+
+static void fe_copy(fe o, const fe a)
+{
+    memcpy(o, a, sizeof(fe));
+}
+
+static void fe_add(fe o, const fe a, const fe b)
+{
+    for(uint32_t i = 0; i < 16; i++)
+        o[i] = a[i] + b[i];
+    fe_carry(o);
+}
+
+static void fe_sub(fe o, const fe a, const fe b)
+{
+    //add 4p so no limb goes negative
+    o[0] = a[0] + 0x3FFB4 - b[0];
+    for(uint32_t i = 1; i < 15; i++)
+        o[i] = a[i] + 0x3FFFC - b[i];
+    o[15] = a[15] + 0x1FFFC - b[15];
+    fe_carry(o);
+}
+
+static void fe_mul(fe o, const fe a, const fe b)
+{
+    uint64_t t[31];
+    uint64_t v;
+    uint32_t c;
+    uint32_t i, j;
+
+    memset(t, 0, sizeof(t));
+    for(i = 0; i < 16; i++)
+    {
+        uint32_t ai = a[i];
+        for(j = 0; j < 16; j++)
+            t[i + j] += (uint32_t)(ai * b[j]);
+    }
+    for(i = 0; i < 15; i++)
+        t[i] += 38 * t[i + 16];
+
+    c = 0;
+    for(i = 0; i < 16; i++)
+    {
+        v = t[i] + c;
+        o[i] = (uint32_t)v & 0xFFFF;
+        c = (uint32_t)(v >> 16);
+    }
+    o[0] += 38 * c;
+    fe_carry(o);
+}
+
+static void fe_sq(fe o, const fe a)
+{
+    fe_mul(o, a, a);
+}
+
+static void fe_inv(fe o, const fe a)
+{
+    //a^(p-2)
+    fe c;
+    fe_copy(c, a);
+    for(int32_t i = 253; i >= 0; i--)
+    {
+        fe_sq(c, c);
+        if(i != 2 && i != 4)
+            fe_mul(c, c, a);
+    }
+    fe_copy(o, c);
+}
+
+static void fe_pow2523(fe o, const fe a)
+{
+    //a^((p-5)/8)
+    fe c;
+    fe_copy(c, a);
+    for(int32_t i = 250; i >= 0; i--)
+    {
+        fe_sq(c, c);
+        if(i != 1)
+            fe_mul(c, c, a);
+    }
+    fe_copy(o, c);
+}
+
+static void fe_pack(uint8_t *o, const fe a)
+{
+    int32_t t[16], m[16];
+    int32_t b;
+    uint32_t i, j;
+
+    for(i = 0; i < 16; i++)
+        t[i] = a[i];
+
+    //value is below 2^256 < 3p, so two conditional subtractions reduce it
+    for(j = 0; j < 2; j++)
+    {
+        m[0] = t[0] - 0xFFED;
+        for(i = 1; i < 15; i++)
+        {
+            m[i] = t[i] - 0xFFFF - ((m[i-1] >> 16) & 1);
+            m[i-1] &= 0xFFFF;
+        }
+        m[15] = t[15] - 0x7FFF - ((m[14] >> 16) & 1);
+        b = (m[15] >> 16) & 1;
+        m[14] &= 0xFFFF;
+        if(!b)
+            memcpy(t, m, sizeof(t));
+    }
+    for(i = 0; i < 16; i++)
+    {
+        o[2*i] = t[i] & 0xFF;
+        o[2*i+1] = t[i] >> 8;
+    }
+}
+
+static void fe_unpack(fe o, const uint8_t *n)
+{
+    for(uint32_t i = 0; i < 16; i++)
+        o[i] = n[2*i] | ((uint32_t)n[2*i+1] << 8);
+    o[15] &= 0x7FFF;
+}
+
+static bool fe_equal(const fe a, const fe b)
+{
+    uint8_t x[32], y[32];
+    fe_pack(x, a);
+    fe_pack(y, b);
+    return memcmp(x, y, 32) == 0;
+}
+
+static uint8_t fe_parity(const fe a)
+{
+    uint8_t x[32];
+    fe_pack(x, a);
+    return x[0] & 1;
+}
+
+static void ge_add(ge *p, const ge *q)
+{
+    static ARENA_UPDATE fe a, b, c, d, t, e, f, g, h;
+
+    fe_sub(a, p->Y, p->X);
+    fe_sub(t, q->Y, q->X);
+    fe_mul(a, a, t);
+    fe_add(b, p->X, p->Y);
+    fe_add(t, q->X, q->Y);
+    fe_mul(b, b, t);
+    fe_mul(c, p->T, q->T);
+    fe_mul(c, c, FE_D2);
+    fe_mul(d, p->Z, q->Z);
+    fe_add(d, d, d);
+    fe_sub(e, b, a);
+    fe_sub(f, d, c);
+    fe_add(g, d, c);
+    fe_add(h, b, a);
+
+    fe_mul(p->X, e, f);
+    fe_mul(p->Y, h, g);
+    fe_mul(p->Z, g, f);
+    fe_mul(p->T, e, h);
+}
+
+static void ge_double(ge *p)
+{
+    static ARENA_UPDATE fe a, b, c, e, f, g, h;
+
+    fe_sq(a, p->X);
+    fe_sq(b, p->Y);
+    fe_sq(c, p->Z);
+    fe_add(c, c, c);
+    fe_add(h, a, b);
+    fe_add(e, p->X, p->Y);
+    fe_sq(e, e);
+    fe_sub(e, h, e);
+    fe_sub(g, a, b);
+    fe_add(f, c, g);
+
+    fe_mul(p->X, e, f);
+    fe_mul(p->Y, g, h);
+    fe_mul(p->Z, f, g);
+    fe_mul(p->T, e, h);
+}
+
+static void ge_pack(uint8_t *o, const ge *p)
+{
+    fe zi, tx, ty;
+
+    fe_inv(zi, p->Z);
+    fe_mul(tx, p->X, zi);
+    fe_mul(ty, p->Y, zi);
+    fe_pack(o, ty);
+    o[31] ^= fe_parity(tx) << 7;
+}
+
+//decode a public key and negate it, so verification is a single sum
+static bool ge_unpack_negate(ge *r, const uint8_t *p)
+{
+    static ARENA_UPDATE fe num, den, den2, den4, den6, t, chk;
+
+    memset(r->Z, 0, sizeof(fe));
+    r->Z[0] = 1;
+    fe_unpack(r->Y, p);
+    fe_sq(num, r->Y);
+    fe_mul(den, num, FE_D);
+    fe_sub(num, num, r->Z);
+    fe_add(den, r->Z, den);
+
+    fe_sq(den2, den);
+    fe_sq(den4, den2);
+    fe_mul(den6, den4, den2);
+    fe_mul(t, den6, num);
+    fe_mul(t, t, den);
+
+    fe_pow2523(t, t);
+    fe_mul(t, t, num);
+    fe_mul(t, t, den);
+    fe_mul(t, t, den);
+    fe_mul(r->X, t, den);
+
+    fe_sq(chk, r->X);
+    fe_mul(chk, chk, den);
+    if(!fe_equal(chk, num))
+        fe_mul(r->X, r->X, FE_I);
+
+    fe_sq(chk, r->X);
+    fe_mul(chk, chk, den);
+    if(!fe_equal(chk, num))
+        return false;
+
+    if(fe_parity(r->X) == (p[31] >> 7))
+    {
+        fe zero = {0};
+        fe_sub(r->X, zero, r->X);
+    }
+
+    fe_mul(r->T, r->X, r->Y);
+    return true;
+}
+
+static void sc_reduce(uint8_t *r)
+{
+    //r (64 bytes) mod L into r[0..31]
+    static int64_t x[64] ARENA_UPDATE;
+    int64_t carry;
+    int32_t i, j;
+
+    for(i = 0; i < 64; i++)
+        x[i] = r[i];
+
+    for(i = 63; i >= 32; i--)
+    {
+        carry = 0;
+        for(j = i - 32; j < i - 12; j++)
+        {
+            x[j] += carry - 16 * x[i] * L[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry << 8;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+    carry = 0;
+    for(j = 0; j < 32; j++)
+    {
+        x[j] += carry - (x[31] >> 4) * L[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for(j = 0; j < 32; j++)
+        x[j] -= carry * L[j];
+    for(i = 0; i < 32; i++)
+    {
+        x[i+1] += x[i] >> 8;
+        r[i] = x[i] & 255;
+    }
+}
+
+static bool sc_canonical(const uint8_t *s)
+{
+    //s < L
+    for(int32_t i = 31; i >= 0; i--)
+    {
+        if(s[i] < L[i])
+            return true;
+        if(s[i] > L[i])
+            return false;
+    }
+    return false;
+}
+
+/* SHA-512, only needed for the R || A || M challenge hash */
+
+typedef struct
+{
+    uint64_t state[8];
+    uint32_t count;
+    uint8_t  block[128];
+}sha512_t;
+
+static const uint64_t K512[80] = {
+    0x428A2F98D728AE22ULL, 0x7137449123EF65CDULL, 0xB5C0FBCFEC4D3B2FULL, 0xE9B5DBA58189DBBCULL,
+    0x3956C25BF348B538ULL, 0x59F111F1B605D019ULL, 0x923F82A4AF194F9BULL, 0xAB1C5ED5DA6D8118ULL,
+    0xD807AA98A3030242ULL, 0x12835B0145706FBEULL, 0x243185BE4EE4B28CULL, 0x550C7DC3D5FFB4E2ULL,
+    0x72BE5D74F27B896FULL, 0x80DEB1FE3B1696B1ULL, 0x9BDC06A725C71235ULL, 0xC19BF174CF692694ULL,
+    0xE49B69C19EF14AD2ULL, 0xEFBE4786384F25E3ULL, 0x0FC19DC68B8CD5B5ULL, 0x240CA1CC77AC9C65ULL,
+    0x2DE92C6F592B0275ULL, 0x4A7484AA6EA6E483ULL, 0x5CB0A9DCBD41FBD4ULL, 0x76F988DA831153B5ULL,
+    0x983E5152EE66DFABULL, 0xA831C66D2DB43210ULL, 0xB00327C898FB213FULL, 0xBF597FC7BEEF0EE4ULL,
+    0xC6E00BF33DA88FC2ULL, 0xD5A79147930AA725ULL, 0x06CA6351E003826FULL, 0x142929670A0E6E70ULL,
+    0x27B70A8546D22FFCULL, 0x2E1B21385C26C926ULL, 0x4D2C6DFC5AC42AEDULL, 0x53380D139D95B3DFULL,
+    0x650A73548BAF63DEULL, 0x766A0ABB3C77B2A8ULL, 0x81C2C92E47EDAEE6ULL, 0x92722C851482353BULL,
+    0xA2BFE8A14CF10364ULL, 0xA81A664BBC423001ULL, 0xC24B8B70D0F89791ULL, 0xC76C51A30654BE30ULL,
+    0xD192E819D6EF5218ULL, 0xD69906245565A910ULL, 0xF40E35855771202AULL, 0x106AA07032BBD1B8ULL,
+    0x19A4C116B8D2D0C8ULL, 0x1E376C085141AB53ULL, 0x2748774CDF8EEB99ULL, 0x34B0BCB5E19B48A8ULL,
+    0x391C0CB3C5C95A63ULL, 0x4ED8AA4AE3418ACBULL, 0x5B9CCA4F7763E373ULL, 0x682E6FF3D6B2B8A3ULL,
+    0x748F82EE5DEFB2FCULL, 0x78A5636F43172F60ULL, 0x84C87814A1F0AB72ULL, 0x8CC702081A6439ECULL,
+    0x90BEFFFA23631E28ULL, 0xA4506CEBDE82BDE9ULL, 0xBEF9A3F7B2C67915ULL, 0xC67178F2E372532BULL,
+    0xCA273ECEEA26619CULL, 0xD186B8C721C0C207ULL, 0xEADA7DD6CDE0EB1EULL, 0xF57D4F7FEE6ED178ULL,
+    0x06F067AA72176FBAULL, 0x0A637DC5A2C898A6ULL, 0x113F9804BEF90DAEULL, 0x1B710B35131C471BULL,
+    0x28DB77F523047D84ULL, 0x32CAAB7B40C72493ULL, 0x3C9EBE0A15C9BEBCULL, 0x431D67C49C100D4CULL,
+    0x4CC5D4BECB3E42B6ULL, 0x597F299CFC657E2AULL, 0x5FCB6FAB3AD6FAECULL, 0x6C44198C4A475817ULL,
+};
+
+#define ROR64(x,n)  (((x) >> (n)) | ((x) << (64 - (n))))
+
+static uint64_t load64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for(uint32_t i = 0; i < 8; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static void sha512_compress(uint64_t *state, const uint8_t *p)
+{
+    uint64_t w[16];
+    uint64_t s[8];
+    uint64_t t1, t2;
+    uint32_t i;
+
+    for(i = 0; i < 16; i++)
+        w[i] = load64(&p[i * 8]);
+    memcpy(s, state, sizeof(s));
+
+    for(i = 0; i < 80; i++)
+    {
+        if(i >= 16)
+        {
+            uint64_t a = w[(i - 15) & 15];
+            uint64_t b = w[(i - 2) & 15];
+            w[i & 15] += (ROR64(a, 1) ^ ROR64(a, 8) ^ (a >> 7)) + w[(i - 7) & 15] +
+                         (ROR64(b, 19) ^ ROR64(b, 61) ^ (b >> 6));
+        }
+        t1 = s[7] + (ROR64(s[4], 14) ^ ROR64(s[4], 18) ^ ROR64(s[4], 41)) +
+             (s[6] ^ (s[4] & (s[5] ^ s[6]))) + K512[i] + w[i & 15];
+        t2 = (ROR64(s[0], 28) ^ ROR64(s[0], 34) ^ ROR64(s[0], 39)) +
+             ((s[0] & s[1]) | (s[2] & (s[0] | s[1])));
+        memmove(&s[1], &s[0], 7 * sizeof(uint64_t));
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+    for(i = 0; i < 8; i++)
+        state[i] += s[i];
+}
+
+static void sha512_init(sha512_t *ctx)
+{
+    static const uint64_t iv[8] = {
+        0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+        0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->count = 0;
+}
+
+static void sha512_update(sha512_t *ctx, const uint8_t *data, uint32_t size)
+{
+    while(size--)
+    {
+        ctx->block[ctx->count++ & 127] = *data++;
+        if((ctx->count & 127) == 0)
+            sha512_compress(ctx->state, ctx->block);
+    }
+}
+
+static void sha512_final(sha512_t *ctx, uint8_t *digest)
+{
+    uint32_t used = ctx->count & 127;
+    uint32_t bits = ctx->count << 3;
+    uint32_t i;
+
+    ctx->block[used++] = 0x80;
+    if(used > 112)
+    {
+        memset(&ctx->block[used], 0, 128 - used);
+        sha512_compress(ctx->state, ctx->block);
+        used = 0;
+    }
+    memset(&ctx->block[used], 0, 124 - used);
+    ctx->block[124] = bits >> 24;
+    ctx->block[125] = bits >> 16;
+    ctx->block[126] = bits >> 8;
+    ctx->block[127] = bits;
+    sha512_compress(ctx->state, ctx->block);
+
+    for(i = 0; i < 64; i++)
+        digest[i] = ctx->state[i / 8] >> (56 - 8 * (i % 8));
+}
+
+static uint32_t bit(const uint8_t *s, uint32_t i)
+{
+    return (s[i >> 3] >> (i & 7)) & 1;
+}
+
+bool ED25519_verify(const uint8_t *signature, const uint8_t *public_key, const uint8_t *message, uint32_t size)
+{
+    static sha512_t sha ARENA_UPDATE;
+    static uint8_t h[64] ARENA_UPDATE;
+    static ARENA_UPDATE ge a, ab, p;
+    uint8_t check[32];
+
+    if(!sc_canonical(&signature[32]))
+        return false;
+    if(!ge_unpack_negate(&a, public_key))
+        return false;
+
+    sha512_init(&sha);
+    sha512_update(&sha, signature, 32);
+    sha512_update(&sha, public_key, 32);
+    sha512_update(&sha, message, size);
+    sha512_final(&sha, h);
+    sc_reduce(h);
+
+    //R' = [s]B + [h](-A), interleaved so both scalars share the doublings
+    memcpy(&ab, &GE_B, sizeof(ge));
+    ge_add(&ab, &a);
+
+    memset(&p, 0, sizeof(p));
+    p.Y[0] = 1;
+    p.Z[0] = 1;
+    for(int32_t i = 255; i >= 0; i--)
+    {
+        uint32_t sb = bit(&signature[32], i);
+        uint32_t hb = bit(h, i);
+
+        ge_double(&p);
+        if(sb && hb)
+            ge_add(&p, &ab);
+        else if(sb)
+            ge_add(&p, &GE_B);
+        else if(hb)
+            ge_add(&p, &a);
+    }
+
+    ge_pack(check, &p);
+    return memcmp(check, signature, 32) == 0;
+}
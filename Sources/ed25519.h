@@ -0,0 +1,34 @@
+/*
+  ed25519.h - Ed25519 signature verification
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_ED25519_H_
+#define SOURCES_ED25519_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ED25519_KEY_SIZE        (32)
+#define ED25519_SIGNATURE_SIZE  (64)
+
+bool ED25519_verify(const uint8_t *signature, const uint8_t *public_key, const uint8_t *message, uint32_t size);
+
+#endif /* SOURCES_ED25519_H_ */
@@ -24,6 +24,7 @@
 
 #include "ext_flash.h"
 #include "gpio1.h"
+#include "spiComEZPort.h"
 
 #define SS_PIN(inst) ((inst==0) ? M1_EZPCS : M2_SS)
 #define SS_ENABLE(inst) (GPIO_DRV_ClearPinOutput(SS_PIN(inst)))
@@ -31,6 +32,39 @@
 #define HAS_UNLOCK(inst) (inst == 1)
 #define HAS_RESET(inst) (inst == 1)
 
+static spi_master_state_t ext_master_state;
+
+//the staging flash sits alone on its bus, so run it at the fastest rate the
+//module clock allows rather than the EZPort's 4MHz
+static const spi_master_user_config_t ext_master_config = {
+  .bitsPerSec = 12000000U,
+  .polarity = kSpiClockPolarity_ActiveHigh,
+  .phase = kSpiClockPhase_FirstEdge,
+  .direction = kSpiMsbFirst,
+  .bitCount = kSpi8BitMode,
+};
+
+void EXT_init(uint32_t instance)
+{
+    uint32_t baud;
+
+    //the EZPort bus is brought up by Processor Expert
+    if(instance == FSL_SPICOMEZPORT)
+        return;
+
+    //SPI1: SCK on PTD5, MOSI on PTE1, MISO on PTE0; M2_SS is a GPIO
+    PORT_HAL_SetMuxMode(PORTD, 5UL, kPortMuxAlt2);
+    PORT_HAL_SetMuxMode(PORTE, 1UL, kPortMuxAlt2);
+    PORT_HAL_SetMuxMode(PORTE, 0UL, kPortMuxAlt2);
+
+    SPI_DRV_MasterInit(instance, &ext_master_state);
+    SPI_DRV_MasterConfigureBus(instance, &ext_master_config, &baud);
+
+    EXT_reset(instance);
+    OSA_TimeDelay(1);
+    EXT_unlock(instance);
+}
+
 void EXT_read_block(uint32_t instance, uint32_t address, uint8_t* buffer, uint32_t count)
 {
     uint8_t txbuff[4];
@@ -75,8 +109,8 @@ void EXT_write_block(uint32_t instance, uint32_t address, uint8_t* buffer, uint3
     while(count)
     {
         uint32_t towrite = count;
-        if(towrite > 256)
-            towrite = 256;
+        if(towrite > EXT_PAGE_SIZE)
+            towrite = EXT_PAGE_SIZE;
         count -= towrite;
 
         EXT_write_enable(instance, true);
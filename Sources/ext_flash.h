@@ -25,6 +25,13 @@
 
 #include "Cpu.h"
 
+#define EXT_PAGE_SIZE       (256)
+#define EXT_SECTOR_SIZE     (4096)
+#define EXT_EZPORT_WRITE_SIZE (16)  //smallest program of the user module's flash over EZPort
+
+#define EXT_STAGING         (1)     //flash on M2_SS, holds update images
+
+void EXT_init(uint32_t instance);
 void EXT_read_block(uint32_t instance, uint32_t address, uint8_t* buffer, uint32_t count);
 void EXT_write_block(uint32_t instance, uint32_t address, uint8_t* buffer, uint32_t count);
 void EXT_erase_sector(uint32_t instance, uint32_t address);
@@ -0,0 +1,314 @@
+/*
+  factory.c - factory programming over the modem LPUART
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "factory.h"
+
+#ifdef BOOT_FACTORY
+
+#include <string.h>
+#include <stddef.h>
+#include "lpuartUblox.h"
+#include "spiComEZPort.h"
+#include "boot.h"
+#include "stage.h"
+#include "sha256.h"
+#include "crc.h"
+#include "osa_timer.h"
+#include "arena.h"
+#include "periph.h"
+
+typedef struct
+{
+    factory_header_t header;
+    uint8_t payload[FACTORY_BLOCK + sizeof(uint16_t)];     //and the CRC
+}factory_frame_t;
+
+static factory_frame_t frame ARENA_UPDATE;
+static factory_open_t image ARENA_UPDATE;
+static stage_t stage ARENA_UPDATE;
+static sha256_t sha ARENA_UPDATE;
+static uint32_t image_dst;
+static uint32_t image_pos;
+static uint32_t image_start;
+static bool image_open;
+static bool user_entered;
+static bool nak_sent;
+static uint8_t next_seq;
+
+static bool FACTORY_Handshake(void)
+{
+    const char *sync = FACTORY_SYNC;
+    uint32_t matched = 0;
+    uint32_t start = OSA_TimeGetMsec();
+
+    while(OSA_TimeGetMsec() - start < FACTORY_LISTEN_MS)
+    {
+        if(!RING_available(&ublox_ring))
+            continue;
+        char c = (char)RING_pop(&ublox_ring);
+        matched = c == sync[matched] ? matched + 1 : (c == sync[0]);
+        if(matched == strlen(FACTORY_SYNC))
+            return true;
+    }
+    return false;
+}
+
+static void FACTORY_TxDone(void)
+{
+    while(!LPUART_HAL_GetStatusFlag(LPUART0, kLpuartTxComplete)) {}
+}
+
+static void FACTORY_Baud(void)
+{
+    //the sync reply goes out at the old rate
+    FACTORY_TxDone();
+    LPUART_HAL_SetTransmitterCmd(LPUART0, false);
+    LPUART_HAL_SetReceiverCmd(LPUART0, false);
+    LPUART_HAL_SetBaudRate(LPUART0, CLOCK_SYS_GetLpuartFreq(FSL_LPUARTUBLOX), FACTORY_BAUD);
+    LPUART_HAL_SetTransmitterCmd(LPUART0, true);
+    LPUART_HAL_SetReceiverCmd(LPUART0, true);
+    RING_flush(&ublox_ring);
+}
+
+static uint8_t FACTORY_Limit(void)
+{
+    uint32_t frames = 1;
+
+    if(image_open)
+    {
+        frames = FACTORY_WINDOW;
+        //internal flash programs with interrupts off, so nothing may be in
+        //flight then: credit ends with the frame that completes the unit
+        if(stage.target == STAGE_INTERNAL)
+        {
+            uint32_t left = stage.unit_size - ((image_dst + image_pos) & (stage.unit_size - 1));
+            left = (left + FACTORY_BLOCK - 1) / FACTORY_BLOCK;
+            if(left < frames)
+                frames = left;
+        }
+    }
+    return (uint8_t)(next_seq + frames);
+}
+
+static void FACTORY_Reply(uint8_t status, uint8_t type, uint32_t value)
+{
+    factory_reply_t reply;
+
+    reply.status = status;
+    reply.type = type;
+    reply.next = next_seq;
+    reply.limit = FACTORY_Limit();
+    reply.value = value;
+    reply.crc = CRC_crc16(CRC16_INIT, (uint8_t *)&reply, offsetof(factory_reply_t, crc));
+    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, (uint8_t *)&reply, sizeof(reply), 10);
+}
+
+static bool FACTORY_Receive(bool *idle)
+{
+    uint8_t *p = (uint8_t *)&frame.header;
+    uint16_t crc;
+
+    *idle = RING_get(&ublox_ring, (char *)p, 1, FACTORY_FRAME_MS) == 0;
+    if(*idle)
+        return false;
+    if(RING_get(&ublox_ring, (char *)p + 1, sizeof(factory_header_t) - 1, FACTORY_FRAME_MS) != sizeof(factory_header_t) - 1)
+        return false;
+    if(frame.header.size > FACTORY_BLOCK)
+        return false;
+
+    uint32_t rest = frame.header.size + sizeof(crc);
+    if(RING_get(&ublox_ring, (char *)frame.payload, rest, FACTORY_FRAME_MS) != rest)
+        return false;
+
+    memcpy(&crc, &frame.payload[frame.header.size], sizeof(crc));
+    return crc == CRC_crc16(CRC16_INIT, p, sizeof(factory_header_t) + frame.header.size);
+}
+
+static void FACTORY_Drain(void)
+{
+    //drop the rest of a damaged burst so the resend starts on a frame boundary
+    char c;
+    while(RING_get(&ublox_ring, &c, 1, FACTORY_QUIET_MS) == 1) {}
+}
+
+static uint8_t FACTORY_Open(void)
+{
+    uint32_t target = frame.header.arg;
+
+    image_open = false;
+    if(frame.header.size != sizeof(factory_open_t))
+        return FACTORY_FAIL;
+    memcpy(&image, frame.payload, sizeof(image));
+
+    if(target == BOOT_IMAGE_SYSTEM)
+    {
+        if(image.size > FSL_FEATURE_FLASH_PFLASH_BLOCK_SIZE * FSL_FEATURE_FLASH_PFLASH_BLOCK_COUNT - SYSTEM_APP_ADDRESS)
+            return FACTORY_FAIL;
+        image_dst = SYSTEM_APP_ADDRESS;
+        STAGE_init(&stage, STAGE_INTERNAL);
+    }
+    else if(target == BOOT_IMAGE_USERBOOT || target == BOOT_IMAGE_USER)
+    {
+        if(!user_entered)
+        {
+            BOOT_UserEnter();
+            user_entered = true;
+        }
+        image_dst = target == BOOT_IMAGE_USER ? USER_APP_ADDRESS : 0x0;
+        STAGE_init(&stage, FSL_SPICOMEZPORT);
+    }
+    else
+    {
+        return FACTORY_FAIL;
+    }
+
+    //vectors held back as for updates: a broken session leaves nothing runnable
+    STAGE_hold(&stage, image_dst);
+    SHA256_init(&sha);
+    image_pos = 0;
+    image_start = (uint32_t)OSA_TimeGetUsec();
+    image_open = true;
+    return FACTORY_ACK;
+}
+
+static uint8_t FACTORY_Data(void)
+{
+    uint32_t size = frame.header.size;
+
+    if(!image_open || frame.header.arg != image_pos || size > image.size - image_pos)
+    {
+        image_open = false;
+        return FACTORY_FAIL;
+    }
+    SHA256_update(&sha, frame.payload, size);
+    if(!STAGE_write(&stage, image_dst + image_pos, frame.payload, size))
+    {
+        image_open = false;
+        return FACTORY_FAIL;
+    }
+    image_pos += size;
+    return FACTORY_ACK;
+}
+
+static uint8_t FACTORY_Close(uint32_t *us)
+{
+    uint8_t actual[SHA256_DIGEST_SIZE];
+
+    if(!image_open)
+        return FACTORY_FAIL;
+    image_open = false;
+
+    if(image_pos != image.size || !STAGE_flush(&stage))
+        return FACTORY_FAIL;
+    SHA256_final(&sha, actual);
+    if(memcmp(actual, image.sha256, SHA256_DIGEST_SIZE) != 0)
+        return FACTORY_FAIL;
+    if(!STAGE_release(&stage))
+        return FACTORY_FAIL;
+
+    *us = (uint32_t)OSA_TimeGetUsec() - image_start;
+    return FACTORY_ACK;
+}
+
+void FACTORY_Task(void)
+{
+    //returns unless a fixture is asking for a session; never returns otherwise
+    PERIPH_init(PERIPH_UBLOX);
+    if(!FACTORY_Handshake())
+        return;
+
+    //the fixture is not the modem and gets no XON/XOFF
+    ublox_ring.high = 0;
+    LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, (const uint8_t *)FACTORY_SYNC_OK, strlen(FACTORY_SYNC_OK), 10);
+    FACTORY_Baud();
+
+    uint32_t last = OSA_TimeGetMsec();
+    for(;;)
+    {
+        bool idle;
+        if(!FACTORY_Receive(&idle))
+        {
+            if(!idle)
+            {
+                FACTORY_Drain();
+                FACTORY_Reply(FACTORY_NAK, 0, 0);
+                nak_sent = true;
+            }
+            else if(OSA_TimeGetMsec() - last > FACTORY_IDLE_MS)
+            {
+                break;
+            }
+            continue;
+        }
+        last = OSA_TimeGetMsec();
+
+        uint8_t ahead = frame.header.seq - next_seq;
+        if(ahead != 0)
+        {
+            //duplicates are acknowledged again; past a gap, one NAK per gap
+            if(ahead >= 0x80)
+            {
+                FACTORY_Reply(FACTORY_ACK, frame.header.type, 0);
+            }
+            else if(!nak_sent)
+            {
+                FACTORY_Reply(FACTORY_NAK, frame.header.type, 0);
+                nak_sent = true;
+            }
+            continue;
+        }
+        nak_sent = false;
+
+        uint32_t value = 0;
+        uint8_t status;
+        switch(frame.header.type)
+        {
+        case FACTORY_OPEN:
+            status = FACTORY_Open();
+            break;
+        case FACTORY_DATA:
+            status = FACTORY_Data();
+            break;
+        case FACTORY_CLOSE:
+            status = FACTORY_Close(&value);
+            break;
+        case FACTORY_RESET:
+            status = FACTORY_ACK;
+            break;
+        default:
+            status = FACTORY_FAIL;
+            break;
+        }
+        next_seq++;
+        FACTORY_Reply(status, frame.header.type, value);
+
+        if(frame.header.type == FACTORY_RESET)
+            break;
+    }
+
+    if(user_entered)
+        BOOT_UserExit();
+    FACTORY_TxDone();
+    NVIC_SystemReset();
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*
+  factory.h - factory programming over the modem LPUART
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_FACTORY_H_
+#define SOURCES_FACTORY_H_
+
+#include "Cpu.h"
+
+//factory builds only: images are checked against their SHA-256 but not signed
+//#define BOOT_FACTORY
+
+//Entered with WAKE_M2 held low and a fixture on the modem LPUART pins (modem
+//held off) repeating FACTORY_SYNC at 115200. The bootloader answers
+//FACTORY_SYNC_OK, and both sides move to FACTORY_BAUD.
+//
+//Host frames are a factory_header_t, size payload bytes, then a CRC-16
+//(CRC16_INIT, little endian) over header and payload. Every frame is
+//answered with a factory_reply_t:
+//  ACK   processed, or a duplicate of one already processed
+//  NAK   bad frame, or the first frame past a gap; resend from next
+//  FAIL  processed and the operation failed; the image is abandoned
+//The host may send frames up to, not including, limit without waiting.
+//OPEN, CLOSE and RESET are sent with nothing else in flight.
+#define FACTORY_SYNC        "KFAC"
+#define FACTORY_SYNC_OK     "KFOK"
+#define FACTORY_BAUD        (500000)    //exact from the 4 MHz MCGIRCLK, OSR 8
+#define FACTORY_BLOCK       (256)       //DATA payload, every frame but an image's last
+#define FACTORY_WINDOW      (4)         //frames in flight, well inside ublox_ring
+#define FACTORY_LISTEN_MS   (10)        //for FACTORY_SYNC before I2C mode starts
+#define FACTORY_FRAME_MS    (20)        //for the rest of a frame once it starts
+#define FACTORY_QUIET_MS    (2)         //line idle that ends a damaged burst
+#define FACTORY_IDLE_MS     (5000)      //without a frame, then reset
+
+#define FACTORY_OPEN        (0x01)      //arg BOOT_IMAGE_*, payload factory_open_t
+#define FACTORY_DATA        (0x02)      //arg offset in the image
+#define FACTORY_CLOSE       (0x03)      //reply value is the install time in us
+#define FACTORY_RESET       (0x04)      //release the user module and reset
+
+#define FACTORY_ACK         (0x06)
+#define FACTORY_NAK         (0x15)
+#define FACTORY_FAIL        (0x18)
+
+typedef struct __attribute__((packed))
+{
+    uint8_t  type;                      //FACTORY_OPEN...
+    uint8_t  seq;                       //per frame, wraps
+    uint16_t size;                      //payload bytes
+    uint32_t arg;
+}factory_header_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t size;
+    uint8_t  sha256[32];                //required
+}factory_open_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t  status;                    //FACTORY_ACK, FACTORY_NAK or FACTORY_FAIL
+    uint8_t  type;                      //of the frame answered, 0 if unreadable
+    uint8_t  next;                      //seq expected next
+    uint8_t  limit;                     //first seq the host may not send yet
+    uint32_t value;
+    uint16_t crc;                       //over the fields above
+}factory_reply_t;
+
+void FACTORY_Task(void);
+
+#endif /* SOURCES_FACTORY_H_ */
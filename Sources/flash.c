@@ -22,28 +22,42 @@
 
 #include "flash.h"
 
-#include <string.h>
-
 #include "flash1.h"
 
-#define LAUNCH_CMD_SIZE           0x100
 #define ONE_KB                    1024
 #define P_FLASH_SIZE            (FSL_FEATURE_FLASH_PFLASH_BLOCK_SIZE * FSL_FEATURE_FLASH_PFLASH_BLOCK_COUNT)
-pFLASHCOMMANDSEQUENCE g_FlashLaunchCommand = (pFLASHCOMMANDSEQUENCE)0xFFFFFFFF;
-uint16_t ramFunc[LAUNCH_CMD_SIZE/2];
+//FlashCommandSequence is linked into .ramfunc, no runtime relocation needed
+static const pFLASHCOMMANDSEQUENCE g_FlashLaunchCommand = FlashCommandSequence;
 
-void FLASH_init_ram(void)
+//mask the NVIC peripheral interrupts for the length of a flash command
+//rather than PRIMASK, so SysTick (a system exception, handled from RAM)
+//keeps the OSA timebase counting through a 14-17 ms erase or program
+static RAMFUNC uint32_t FLASH_mask_irqs(void)
 {
-    g_FlashLaunchCommand = (pFLASHCOMMANDSEQUENCE)RelocateFunction((uint32_t)ramFunc, LAUNCH_CMD_SIZE, (uint32_t)FlashCommandSequence);
+    uint32_t enabled;
+
+    __disable_irq();
+    enabled = NVIC->ISER[0];
+    NVIC->ICER[0] = enabled;
+    __DSB();
+    __ISB();
+    __enable_irq();
+    return enabled;
 }
 
-bool FLASH_erase_sector(uint32_t sector_address)
+static RAMFUNC void FLASH_unmask_irqs(uint32_t enabled)
+{
+    NVIC->ISER[0] = enabled;
+}
+
+RAMFUNC bool FLASH_erase_sector(uint32_t sector_address)
 {
     uint32_t result;
+    uint32_t enabled;
 
-    __disable_irq();
+    enabled = FLASH_mask_irqs();
     result = FlashEraseSector(&flash1_InitConfig0, sector_address, FTFx_PSECTOR_SIZE, g_FlashLaunchCommand);
-    __enable_irq();
+    FLASH_unmask_irqs(enabled);
 
 //    if(result != 0)
 //        printf("ERASE FAIL: %d\r\n", result);
@@ -51,15 +65,24 @@ bool FLASH_erase_sector(uint32_t sector_address)
     return result == 0;
 }
 
-bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size)
+RAMFUNC bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size)
 {
     uint32_t result;
+    uint32_t enabled;
 
-    __disable_irq();
+    enabled = FLASH_mask_irqs();
     result = FlashProgram(&flash1_InitConfig0, address, size, block,
             g_FlashLaunchCommand);
-    __enable_irq();
-    if(result == 0)
-        return memcmp(block, (void*)address, size) == 0;
-    return false;
+    FLASH_unmask_irqs(enabled);
+    if(result != 0)
+        return false;
+
+    //verify in place rather than calling memcmp from flash
+    const uint8_t *written = (const uint8_t *)address;
+    while(size--)
+    {
+        if(*written++ != *block++)
+            return false;
+    }
+    return true;
 }
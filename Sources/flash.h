@@ -25,8 +25,13 @@
 
 #include "Cpu.h"
 
-void FLASH_init_ram(void);
-bool FLASH_erase_sector(uint32_t sector_address);
-bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size);
+//place a function in the .ramfunc section, copied to RAM at startup
+//(see dash_system_boot.ld); long_call since RAM is out of BL range.
+//Calls back out to flash code are reached through linker veneers, so keep
+//them out of anything that runs while a flash command is in progress
+#define RAMFUNC __attribute__((section (".ramfunc"), long_call, noinline))
+
+RAMFUNC bool FLASH_erase_sector(uint32_t sector_address);
+RAMFUNC bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size);
 
 #endif /* SOURCES_FLASH_H_ */
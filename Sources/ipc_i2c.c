@@ -23,12 +23,19 @@
 
 #include <string.h>
 #include "i2cCom1.h"
+#include "lpuartUblox.h"
 #include "flash.h"
 #include "gpio1.h"
 #include "jump.h"
 #include "spiComEZPort.h"
 #include "ext_flash.h"
 #include "boot.h"
+#include "crc.h"
+#include "sched.h"
+#include "perf.h"
+#include "trace.h"
+#include "arena.h"
+#include "periph.h"
 
 #define STI2C_IDLE  0   // waiting
 #define STI2C_CMD   1   // receiving command
@@ -38,6 +45,13 @@
 #define CMDI2C_NONE                     0x00
 #define CMDI2C_READ_STATUS              0x01
 #define CMDI2C_WRITE_SYSTEM_BLOCK       0x02
+#define CMDI2C_HASH_BLOCKS              0x03
+#define CMDI2C_READ_HASHES              0x04
+#define CMDI2C_READ_PERF                0x05
+#define CMDI2C_READ_TRACE               0x06
+#define CMDI2C_USER_ENTER               0x07
+#define CMDI2C_WRITE_USER_BLOCK         0x08
+#define CMDI2C_USER_EXIT                0x09
 #define CMDI2C_USER_NOTIFY              0x22
 #define CMDI2C_RESET                    0x55
 #define CMDI2C_SYSTEMBOOT_VERSION       0x42
@@ -46,6 +60,28 @@
 #define FLAG_WRITE_SYSTEM           0x0001
 #define FLAG_RESET                  0x0004
 #define FLAG_USER_NOTIFY            0x0008
+#define FLAG_HASH_BLOCKS            0x0010
+#define FLAG_USER_ENTER             0x0020
+#define FLAG_WRITE_USER             0x0040
+#define FLAG_USER_EXIT              0x0080
+
+#define BLOCK_SIZE                  1024
+#define MAX_HASH_BLOCKS             64
+#ifndef USER_SLOTS
+#define USER_SLOTS                  2       //one receiving over I2C while the other programs
+#endif
+#define USER_HOLD_SIZE              EXT_EZPORT_WRITE_SIZE   //initial SP and reset vector, as one whole phrase
+#define USER_VERIFY_SIZE            64
+
+#define I2C_DMA_CHANNEL             0
+//DMAMUX0 request slot 22, I2C0 (KL17 reference manual, "DMA request sources");
+//the KSDK's kDmaRequestMux0I2C0 is in fsl_dma_request.h, not in this SDK
+#define I2C_DMA_SOURCE              22
+#ifndef I2C_DMA_MIN
+#define I2C_DMA_MIN                 16      //shorter payloads stay on the interrupt path
+#endif
+#define I2C_GLITCH_WIDTH            1       //bus clocks, within the 50ns Fm+ allows
+#define P_FLASH_SIZE                (FSL_FEATURE_FLASH_PFLASH_BLOCK_SIZE * FSL_FEATURE_FLASH_PFLASH_BLOCK_COUNT)
 
 
 typedef struct
@@ -74,6 +110,13 @@ typedef struct
     uint8_t block[1024];
 } i2c_block_t;
 
+typedef struct
+{
+    uint8_t block_hi;
+    uint8_t block_low;
+    uint8_t count;
+} i2c_hash_request_t;
+
 //typedef struct
 //{
 //    uint32_t size;
@@ -82,15 +125,94 @@ typedef struct
 
 static i2c_callback_data_t i2cCom1_UserData = { .command = CMDI2C_NONE, .state = STI2C_IDLE, };
 static volatile i2c_status_reg_u status = { .byte = 0 };
-static volatile i2c_block_t block;
+static volatile i2c_block_t block ARENA_I2C;
+static volatile i2c_hash_request_t hash_request ARENA_I2C;
+static uint32_t hashes[MAX_HASH_BLOCKS] ARENA_I2C;
+static uint32_t hash_count;
 //static volatile i2c_image_t load;
 //static volatile i2c_image_t save;
-static volatile uint32_t i_flag;
-static uint8_t tx_buffer[8];
-static uint8_t start_of_flash[PGM_SIZE_BYTE];
+static sched_task_t command_task;
+static sched_task_t blink_task;
+static uint8_t tx_buffer[8] ARENA_I2C;
+static uint8_t start_of_flash[PGM_SIZE_BYTE] ARENA_I2C;
 static bool write_on_reset = false;
+static volatile i2c_block_t user_block[USER_SLOTS] ARENA_I2C;
+static volatile uint32_t user_queued;   //slots waiting for the command task
+static uint32_t user_rx;                //slot the next user block lands in
+static uint32_t user_tx;                //slot the command task programs next
+static bool user_entered;
+static uint32_t user_erased;            //sector erased for the block before
+static uint8_t user_hold[2][USER_HOLD_SIZE] ARENA_I2C; //vectors at 0 and USER_APP_ADDRESS
+static bool user_held[2];
+static volatile bool dma_active;
 //static konekt_boot_flags_t boot_flags;
 
+static void i2cCom1_DmaStop(void)
+{
+    I2C_HAL_SetDmaCmd(I2C0, false);
+    DMA0->DMA[I2C_DMA_CHANNEL].DCR &= ~DMA_DCR_ERQ_MASK;
+    DMA0->DMA[I2C_DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    dma_active = false;
+}
+
+static void i2cCom1_DmaFinish(void)
+{
+    //the whole payload is in: finish the transfer the way the driver would
+    bool error = (DMA0->DMA[I2C_DMA_CHANNEL].DSR_BCR &
+            (DMA_DSR_BCR_CE_MASK | DMA_DSR_BCR_BES_MASK | DMA_DSR_BCR_BED_MASK)) != 0;
+
+    i2cCom1_DmaStop();
+    i2cCom1_SlaveState.isRxBusy = false;
+    i2cCom1_SlaveState.rxBuff = NULL;
+    if(error)
+        i2cCom1_UserData.state = STI2C_IDLE;
+    else
+        i2cCom1_Handler(kI2CSlaveRxFull);
+}
+
+static void i2cCom1_DmaIRQHandler(void)
+{
+    PERF_COUNT(PERF_I2C_IRQS, 1);
+    //the STOP may have been taken first and finished the block already
+    if(dma_active)
+        i2cCom1_DmaFinish();
+}
+
+static void i2cCom1_DmaInit(void)
+{
+    SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+    DMAMUX0->CHCFG[I2C_DMA_CHANNEL] = 0;
+    DMAMUX0->CHCFG[I2C_DMA_CHANNEL] = DMAMUX_CHCFG_SOURCE(I2C_DMA_SOURCE) | DMAMUX_CHCFG_ENBL_MASK;
+    OSA_InstallIntHandler(DMA0_IRQn, i2cCom1_DmaIRQHandler);
+    INT_SYS_EnableIRQ(DMA0_IRQn);
+}
+
+static void i2cCom1_Receive(uint8_t *buffer, uint32_t size)
+{
+    i2cCom1_UserData.state = STI2C_RX;
+    if(size < I2C_DMA_MIN)
+    {
+        i2cCom1_SlaveState.rxBuff = buffer;
+        i2cCom1_SlaveState.rxSize = size;
+        return;
+    }
+
+    //with DMAEN only byte completions go to the DMA; address, STOP and
+    //arbitration loss still interrupt, so the handler sees a short write.
+    //The slave still holds SCL low after each byte until D is read, only
+    //for a DMA transfer instead of the interrupt latency.
+    i2cCom1_SlaveState.rxSize = 0;
+    DMA0->DMA[I2C_DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    DMA0->DMA[I2C_DMA_CHANNEL].SAR = (uint32_t)&I2C0->D;
+    DMA0->DMA[I2C_DMA_CHANNEL].DAR = (uint32_t)buffer;
+    DMA0->DMA[I2C_DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_BCR(size);
+    DMA0->DMA[I2C_DMA_CHANNEL].DCR = DMA_DCR_EINT_MASK | DMA_DCR_ERQ_MASK | DMA_DCR_CS_MASK |
+            DMA_DCR_SSIZE(1) | DMA_DCR_DINC_MASK | DMA_DCR_DSIZE(1) | DMA_DCR_D_REQ_MASK;
+    dma_active = true;
+    I2C_HAL_SetDmaCmd(I2C0, true);
+}
+
 static void handle_command(void)
 {
     switch(i2cCom1_UserData.command)
@@ -127,18 +249,67 @@ static void handle_command(void)
         }
         else
         {
-            i2cCom1_UserData.state = STI2C_RX;
-            i2cCom1_SlaveState.rxBuff = (uint8_t*) &block;
-            i2cCom1_SlaveState.rxSize = sizeof(block);
+            i2cCom1_Receive((uint8_t*) &block, sizeof(block));
+        }
+        break;
+    case CMDI2C_WRITE_USER_BLOCK:
+        if(!user_entered || user_queued == USER_SLOTS)
+        {
+            i2cCom1_UserData.state = STI2C_IDLE;
+            i2cCom1_SlaveState.rxSize = 0;
+        }
+        else
+        {
+            i2cCom1_Receive((uint8_t*) &user_block[user_rx], sizeof(i2c_block_t));
+        }
+        break;
+    case CMDI2C_HASH_BLOCKS:
+        if(status.fields.busy)
+        {
+            i2cCom1_UserData.state = STI2C_IDLE;
+            i2cCom1_SlaveState.rxSize = 0;
+        }
+        else
+        {
+            i2cCom1_Receive((uint8_t*) &hash_request, sizeof(hash_request));
         }
         break;
+    case CMDI2C_READ_HASHES:
+        i2cCom1_UserData.state = STI2C_TX;
+        i2cCom1_SlaveState.txBuff = (const uint8_t*)hashes;
+        i2cCom1_SlaveState.txSize = hash_count * sizeof(uint32_t);
+        break;
+    case CMDI2C_READ_PERF:
+        i2cCom1_UserData.state = STI2C_TX;
+        i2cCom1_SlaveState.txBuff = (const uint8_t*)&perf;
+        i2cCom1_SlaveState.txSize = sizeof(perf);
+        break;
+#ifdef BOOT_TRACE
+    case CMDI2C_READ_TRACE:
+        //frozen from here so the read doesn't record itself
+        trace.paused = true;
+        i2cCom1_UserData.state = STI2C_TX;
+        i2cCom1_SlaveState.txBuff = (const uint8_t*)&trace;
+        i2cCom1_SlaveState.txSize = sizeof(trace);
+        break;
+#endif
     case CMDI2C_RESET:
         i2cCom1_UserData.state = STI2C_IDLE;
-        i_flag = FLAG_RESET;
+        SCHED_post(&command_task, FLAG_RESET);
         break;
     case CMDI2C_USER_NOTIFY:
         i2cCom1_UserData.state = STI2C_IDLE;
-        i_flag = FLAG_USER_NOTIFY;
+        SCHED_post(&command_task, FLAG_USER_NOTIFY);
+        break;
+    case CMDI2C_USER_ENTER:
+        i2cCom1_UserData.state = STI2C_IDLE;
+        user_entered = true;
+        SCHED_post(&command_task, FLAG_USER_ENTER);
+        break;
+    case CMDI2C_USER_EXIT:
+        i2cCom1_UserData.state = STI2C_IDLE;
+        user_entered = false;
+        SCHED_post(&command_task, FLAG_USER_EXIT);
         break;
     }
 }
@@ -148,9 +319,25 @@ static void handle_receive(void)
     switch(i2cCom1_UserData.command)
     {
     case CMDI2C_WRITE_SYSTEM_BLOCK:
+        TRACE_block(TRACE_I2C_RX, (const uint8_t*)&block, sizeof(block));
         status.fields.busy = 1; //no more writes until this one completes
         i2cCom1_UserData.state = STI2C_IDLE;
-        i_flag = FLAG_WRITE_SYSTEM;
+        SCHED_post(&command_task, FLAG_WRITE_SYSTEM);
+        break;
+    case CMDI2C_WRITE_USER_BLOCK:
+        TRACE_block(TRACE_I2C_RX, (const uint8_t*)&user_block[user_rx], sizeof(i2c_block_t));
+        user_rx = (user_rx + 1) % USER_SLOTS;
+        user_queued++;
+        if(user_queued == USER_SLOTS)
+            status.fields.busy = 1; //no more writes until a slot frees
+        i2cCom1_UserData.state = STI2C_IDLE;
+        SCHED_post(&command_task, FLAG_WRITE_USER);
+        break;
+    case CMDI2C_HASH_BLOCKS:
+        TRACE_block(TRACE_I2C_RX, (const uint8_t*)&hash_request, sizeof(hash_request));
+        status.fields.busy = 1; //hashes are valid once busy clears
+        i2cCom1_UserData.state = STI2C_IDLE;
+        SCHED_post(&command_task, FLAG_HASH_BLOCKS);
         break;
 //    case CMDI2C_WRITE_EXTERNAL:
 //        status.fields.busy = 1;
@@ -162,12 +349,17 @@ static void handle_receive(void)
 
 void i2cCom1_Handler(i2c_slave_event_t slaveEvent)
 {
+    TRACE_byte(TRACE_I2C_EVENT, slaveEvent);
+
     switch(slaveEvent)
     {
     // Transmit request
     case kI2CSlaveTxReq:
         if(i2cCom1_UserData.state == STI2C_TX)
+        {
+            TRACE_byte(TRACE_I2C_TX, i2cCom1_SlaveState.txSize);
             i2cCom1_SlaveState.isTxBusy = true;
+        }
         else
         {
             i2cCom1_UserData.state = STI2C_IDLE;
@@ -194,118 +386,256 @@ void i2cCom1_Handler(i2c_slave_event_t slaveEvent)
         // Receive buffer is full
     case kI2CSlaveRxFull:
         if(i2cCom1_UserData.state == STI2C_CMD)
+        {
+            PERF_COUNT(PERF_I2C_COMMANDS, 1);
+            TRACE_byte(TRACE_I2C_RX, i2cCom1_UserData.command);
             handle_command();
+        }
         else
             handle_receive();
         break;
 
+        // STOP during a DMA receive: with DONE set the last byte and the STOP
+        // were pending together and the block is whole, otherwise the master
+        // sent a short payload
+    case kI2CSlaveStopDetect:
+        if(dma_active)
+        {
+            if(DMA0->DMA[I2C_DMA_CHANNEL].DSR_BCR & DMA_DSR_BCR_DONE_MASK)
+                i2cCom1_DmaFinish();
+            else
+            {
+                i2cCom1_DmaStop();
+                i2cCom1_UserData.state = STI2C_IDLE;
+            }
+        }
+        break;
+
     default:
         break;
     }
 }
 
-void i2cCom1_Task(void)
+static bool i2cCom1_WriteUser(volatile i2c_block_t *b)
 {
-    uint32_t next_toggle = OSA_TimeGetMsec();
-    uint32_t toggle_count = 0;
-
-    GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalOutput);
-    GPIO_DRV_ClearPinOutput(M1_RESET);
-    GPIO_DRV_SetPinOutput(WAKE_M1);
-    GPIO_DRV_SetPinDir(WAKE_M2, kGpioDigitalOutput);
-    GPIO_DRV_ClearPinOutput(WAKE_M2);
-    OSA_TimeDelay(10);
-    GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalInput);
-    OSA_TimeDelay(100);
-    GPIO_DRV_SetPinDir(WAKE_M2, kGpioDigitalInput);
+    //blocks in ascending order: each sector is erased by its first block
+    uint32_t address = ((b->block_hi << 8) | b->block_low) * BLOCK_SIZE;
+    uint32_t sector = address & ~(EXT_SECTOR_SIZE - 1);
+    uint8_t *data = (uint8_t*) b->block;
+    uint8_t verify[USER_VERIFY_SIZE];
+    uint32_t skip = 0;
+    uint32_t start;
+
+    if(sector != user_erased)
+    {
+        start = PERF_start();
+        EXT_erase_sector(FSL_SPICOMEZPORT, sector);
+        PERF_stop(PERF_EXT_ERASE, start);
+        user_erased = sector;
+    }
 
-    FLASH_init_ram();
+    //as for the system block 0: an image can't start until USER_EXIT
+    if(address == 0 || address == USER_APP_ADDRESS)
+    {
+        uint32_t image = address != 0;
+        memcpy(user_hold[image], data, USER_HOLD_SIZE);
+        user_held[image] = true;
+        skip = USER_HOLD_SIZE;
+    }
 
-    //memset(&boot_flags, 0xFF, sizeof(boot_flags));
+    start = PERF_start();
+    EXT_write_block(FSL_SPICOMEZPORT, address + skip, data + skip, BLOCK_SIZE - skip);
+    PERF_stop(PERF_EXT_PROGRAM, start);
 
-    for(;;)
+    for(uint32_t i = skip; i < BLOCK_SIZE; i += USER_VERIFY_SIZE)
     {
-        if(next_toggle < OSA_TimeGetMsec())
-        {
-            next_toggle += 100;
-            GPIO_DRV_WritePinOutput(WAKE_M1,
-                    toggle_count == 4 || toggle_count == 7);
-            toggle_count++;
-            if(toggle_count >= 10) toggle_count = 0;
-        }
+        uint32_t n = BLOCK_SIZE - i < USER_VERIFY_SIZE ? BLOCK_SIZE - i : USER_VERIFY_SIZE;
+        EXT_read_block(FSL_SPICOMEZPORT, address + i, verify, n);
+        if(memcmp(verify, data + i, n) != 0)
+            return false;
+    }
+    return true;
+}
 
-        uint32_t flag = 0;
-        i2c_status_reg_u result = { .byte = 0 };
+static void i2cCom1_Blink(sched_task_t *task, uint32_t events)
+{
+    static uint32_t toggle_count = 0;
 
-        if(i_flag)
-        {
-            INT_SYS_DisableIRQ(I2C0_IRQn);
-            flag = i_flag;
-            i_flag = 0;
-            INT_SYS_EnableIRQ(I2C0_IRQn);
+    GPIO_DRV_WritePinOutput(WAKE_M1,
+            toggle_count == 4 || toggle_count == 7);
+    toggle_count++;
+    if(toggle_count >= 10) toggle_count = 0;
+    SCHED_wake(task, task->wake_ms + 100);
+}
 
-            if(flag == FLAG_USER_NOTIFY)
-            {
-            }
-            if(flag == FLAG_WRITE_SYSTEM)
+static void i2cCom1_Command(sched_task_t *task, uint32_t events)
+{
+    static uint32_t flag;
+    static i2c_status_reg_u result;
+
+    PT_BEGIN(task);
+
+    flag = events;
+    result.byte = 0;
+
+    if(flag & FLAG_USER_NOTIFY)
+    {
+    }
+    if(flag & FLAG_WRITE_SYSTEM)
+    {
+        //write the block to the internal flash
+        result.fields.error = 1;
+        uint32_t address = (((block.block_hi << 8) | block.block_low)
+                * 1024) + SYSTEM_APP_ADDRESS;
+        if(FLASH_erase_sector(address))
+        {
+            if(block.block_hi == 0 && block.block_low == 0)
             {
-                //write the block to the internal flash
-                result.fields.error = 1;
-                uint32_t address = (((block.block_hi << 8) | block.block_low)
-                        * 1024) + SYSTEM_APP_ADDRESS;
-                if(FLASH_erase_sector(address))
+                //skip the first write of the first block until finished
+                memcpy(&start_of_flash, (uint8_t*) block.block,
+                        PGM_SIZE_BYTE);
+                if(FLASH_write_block(address + PGM_SIZE_BYTE,
+                        ((uint8_t*) block.block) + PGM_SIZE_BYTE,
+                        1024 - PGM_SIZE_BYTE))
                 {
-                    if(block.block_hi == 0 && block.block_low == 0)
-                    {
-                        //skip the first write of the first block until finished
-                        memcpy(&start_of_flash, (uint8_t*) block.block,
-                                PGM_SIZE_BYTE);
-                        if(FLASH_write_block(address + PGM_SIZE_BYTE,
-                                ((uint8_t*) block.block) + PGM_SIZE_BYTE,
-                                1024 - PGM_SIZE_BYTE))
-                        {
-                            result.fields.error = 0;
-                            write_on_reset = true;
-                        }
-                    }
-                    else if(FLASH_write_block(address, (uint8_t*) block.block,
-                            1024))
-                    {
-                        result.fields.error = 0;
-                    }
+                    result.fields.error = 0;
+                    write_on_reset = true;
                 }
             }
-//            if(flag == FLAG_SETUP_WRITE_EXTERNAL)
-//            {
-//                //start ublox write
-//                result.fields.error = BOOT_SetupUbloxWrite(load.filename, load.size);
-//            }
-//            if(flag == FLAG_WRITE_EXTERNAL)
-//            {
-//                //continue write to ublox (not spi)
-//                result.fields.error = BOOT_ContinueUbloxWrite((uint8_t*)block.block, load.size < 1024 ? load.size : 1024);
-//            }
-
+            else if(FLASH_write_block(address, (uint8_t*) block.block,
+                    1024))
+            {
+                result.fields.error = 0;
+            }
+        }
+    }
+    if(flag & FLAG_HASH_BLOCKS)
+    {
+        //one hash per 1KB block of the system app so the host can
+        //diff against its new image and send only changed blocks
+        uint32_t first = (hash_request.block_hi << 8) | hash_request.block_low;
+        uint32_t count = hash_request.count;
+        uint32_t address = first * BLOCK_SIZE + SYSTEM_APP_ADDRESS;
+
+        hash_count = 0;
+        if(count > 0 && count <= MAX_HASH_BLOCKS &&
+           address + count * BLOCK_SIZE <= P_FLASH_SIZE)
+        {
+            for(; hash_count < count; hash_count++, address += BLOCK_SIZE)
+                hashes[hash_count] = CRC_hash32((const uint32_t *)address, BLOCK_SIZE / sizeof(uint32_t));
+        }
+        else
+        {
+            result.fields.error = 1;
+        }
+    }
+    if(flag & FLAG_USER_ENTER)
+    {
+        //hold the user module in EZPort for WRITE_USER_BLOCK, sleeping
+        //through the reset pulse so the other tasks keep running
+        BOOT_UserEnterStep(0);
+        PT_SLEEP(task, BOOT_USER_RESET_MS);
+        BOOT_UserEnterStep(1);
+        PT_SLEEP(task, BOOT_USER_RESET_MS);
+        BOOT_UserEnterStep(2);
+        user_erased = BOOT_FLAG_ERASED;
+        user_held[0] = user_held[1] = false;
+    }
+    if(flag & FLAG_WRITE_USER)
+    {
+        //the handler fills the other slot meanwhile, so keep going until both are drained
+        while(user_queued)
+        {
+            if(!i2cCom1_WriteUser(&user_block[user_tx]))
+                result.fields.error = 1;
+            user_tx = (user_tx + 1) % USER_SLOTS;
             INT_SYS_DisableIRQ(I2C0_IRQn);
-            status.byte = result.byte;
+            INT_SYS_DisableIRQ(DMA0_IRQn);
+            if(user_queued-- == USER_SLOTS)
+                status.fields.busy = 0;
+            INT_SYS_EnableIRQ(DMA0_IRQn);
             INT_SYS_EnableIRQ(I2C0_IRQn);
+        }
+    }
+    if(flag & FLAG_USER_EXIT)
+    {
+        //vectors last, then run the new images
+        for(uint32_t image = 0; image < 2; image++)
+        {
+            if(user_held[image])
+                EXT_write_block(FSL_SPICOMEZPORT, image ? USER_APP_ADDRESS : 0, user_hold[image], USER_HOLD_SIZE);
+            user_held[image] = false;
+        }
+        BOOT_UserExitStep(0);
+        PT_SLEEP(task, BOOT_USER_RESET_MS);
+        BOOT_UserExitStep(1);
+        PT_SLEEP(task, BOOT_USER_RESET_MS); //out of reset, and into run mode, before EZPCS toggles below
+    }
+//    if(flag == FLAG_SETUP_WRITE_EXTERNAL)
+//    {
+//        //start ublox write
+//        result.fields.error = BOOT_SetupUbloxWrite(load.filename, load.size);
+//    }
+//    if(flag == FLAG_WRITE_EXTERNAL)
+//    {
+//        //continue write to ublox (not spi)
+//        result.fields.error = BOOT_ContinueUbloxWrite((uint8_t*)block.block, load.size < 1024 ? load.size : 1024);
+//    }
+
+    INT_SYS_DisableIRQ(I2C0_IRQn);
+    INT_SYS_DisableIRQ(DMA0_IRQn);
+    //a system block that arrived while user blocks programmed is still queued
+    result.fields.busy = user_queued == USER_SLOTS || (task->events & FLAG_WRITE_SYSTEM);
+    status.byte = result.byte;
+    INT_SYS_EnableIRQ(DMA0_IRQn);
+    INT_SYS_EnableIRQ(I2C0_IRQn);
+
+    GPIO_DRV_ClearPinOutput(M1_EZPCS);
+    PT_SLEEP(task, 1);
+
+    if(flag & FLAG_RESET)
+    {
+        if(write_on_reset)
+            FLASH_write_block(SYSTEM_APP_ADDRESS, start_of_flash, PGM_SIZE_BYTE);
+//        if(boot_flags.special_code == 0)
+//        {
+//            BOOT_WriteFlags(&boot_flags, BOOT_SPECIAL_UBLOX);
+//        }
+        PT_SLEEP(task, 10);
+        NVIC_SystemReset();
+    }
 
-            GPIO_DRV_ClearPinOutput(M1_EZPCS);
-            OSA_TimeDelay(1);
+    GPIO_DRV_SetPinOutput(M1_EZPCS);
 
-            if(flag == FLAG_RESET)
-            {
-                if(write_on_reset)
-                    FLASH_write_block(SYSTEM_APP_ADDRESS, start_of_flash, PGM_SIZE_BYTE);
-//                if(boot_flags.special_code == 0)
-//                {
-//                    BOOT_WriteFlags(&boot_flags, BOOT_SPECIAL_UBLOX);
-//                }
-                OSA_TimeDelay(10);
-                NVIC_SystemReset();
-            }
+    PT_END(task);
+}
 
-            GPIO_DRV_SetPinOutput(M1_EZPCS);
-        }
-    }
+void i2cCom1_Task(void)
+{
+    //the modem ring's buffer shares the arena with this mode's buffers; stop
+    //the receiver before the slave can start filling them
+    PERIPH_deinit(PERIPH_UBLOX);
+    PERIPH_init(PERIPH_I2C);
+
+    GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalOutput);
+    GPIO_DRV_ClearPinOutput(M1_RESET);
+    GPIO_DRV_SetPinOutput(WAKE_M1);
+    GPIO_DRV_SetPinDir(WAKE_M2, kGpioDigitalOutput);
+    GPIO_DRV_ClearPinOutput(WAKE_M2);
+    OSA_TimeDelay(10);
+    GPIO_DRV_SetPinDir(M1_RESET, kGpioDigitalInput);
+    OSA_TimeDelay(100);
+    GPIO_DRV_SetPinDir(WAKE_M2, kGpioDigitalInput);
+
+    //memset(&boot_flags, 0xFF, sizeof(boot_flags));
+
+    //block payloads arrive by DMA; high drive and a short glitch filter for Fast-mode Plus
+    i2cCom1_DmaInit();
+    I2C_HAL_SetHighDriveCmd(I2C0, true);
+    I2C_HAL_SetGlitchWidth(I2C0, I2C_GLITCH_WIDTH);
+
+    SCHED_add(&blink_task, i2cCom1_Blink);
+    SCHED_add(&command_task, i2cCom1_Command);
+    SCHED_sleep(&blink_task, 0);
+    SCHED_run();
 }
@@ -20,7 +20,15 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "Cpu.h"
+#include "gpio1.h"
 #include "boot.h"
+#include "jump.h"
+
+//#define BOOT_PROFILE
+
+extern void SystemInit(void);
+extern void init_data_bss(void);
+extern void _start(void);
 
 __attribute__( ( always_inline ) ) __STATIC_INLINE void __set_PC(uint32_t resetHandler)
 {
@@ -35,17 +43,68 @@ bool JUMP_IsValid(void)
     return (*pSP > 0x1FFFE000 && *pSP <= 0x20006000 && *pPC > SYSTEM_APP_ADDRESS && *pPC < 0x00040000);
 }
 
+__attribute__( ( always_inline ) ) __STATIC_INLINE void JUMP_Start(void)
+{
+    uint32_t *pSP = (uint32_t*)(SYSTEM_APP_ADDRESS);
+    uint32_t *pPC = (uint32_t*)(SYSTEM_APP_ADDRESS+4);
+    __disable_irq();
+    __DMB();
+    SCB->VTOR = SYSTEM_APP_ADDRESS;
+    __DSB();
+    __set_MSP(*pSP);
+    __set_PC(*pPC);
+}
+
 void JUMP_ToApp(void)
 {
     if(JUMP_IsValid())
-    {
-        uint32_t *pSP = (uint32_t*)(SYSTEM_APP_ADDRESS);
-        uint32_t *pPC = (uint32_t*)(SYSTEM_APP_ADDRESS+4);
-        __disable_irq();
-        __DMB();
-        SCB->VTOR = SYSTEM_APP_ADDRESS;
-        __DSB();
-        __set_MSP(*pSP);
-        __set_PC(*pPC);
-    }
+        JUMP_Start();
+}
+
+//Runs before SystemInit and the .data/.bss copy, so it may only touch
+//registers, flash and locals.  Any reason to stay in the bootloader
+//(boot flag written, WAKE_M2 held low, no valid app) falls back to
+//the normal startup path and main().
+static bool JUMP_FastPath(void)
+{
+    konekt_boot_flags_t *boot_flags = (konekt_boot_flags_t *)BOOT_FLAG_ADDRESS;
+
+#ifdef IN_DEBUG
+    //main.c takes WAKE_M2 as held; so does this
+    return false;
+#endif
+    if(boot_flags->special_code != BOOT_FLAG_ERASED)
+        return false;
+
+    if(!JUMP_IsValid())
+        return false;
+
+    //WAKE_M2 as GPIO input with pull-up, same as wakem2_input_config in main.c
+    SIM->SCGC5 |= SIM_SCGC5_PORTC_MASK;
+    PORTC->PCR[GPIO_EXTRACT_PIN(WAKE_M2)] = PORT_PCR_MUX(1) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK;
+    //let the internal pull-up charge the pin before sampling
+    for(volatile uint32_t settle = 16; settle; settle--);
+
+    return (PTC->PDIR & (1U << GPIO_EXTRACT_PIN(WAKE_M2))) != 0;
+}
+
+void Reset_Handler(void)
+{
+    __disable_irq();
+#ifdef BOOT_PROFILE
+    //free-running 24-bit core clock counter, left running for the
+    //application: reset-to-app cycles = 0xFFFFFF - SysTick->VAL
+    SysTick->CTRL = 0;
+    SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+#endif
+
+    if(JUMP_FastPath())
+        JUMP_Start();
+
+    SystemInit();
+    init_data_bss();
+    __enable_irq();
+    _start();
 }
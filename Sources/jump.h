@@ -23,6 +23,10 @@
 #ifndef SOURCES_JUMP_H_
 #define SOURCES_JUMP_H_
 
+//stay in the bootloader as if WAKE_M2 were held; main.c and the fast path
+//in Reset_Handler both go by it
+//#define IN_DEBUG
+
 typedef struct
 {
     uint32_t packet_id;
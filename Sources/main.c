@@ -40,8 +40,9 @@
 #include "ipc_i2c.h"
 #include "jump.h"
 #include "boot.h"
-
-//#define IN_DEBUG
+#include "periph.h"
+#include "trace.h"
+#include "factory.h"
 
 static const gpio_input_pin_user_config_t wakem2_input_config = {
     .pinName = WAKE_M2,
@@ -56,6 +57,7 @@ int main(void)
 /*lint -restore Enable MISRA rule (6.3) checking. */
 {
   /* Write your local variable definition here */
+    //normal boots have already left through the fast path in Reset_Handler (jump.c)
     GPIO_DRV_InputPinInit(&wakem2_input_config);
 #ifdef IN_DEBUG
     bool wake_m2_pressed = true;
@@ -71,8 +73,16 @@ int main(void)
     }
 
   /*** Processor Expert internal initialization. DON'T REMOVE THIS CODE!!! ***/
-  PE_low_level_init();
+  //PE_low_level_init() by units, skipping any BOOT_CheckFlag already brought up;
+  //the modem UART and the I2C slave fill buffers that share the arena, so
+  //the factory session and i2cCom1_Task each bring up their own
+  PERIPH_init(PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT);
   /*** End of Processor Expert internal initialization.                    ***/
+  TRACE_init();
+#ifdef BOOT_FACTORY
+  if(wake_m2_pressed)
+      FACTORY_Task(); //doesn't return if a fixture answers
+#endif
   i2cCom1_Task();
 
 
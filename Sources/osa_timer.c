@@ -21,11 +21,29 @@
 */
 
 #include "Cpu.h"
+#include "osa_timer.h"
+#include "flash.h"
 
 /* Timer period */
 #define OSA1_TIMER_PERIOD_US           1000U
 /* Software ISR counter */
 static volatile uint32_t SwTimerIsrCounter = 0U;
+/* Upper half of the 64-bit millisecond count */
+static volatile uint32_t SwTimerIsrWraps = 0U;
+/* SysTick counts per microsecond */
+static uint32_t SysTickPerUsec = 1U;
+
+//in RAM with SysTick_Handler: the tick keeps running while flash
+//commands hold the NVIC interrupts off (see flash.c)
+static RAMFUNC void OSA_TimeAdvance(uint32_t ms)
+{
+    uint32_t before = SwTimerIsrCounter;
+
+    SwTimerIsrCounter = before + ms;
+    if (SwTimerIsrCounter < before) {
+        SwTimerIsrWraps++;
+    }
+}
 
 /*
 ** ===================================================================
@@ -36,9 +54,9 @@ static volatile uint32_t SwTimerIsrCounter = 0U;
 **         This method is internal. It is used by Processor Expert only.
 ** ===================================================================
 */
-void SysTick_Handler(void)
+RAMFUNC void SysTick_Handler(void)
 {
-	SwTimerIsrCounter++;
+	OSA_TimeAdvance(1U);
 }
 
 /*
@@ -69,6 +87,10 @@ void OSA_TimeInit(void)
     assert(divider != 0U);
     /* Set divide input clock of systick timer */
     SysTick->LOAD = (uint32_t)(divider - 1U);
+    SysTickPerUsec = (uint32_t)(divider / OSA1_TIMER_PERIOD_US);
+    if (SysTickPerUsec == 0U) {
+        SysTickPerUsec = 1U;
+    }
     /* Set interrupt priority and enable interrupt */
     NVIC_SetPriority(SysTick_IRQn, 1U);
     /* Run timer and enable interrupt */
@@ -108,3 +130,155 @@ uint32_t OSA_TimeGetMsec(void)
 {
     return (SwTimerIsrCounter);
 }
+
+/*
+** ===================================================================
+**     Method      :  OSA_TimeIdle
+**
+**     Description :
+**         Sleeps with WFI for up to ms milliseconds, stretching the
+**         SysTick period so the core isn't woken every tick, and
+**         returns on the deadline or any other interrupt. Called with
+**         interrupts disabled so nothing posted before the WFI is
+**         missed; the time asleep is credited to the millisecond count.
+** ===================================================================
+*/
+void OSA_TimeIdle(uint32_t ms)
+{
+    uint32_t period = SysTick->LOAD + 1U;
+    uint32_t max_ms = (SysTick_LOAD_RELOAD_Msk + 1U) / period;
+    uint32_t first;
+    uint32_t stretch;
+    uint32_t elapsed;
+    uint32_t rest;
+    uint32_t ctrl;
+
+    if (ms > max_ms) {
+        ms = max_ms;
+    }
+    if (ms < 2U) {
+        /* The next tick is the deadline anyway */
+        __WFI();
+        return;
+    }
+
+    /* Cycles left in the current tick, then ms - 1 whole ticks */
+    first = SysTick->VAL;
+    stretch = first + (ms - 1U) * period;
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = stretch - 1U;
+    SysTick->VAL = 0U;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    __WFI();
+
+    /* Reading CTRL clears COUNTFLAG, so only once */
+    ctrl = SysTick->CTRL;
+    SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+    if (ctrl & SysTick_CTRL_COUNTFLAG_Msk) {
+        /* Ran to the deadline; the pending tick interrupt adds the last ms */
+        OSA_TimeAdvance(ms - 1U);
+        rest = period;
+    } else {
+        elapsed = stretch - 1U - SysTick->VAL;
+        if (elapsed < first) {
+            rest = first - elapsed;
+        } else {
+            elapsed -= first;
+            OSA_TimeAdvance(1U + elapsed / period);
+            rest = period - elapsed % period;
+        }
+    }
+
+    /* Finish the tick we woke in, then back to whole ticks */
+    SysTick->LOAD = rest - 1U;
+    SysTick->VAL = 0U;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = period - 1U;
+}
+
+/*
+** ===================================================================
+**     Method      :  OSA_TimeGetTicks
+**
+**     Description :
+**         Reads the 64-bit millisecond count and the SysTick counts
+**         into the current millisecond as one consistent pair. A tick
+**         that has wrapped but whose interrupt hasn't run yet is
+**         counted here instead, with SysTick re-read after the wrap.
+** ===================================================================
+*/
+static void OSA_TimeGetTicks(uint64_t *ms, uint32_t *counts)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t val;
+
+    __disable_irq();
+    lo = SwTimerIsrCounter;
+    hi = SwTimerIsrWraps;
+    val = SysTick->VAL;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        val = SysTick->VAL;
+        if (++lo == 0U) {
+            hi++;
+        }
+    }
+    __set_PRIMASK(primask);
+
+    *ms = ((uint64_t)hi << 32) | lo;
+    *counts = SysTick->LOAD - val;
+}
+
+/*
+** ===================================================================
+**     Method      :  OSA_TimeGetCycles
+**
+**     Description :
+**         Monotonic SysTick counts (core cycles) since OSA_TimeInit.
+** ===================================================================
+*/
+uint64_t OSA_TimeGetCycles(void)
+{
+    uint64_t ms;
+    uint32_t counts;
+
+    OSA_TimeGetTicks(&ms, &counts);
+    return ms * (SysTick->LOAD + 1U) + counts;
+}
+
+/*
+** ===================================================================
+**     Method      :  OSA_TimeGetUsec
+**
+**     Description :
+**         Monotonic microseconds since OSA_TimeInit, using only a
+**         32-bit divide since the M0+ has no divider of its own.
+** ===================================================================
+*/
+uint64_t OSA_TimeGetUsec(void)
+{
+    uint64_t ms;
+    uint32_t counts;
+
+    OSA_TimeGetTicks(&ms, &counts);
+    return ms * OSA1_TIMER_PERIOD_US + counts / SysTickPerUsec;
+}
+
+/*
+** ===================================================================
+**     Method      :  OSA_TimeDelayUsec
+**
+**     Description :
+**         Busy-waits until usec microseconds from now. Needs the tick
+**         interrupt enabled for delays over a millisecond.
+** ===================================================================
+*/
+void OSA_TimeDelayUsec(uint32_t usec)
+{
+    uint64_t deadline = OSA_TimeGetUsec() + usec;
+
+    while (OSA_TimeGetUsec() < deadline) {
+    }
+}
@@ -0,0 +1,59 @@
+/*
+  perf.c - update performance counters
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "perf.h"
+
+#include "flash.h"
+#include "osa_timer.h"
+
+perf_t perf = {
+        .magic = PERF_MAGIC,
+        .version = PERF_VERSION,
+        .counters = PERF_COUNTERS,
+        .timers = PERF_TIMERS,
+};
+
+uint32_t PERF_start(void)
+{
+    return (uint32_t)OSA_TimeGetUsec();
+}
+
+void PERF_stop(perf_timer_t id, uint32_t start)
+{
+    perf_stat_t *stat = &perf.timer[id];
+    uint32_t us = (uint32_t)OSA_TimeGetUsec() - start;
+
+    if(stat->count == 0 || us < stat->min_us)
+        stat->min_us = us;
+    if(us > stat->max_us)
+        stat->max_us = us;
+    stat->sum_us += us;
+    stat->count++;
+}
+
+bool PERF_save(uint32_t address)
+{
+    //replaces the previous record, whole program phrases only
+    return FLASH_erase_sector(address) &&
+           FLASH_write_block(address, (uint8_t *)&perf,
+            (sizeof(perf) + PGM_SIZE_BYTE - 1) & ~(PGM_SIZE_BYTE - 1));
+}
@@ -0,0 +1,85 @@
+/*
+  perf.h - update performance counters
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_PERF_H_
+#define SOURCES_PERF_H_
+
+#include "Cpu.h"
+
+#define PERF_MAGIC          (0x46524550) //'PERF'
+#define PERF_VERSION        (1)
+
+//append only; the application and host decoders index by position
+typedef enum
+{
+    PERF_UBLOX_BYTES,       //image bytes read from the ublox file system
+    PERF_SPI_BYTES,         //from the staging flash
+    PERF_HTTP_BYTES,        //over HTTP
+    PERF_READ_RETRIES,      //failed chunk reads that were retried
+    PERF_RING_OVERRUNS,     //bytes ublox_ring dropped
+    PERF_RING_STALLS,       //times the modem was sent XOFF
+    PERF_I2C_COMMANDS,      //I2C command bytes received
+    PERF_I2C_IRQS,          //I2C and I2C DMA interrupts taken, per byte without DMA
+    PERF_COUNTERS
+}perf_counter_t;
+
+typedef enum
+{
+    PERF_FLASH_ERASE,       //internal sector erase
+    PERF_FLASH_PROGRAM,     //internal sector program
+    PERF_EXT_ERASE,         //EZPort or SPI flash sector erase
+    PERF_EXT_PROGRAM,       //EZPort or SPI flash page program
+    PERF_PHASE_MODEM,       //waiting for the modem to answer
+    PERF_PHASE_SYSTEM,      //fetching and installing the system image
+    PERF_PHASE_USER,        //fetching and installing the user images
+    PERF_PHASE_UPDATE,      //flag seen to flag erased
+    PERF_TIMERS
+}perf_timer_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t sum_us;
+    uint32_t min_us;
+    uint32_t max_us;
+}perf_stat_t;
+
+typedef struct
+{
+    uint32_t magic;         //marks a saved record at BOOT_PERF_ADDRESS
+    uint8_t  version;
+    uint8_t  counters;
+    uint8_t  timers;
+    uint8_t  pad;
+    uint32_t counter[PERF_COUNTERS];
+    perf_stat_t timer[PERF_TIMERS];
+}perf_t;
+
+extern perf_t perf;
+
+#define PERF_COUNT(id, n)   (perf.counter[id] += (n))
+
+uint32_t PERF_start(void);
+void PERF_stop(perf_timer_t id, uint32_t start);
+bool PERF_save(uint32_t address);
+
+#endif /* SOURCES_PERF_H_ */
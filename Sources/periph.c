@@ -0,0 +1,105 @@
+/*
+  periph.c - on-demand peripheral bring-up
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "periph.h"
+
+#include "arena.h"
+#include "Events.h"
+#include "pin_mux.h"
+#include "osa1.h"
+#include "gpio1.h"
+#include "i2cCom1.h"
+#include "flash1.h"
+#include "spiComEZPort.h"
+#include "lpuartUblox.h"
+
+//split from hardware_init() and Components_Init(); keep in step with them
+//when the Processor Expert configuration changes
+static uint32_t periph_up;
+
+static void PERIPH_core(void)
+{
+    SIM_HAL_EnableClock(SIM,kSimClockGatePortA);
+    SIM_HAL_EnableClock(SIM,kSimClockGatePortB);
+    SIM_HAL_EnableClock(SIM,kSimClockGatePortC);
+    SIM_HAL_EnableClock(SIM,kSimClockGatePortD);
+    SIM_HAL_EnableClock(SIM,kSimClockGatePortE);
+    g_xtal0ClkFreq = 32768U;
+
+    init_coredebug_pins(CoreDebug_IDX);
+    init_gpio_pins(GPIOC_IDX);
+    init_gpio_pins(GPIOD_IDX);
+    init_gpio_pins(GPIOE_IDX);
+    init_llwu_pins(LLWU_IDX);
+    init_osc_pins(OSC0_IDX);
+    init_rcm_pins(RCM_IDX);
+
+    OSA_Init();
+    GPIO_DRV_Init(gpio1_InpConfig0,gpio1_OutConfig0);
+}
+
+void PERIPH_init(uint32_t units)
+{
+    units &= ~periph_up;
+    if(units == 0)
+        return;
+    //both arenas' writers at once would corrupt each other's buffers;
+    //the mode handing over calls PERIPH_deinit first
+    assert(!ARENA_OVERLAP(periph_up | units));
+    if(!(periph_up & PERIPH_CORE))
+        units |= PERIPH_CORE;
+
+    if(units & PERIPH_CORE)
+        PERIPH_core();
+    if(units & PERIPH_I2C)
+    {
+        init_i2c_pins(I2C0_IDX);
+        OSA_InstallIntHandler(I2C0_IRQn, i2cCom1_IRQHandler);
+        I2C_DRV_SlaveInit(FSL_I2CCOM1, &i2cCom1_SlaveConfig0, &i2cCom1_SlaveState);
+    }
+    if(units & PERIPH_FLASH)
+        (void)FlashInit(&flash1_InitConfig0);
+    if(units & PERIPH_EZPORT)
+    {
+        init_spi_pins(SPI0_IDX);
+        SPI_DRV_MasterInit(FSL_SPICOMEZPORT, &spiComEZPort_MasterState);
+        SPI_DRV_MasterConfigureBus(FSL_SPICOMEZPORT, &spiComEZPort_MasterConfig0, &spiComEZPort_calculatedBaudRate);
+    }
+    if(units & PERIPH_UBLOX)
+    {
+        init_lpuart_pins(LPUART0_IDX);
+        LPUART_DRV_Init(FSL_LPUARTUBLOX,&lpuartUblox_State,&lpuartUblox_InitConfig0);
+        LPUART_DRV_InstallRxCallback(FSL_LPUARTUBLOX, lpuartUblox_RxCallback, ublox_rx, NULL, true);
+    }
+    periph_up |= units;
+}
+
+void PERIPH_deinit(uint32_t units)
+{
+    //only the units that feed a buffer in the arena need taking down
+    units &= periph_up;
+    if(units & PERIPH_UBLOX)
+        LPUART_DRV_Deinit(FSL_LPUARTUBLOX);
+    if(units & PERIPH_I2C)
+        I2C_DRV_SlaveDeinit(FSL_I2CCOM1);
+    periph_up &= ~units;
+}
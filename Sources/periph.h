@@ -0,0 +1,38 @@
+/*
+  periph.h - on-demand peripheral bring-up
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_PERIPH_H_
+#define SOURCES_PERIPH_H_
+
+#include "Cpu.h"
+
+//units of PE_low_level_init, so an update brings up only what it uses
+#define PERIPH_CORE         (0x01)  //port clocks, pin mux, OSA tick, GPIO; under every other unit
+#define PERIPH_FLASH        (0x02)  //flash driver
+#define PERIPH_EZPORT       (0x04)  //SPI0 to the user module
+#define PERIPH_UBLOX        (0x08)  //LPUART0 to the modem, bytes into ublox_ring
+#define PERIPH_I2C          (0x10)  //I2C0 slave to the host
+
+void PERIPH_init(uint32_t units);
+void PERIPH_deinit(uint32_t units);
+
+#endif /* SOURCES_PERIPH_H_ */
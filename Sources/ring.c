@@ -39,18 +39,48 @@ void RING_init(ring_t *ring, uint8_t **buffer, uint32_t size)
     ring->size = size;
     ring->head = 0;
     ring->tail = 0;
+    ring->high = 0;
+    ring->low = 0;
+    ring->throttle = NULL;
+    ring->throttled = false;
+    ring->overruns = 0;
+    ring->stalls = 0;
+    ring->received = 0;
+}
+
+static void RING_release(ring_t *ring)
+{
+    //masked so a push from the interrupt can't throttle between the check
+    //and the release, leaving the XOFF to go out ahead of this XON
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if(ring->throttled && RING_available(ring) <= ring->low)
+    {
+        ring->throttled = false;
+        ring->throttle(false);
+    }
+    __set_PRIMASK(primask);
 }
 
 bool RING_push(ring_t *ring, uint8_t b)
 {
     uint32_t i = next_head(ring);
 
+    ring->received++;
     if(i != ring->tail)
     {
         ring->buffer[ring->head] = b;
         ring->head = i;
+        if(ring->high && !ring->throttled && RING_available(ring) >= ring->high)
+        {
+            ring->throttled = true;
+            ring->stalls++;
+            ring->throttle(true);
+        }
         return true;
     }
+    ring->overruns++;
     return false;
 }
 
@@ -58,6 +88,7 @@ void RING_flush(ring_t *ring)
 {
     ring->head = 0;
     ring->tail = 0;
+    RING_release(ring);
 }
 
 int32_t RING_pop(ring_t *ring)
@@ -67,6 +98,7 @@ int32_t RING_pop(ring_t *ring)
 
     uint8_t value = ring->buffer[ring->tail];
     ring->tail = next_tail(ring);
+    RING_release(ring);
 
     return value;
 }
@@ -106,7 +138,7 @@ bool RING_find_string(ring_t *ring, const char *match, uint32_t timeout_ms)
     while(OSA_TimeGetMsec() - start < timeout_ms) {
         //look for the first char
         if(seeking) {
-            if(!RING_get_until(ring, NULL, *match, timeout_ms - (OSA_TimeGetMsec() - start)))
+            if(!RING_get_until(ring, NULL, 0, *match, timeout_ms - (OSA_TimeGetMsec() - start)))
                 return false;
             else
             {
@@ -133,19 +165,32 @@ bool RING_find_string(ring_t *ring, const char *match, uint32_t timeout_ms)
     return false;
 }
 
-bool RING_get_until(ring_t *ring, char *buffer, char delim, uint32_t timeout_ms)
+bool RING_get_until(ring_t *ring, char *buffer, uint32_t size, char delim, uint32_t timeout_ms)
 {
+    //buffer, if any, gets what came before delim NUL terminated; a field
+    //that doesn't fit in size is still consumed, but fails
     char c = 0;
-    char *p = buffer;
+    uint32_t n = 0;
+    bool fits = true;
     uint32_t start = OSA_TimeGetMsec();
 
+    if(buffer)
+        *buffer = 0;
     while(OSA_TimeGetMsec() - start < timeout_ms) {
         if(RING_available(ring)) {
             c = (char)RING_pop(ring);
             if(c == delim)
-                return true;
+                return fits;
             if(buffer)
-                *p++ = c;
+            {
+                if(n + 1 < size)
+                {
+                    buffer[n++] = c;
+                    buffer[n] = 0;
+                }
+                else
+                    fits = false;
+            }
         }
     }
     return false;
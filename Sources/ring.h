@@ -32,6 +32,13 @@ typedef struct
     uint32_t size;
     volatile int32_t head;
     volatile int32_t tail;
+    uint32_t high;                  //throttle the sender at this many bytes, 0 never
+    uint32_t low;                   //and release it once drained to this many
+    void (*throttle)(bool stop);
+    volatile bool throttled;
+    volatile uint32_t overruns;     //bytes dropped with the ring full
+    volatile uint32_t stalls;       //times the sender was throttled
+    volatile uint32_t received;     //bytes pushed, dropped or not; wraps, never flushed
 }ring_t;
 
 void RING_init(ring_t *ring, uint8_t **buffer, uint32_t size);
@@ -42,7 +49,7 @@ uint32_t RING_available(ring_t *ring);
 uint8_t RING_peek(ring_t *ring);
 bool RING_isFull(ring_t *ring);
 bool RING_find_string(ring_t *ring, const char *match, uint32_t timeout_ms);
-bool RING_get_until(ring_t *ring, char *buffer, char delim, uint32_t timeout_ms);
+bool RING_get_until(ring_t *ring, char *buffer, uint32_t size, char delim, uint32_t timeout_ms);
 uint32_t RING_get(ring_t *ring, char* buffer, uint32_t count, uint32_t timeout_ms);
 
 #endif
@@ -0,0 +1,146 @@
+/*
+  sched.c - cooperative run-to-completion task scheduler
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "sched.h"
+#include "osa_timer.h"
+
+sched_t sched;
+
+static uint32_t SCHED_cycles(void)
+{
+    //deltas fit 32 bits, so the low half of the timebase will do
+    return (uint32_t)OSA_TimeGetCycles();
+}
+
+void SCHED_add(sched_task_t *task, sched_fn_t fn)
+{
+    task->fn = fn;
+    task->lc = 0;
+    task->events = 0;
+    task->timed = false;
+    task->runs = 0;
+    task->busy_cycles = 0;
+    if(sched.count < SCHED_MAX_TASKS)
+        sched.task[sched.count++] = task;
+}
+
+void SCHED_post(sched_task_t *task, uint32_t events)
+{
+    //callable from interrupts, and with them already masked
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    task->events |= events;
+    __set_PRIMASK(primask);
+}
+
+void SCHED_sleep(sched_task_t *task, uint32_t ms)
+{
+    SCHED_wake(task, OSA_TimeGetMsec() + ms);
+}
+
+void SCHED_wake(sched_task_t *task, uint32_t wake_ms)
+{
+    //an absolute deadline lets periodic tasks step it without drifting
+    task->wake_ms = wake_ms;
+    task->timed = true;
+}
+
+static void SCHED_idle(void)
+{
+    //sleep until the nearest timer, or until an interrupt posts work;
+    //checked with interrupts masked as the WFI still wakes on them
+    uint32_t sleep = 0xFFFFFFFF;
+    uint32_t now;
+
+    __disable_irq();
+    now = OSA_TimeGetMsec();
+    for(uint32_t i = 0; i < sched.count; i++)
+    {
+        sched_task_t *task = sched.task[i];
+        int32_t left = (int32_t)(task->wake_ms - now);
+
+        if(task->timed)
+        {
+            if(left <= 0)
+                sleep = 0;
+            else if((uint32_t)left < sleep)
+                sleep = left;
+        }
+        else if(task->events)
+        {
+            sleep = 0;
+        }
+    }
+    if(sleep)
+    {
+        OSA_TimeIdle(sleep);
+        sched.sleeps++;
+    }
+    __enable_irq();
+}
+
+void SCHED_run(void)
+{
+    //each task runs to completion; a sleeping task only wakes for its
+    //timer, anything posted meanwhile is delivered on its next run
+    for(;;)
+    {
+        uint32_t start = SCHED_cycles();
+        bool ran = false;
+
+        for(uint32_t i = 0; i < sched.count; i++)
+        {
+            sched_task_t *task = sched.task[i];
+            uint32_t events;
+
+            if(task->timed)
+            {
+                if((int32_t)(OSA_TimeGetMsec() - task->wake_ms) < 0)
+                    continue;
+                task->timed = false;
+                events = SCHED_TIMER;
+            }
+            else
+            {
+                if(task->events == 0)
+                    continue;
+                __disable_irq();
+                events = task->events;
+                task->events = 0;
+                __enable_irq();
+            }
+
+            uint32_t t = SCHED_cycles();
+            task->fn(task, events);
+            task->busy_cycles += SCHED_cycles() - t;
+            task->runs++;
+            ran = true;
+        }
+
+        if(!ran)
+        {
+            SCHED_idle();
+            sched.idle_cycles += SCHED_cycles() - start;
+        }
+    }
+}
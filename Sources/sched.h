@@ -0,0 +1,66 @@
+/*
+  sched.h - cooperative run-to-completion task scheduler
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_SCHED_H_
+#define SOURCES_SCHED_H_
+
+#include "Cpu.h"
+
+#define SCHED_MAX_TASKS     (4)
+#define SCHED_TIMER         (0x80000000)    //event passed when a task's timer fires
+
+typedef struct sched_task sched_task_t;
+typedef void (*sched_fn_t)(sched_task_t *task, uint32_t events);
+
+struct sched_task
+{
+    sched_fn_t fn;
+    uint32_t lc;                    //protothread resume point
+    volatile uint32_t events;       //posted, held back while the task sleeps
+    uint32_t wake_ms;               //timer deadline
+    bool timed;
+    uint32_t runs;
+    uint32_t busy_cycles;           //core cycles spent in fn
+};
+
+typedef struct
+{
+    sched_task_t *task[SCHED_MAX_TASKS];
+    uint32_t count;
+    uint32_t idle_cycles;           //core cycles with nothing to run
+    uint32_t sleeps;                //times the core slept waiting for work
+}sched_t;
+
+extern sched_t sched;
+
+//protothread-style tasks: locals don't survive a PT_SLEEP, keep state static
+#define PT_BEGIN(task)          switch((task)->lc) { case 0:
+#define PT_END(task)            } (task)->lc = 0
+#define PT_SLEEP(task, ms)      do { SCHED_sleep(task, ms); (task)->lc = __LINE__; return; case __LINE__:; } while(0)
+
+void SCHED_add(sched_task_t *task, sched_fn_t fn);
+void SCHED_post(sched_task_t *task, uint32_t events);
+void SCHED_sleep(sched_task_t *task, uint32_t ms);
+void SCHED_wake(sched_task_t *task, uint32_t wake_ms);
+void SCHED_run(void);
+
+#endif /* SOURCES_SCHED_H_ */
@@ -0,0 +1,166 @@
+/*
+  sha256.c - streaming SHA-256
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "sha256.h"
+
+#include <string.h>
+
+static const uint32_t K[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+#define ROR(x,n)    (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x,y,z)   ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x,y,z)  (((x) & (y)) | ((z) & ((x) | (y))))
+#define S0(x)       (ROR(x, 2) ^ ROR(x,13) ^ ROR(x,22))
+#define S1(x)       (ROR(x, 6) ^ ROR(x,11) ^ ROR(x,25))
+#define G0(x)       (ROR(x, 7) ^ ROR(x,18) ^ ((x) >> 3))
+#define G1(x)       (ROR(x,17) ^ ROR(x,19) ^ ((x) >> 10))
+
+//message schedule kept as a rolling 16 word window
+#define W(i)        (w[(i) & 15] += G1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + G0(w[((i) - 15) & 15]))
+
+//one round; the caller rotates the register names instead of moving data
+#define ROUND(a,b,c,d,e,f,g,h,i,wi) \
+    do { \
+        uint32_t t1 = h + S1(e) + CH(e,f,g) + K[i] + (wi); \
+        d += t1; \
+        h = t1 + S0(a) + MAJ(a,b,c); \
+    } while(0)
+
+static void SHA256_compress(uint32_t *state, const uint8_t *p)
+{
+    uint32_t w[16];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    uint32_t i;
+
+    for(i = 0; i < 16; i++, p += 4)
+        w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+
+    //rounds unrolled by eight so no register shuffling is needed
+    for(i = 0; i < 16; i += 8)
+    {
+        ROUND(a,b,c,d,e,f,g,h,i+0,w[i+0]);
+        ROUND(h,a,b,c,d,e,f,g,i+1,w[i+1]);
+        ROUND(g,h,a,b,c,d,e,f,i+2,w[i+2]);
+        ROUND(f,g,h,a,b,c,d,e,i+3,w[i+3]);
+        ROUND(e,f,g,h,a,b,c,d,i+4,w[i+4]);
+        ROUND(d,e,f,g,h,a,b,c,i+5,w[i+5]);
+        ROUND(c,d,e,f,g,h,a,b,i+6,w[i+6]);
+        ROUND(b,c,d,e,f,g,h,a,i+7,w[i+7]);
+    }
+    for(; i < 64; i += 8)
+    {
+        ROUND(a,b,c,d,e,f,g,h,i+0,W(i+0));
+        ROUND(h,a,b,c,d,e,f,g,i+1,W(i+1));
+        ROUND(g,h,a,b,c,d,e,f,i+2,W(i+2));
+        ROUND(f,g,h,a,b,c,d,e,i+3,W(i+3));
+        ROUND(e,f,g,h,a,b,c,d,i+4,W(i+4));
+        ROUND(d,e,f,g,h,a,b,c,i+5,W(i+5));
+        ROUND(c,d,e,f,g,h,a,b,i+6,W(i+6));
+        ROUND(b,c,d,e,f,g,h,a,i+7,W(i+7));
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void SHA256_init(sha256_t *ctx)
+{
+    ctx->state[0] = 0x6A09E667;
+    ctx->state[1] = 0xBB67AE85;
+    ctx->state[2] = 0x3C6EF372;
+    ctx->state[3] = 0xA54FF53A;
+    ctx->state[4] = 0x510E527F;
+    ctx->state[5] = 0x9B05688C;
+    ctx->state[6] = 0x1F83D9AB;
+    ctx->state[7] = 0x5BE0CD19;
+    ctx->count = 0;
+}
+
+void SHA256_update(sha256_t *ctx, const uint8_t *data, uint32_t size)
+{
+    uint32_t used = ctx->count & (SHA256_BLOCK_SIZE - 1);
+
+    ctx->count += size;
+
+    if(used)
+    {
+        uint32_t len = SHA256_BLOCK_SIZE - used;
+        if(len > size)
+            len = size;
+        memcpy(&ctx->block[used], data, len);
+        data += len;
+        size -= len;
+        if(used + len < SHA256_BLOCK_SIZE)
+            return;
+        SHA256_compress(ctx->state, ctx->block);
+    }
+
+    //whole blocks straight from the caller's buffer
+    while(size >= SHA256_BLOCK_SIZE)
+    {
+        SHA256_compress(ctx->state, data);
+        data += SHA256_BLOCK_SIZE;
+        size -= SHA256_BLOCK_SIZE;
+    }
+
+    memcpy(ctx->block, data, size);
+}
+
+void SHA256_final(sha256_t *ctx, uint8_t *digest)
+{
+    uint32_t used = ctx->count & (SHA256_BLOCK_SIZE - 1);
+    uint32_t bits = ctx->count << 3;
+    uint32_t i;
+
+    ctx->block[used++] = 0x80;
+    if(used > SHA256_BLOCK_SIZE - 8)
+    {
+        memset(&ctx->block[used], 0, SHA256_BLOCK_SIZE - used);
+        SHA256_compress(ctx->state, ctx->block);
+        used = 0;
+    }
+    memset(&ctx->block[used], 0, SHA256_BLOCK_SIZE - 4 - used);
+    //images are far below 512MB, so the upper length word is always zero
+    ctx->block[60] = bits >> 24;
+    ctx->block[61] = bits >> 16;
+    ctx->block[62] = bits >> 8;
+    ctx->block[63] = bits;
+    SHA256_compress(ctx->state, ctx->block);
+
+    for(i = 0; i < 8; i++)
+    {
+        digest[i*4+0] = ctx->state[i] >> 24;
+        digest[i*4+1] = ctx->state[i] >> 16;
+        digest[i*4+2] = ctx->state[i] >> 8;
+        digest[i*4+3] = ctx->state[i];
+    }
+}
@@ -0,0 +1,43 @@
+/*
+  sha256.h - streaming SHA-256
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_SHA256_H_
+#define SOURCES_SHA256_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SHA256_DIGEST_SIZE  (32)
+#define SHA256_BLOCK_SIZE   (64)
+
+typedef struct
+{
+    uint32_t state[8];
+    uint32_t count;                     //total bytes hashed
+    uint8_t  block[SHA256_BLOCK_SIZE];  //partial input block
+}sha256_t;
+
+void SHA256_init(sha256_t *ctx);
+void SHA256_update(sha256_t *ctx, const uint8_t *data, uint32_t size);
+void SHA256_final(sha256_t *ctx, uint8_t *digest);
+
+#endif /* SOURCES_SHA256_H_ */
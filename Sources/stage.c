@@ -0,0 +1,176 @@
+/*
+  stage.c - assemble streamed chunks into whole flash program units
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "stage.h"
+
+#include <string.h>
+#include "flash.h"
+#include "ext_flash.h"
+#include "perf.h"
+#include "arena.h"
+
+#define STAGE_NONE          (0xFFFFFFFF)
+
+//one unit in flight at a time; sized for the largest unit (internal sector)
+static uint8_t stage_buffer[FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE] ARENA_UPDATE;
+
+void STAGE_init(stage_t *stage, uint32_t target)
+{
+    stage->target = target;
+    if(target == STAGE_INTERNAL)
+    {
+        stage->unit_size = FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE;
+        stage->erase_size = FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE;
+        stage->hold_size = STAGE_VECTORS_SIZE > PGM_SIZE_BYTE ? STAGE_VECTORS_SIZE : PGM_SIZE_BYTE;
+    }
+    else
+    {
+        stage->unit_size = EXT_PAGE_SIZE;
+        stage->erase_size = EXT_SECTOR_SIZE;
+        //the staging NOR programs any byte; the user module over EZPort
+        //only whole phrases, so its vectors go back as one
+        stage->hold_size = target == EXT_STAGING ? STAGE_VECTORS_SIZE : EXT_EZPORT_WRITE_SIZE;
+    }
+    stage->base = STAGE_NONE;
+    stage->fill = 0;
+    stage->erased_end = 0;
+    stage->hold_address = STAGE_NONE;
+    stage->error = false;
+    stage->erases = 0;
+    stage->programs = 0;
+}
+
+static RAMFUNC void STAGE_erase(stage_t *stage)
+{
+    uint32_t sector = stage->base & ~(stage->erase_size - 1);
+
+    if(stage->erased_end != 0 && sector < stage->erased_end)
+        return;
+
+    uint32_t start = PERF_start();
+    if(stage->target == STAGE_INTERNAL)
+    {
+        if(!FLASH_erase_sector(sector))
+            stage->error = true;
+        PERF_stop(PERF_FLASH_ERASE, start);
+    }
+    else
+    {
+        EXT_erase_sector(stage->target, sector);
+        PERF_stop(PERF_EXT_ERASE, start);
+    }
+    stage->erased_end = sector + stage->erase_size;
+    stage->erases++;
+}
+
+static RAMFUNC void STAGE_program(stage_t *stage, uint32_t address, uint8_t *data, uint32_t size)
+{
+    uint32_t start = PERF_start();
+    if(stage->target == STAGE_INTERNAL)
+    {
+        if(!FLASH_write_block(address, data, size))
+            stage->error = true;
+        PERF_stop(PERF_FLASH_PROGRAM, start);
+    }
+    else
+    {
+        EXT_write_block(stage->target, address, data, size);
+        PERF_stop(PERF_EXT_PROGRAM, start);
+    }
+}
+
+RAMFUNC bool STAGE_flush(stage_t *stage)
+{
+    if(stage->base == STAGE_NONE)
+        return !stage->error;
+
+    //pad the tail with the erased value so it programs as a no-op
+    memset(&stage_buffer[stage->fill], 0xFF, stage->unit_size - stage->fill);
+
+    STAGE_erase(stage);
+
+    uint32_t skip = 0;
+    if(stage->base == stage->hold_address)
+    {
+        //keep the vectors out of flash so the image can't start until released
+        memcpy(stage->hold, stage_buffer, stage->hold_size);
+        skip = stage->hold_size;
+    }
+    STAGE_program(stage, stage->base + skip, &stage_buffer[skip], stage->unit_size - skip);
+    stage->programs++;
+
+    stage->base = STAGE_NONE;
+    stage->fill = 0;
+    return !stage->error;
+}
+
+RAMFUNC bool STAGE_write(stage_t *stage, uint32_t address, const uint8_t *data, uint32_t size)
+{
+    while(size)
+    {
+        uint32_t base = address & ~(stage->unit_size - 1);
+        uint32_t offset = address - base;
+
+        //writes are expected in order; anything else closes the open unit
+        if(stage->base != base || stage->fill > offset)
+            STAGE_flush(stage);
+
+        if(stage->base == STAGE_NONE)
+        {
+            stage->base = base;
+            stage->fill = 0;
+        }
+        if(stage->fill < offset)
+            memset(&stage_buffer[stage->fill], 0xFF, offset - stage->fill);
+
+        uint32_t len = stage->unit_size - offset;
+        if(len > size)
+            len = size;
+        memcpy(&stage_buffer[offset], data, len);
+        stage->fill = offset + len;
+
+        if(stage->fill == stage->unit_size)
+            STAGE_flush(stage);
+
+        address += len;
+        data += len;
+        size -= len;
+    }
+    return !stage->error;
+}
+
+void STAGE_hold(stage_t *stage, uint32_t address)
+{
+    //address must start a program unit
+    stage->hold_address = address;
+}
+
+bool STAGE_release(stage_t *stage)
+{
+    if(!STAGE_flush(stage) || stage->hold_address == STAGE_NONE)
+        return !stage->error;
+
+    STAGE_program(stage, stage->hold_address, stage->hold, stage->hold_size);
+    stage->programs++;
+    stage->hold_address = STAGE_NONE;
+    return !stage->error;
+}
@@ -0,0 +1,56 @@
+/*
+  stage.h - assemble streamed chunks into whole flash program units
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_STAGE_H_
+#define SOURCES_STAGE_H_
+
+#include "Cpu.h"
+#include "flash.h"
+
+#define STAGE_INTERNAL      (0xFFFFFFFF)    //target for internal flash, else an SPI instance
+#define STAGE_VECTORS_SIZE  (8)             //initial SP and reset vector
+#define STAGE_HOLD_MAX      (16)            //the vectors, rounded up to the largest program unit
+
+typedef struct
+{
+    uint32_t target;        //STAGE_INTERNAL or SPI instance
+    uint32_t unit_size;     //bytes programmed per command
+    uint32_t erase_size;    //bytes erased per command
+    uint32_t base;          //address of the unit being assembled
+    uint32_t fill;          //bytes of the unit present in the buffer
+    uint32_t erased_end;    //everything below this, from the first unit, is erased
+    uint32_t hold_address;  //bytes held back from programming until released
+    uint32_t hold_size;     //the vectors, rounded up to the target's program unit
+    uint8_t  hold[STAGE_HOLD_MAX];
+    bool     error;
+    uint32_t erases;        //erase commands issued
+    uint32_t programs;      //program commands issued
+}stage_t;
+
+void STAGE_init(stage_t *stage, uint32_t target);
+//in RAM with the flash routines they drive, as the update's inner loop
+RAMFUNC bool STAGE_write(stage_t *stage, uint32_t address, const uint8_t *data, uint32_t size);
+RAMFUNC bool STAGE_flush(stage_t *stage);
+void STAGE_hold(stage_t *stage, uint32_t address);
+bool STAGE_release(stage_t *stage);
+
+#endif /* SOURCES_STAGE_H_ */
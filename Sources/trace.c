@@ -0,0 +1,84 @@
+/*
+  trace.c - capture of modem and I2C traffic for replay
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "trace.h"
+
+#ifdef BOOT_TRACE
+
+#include "osa_timer.h"
+
+//not cleared by startup, so a capture runs on across the resets of a
+//retried update and can be read back over I2C afterwards
+trace_t trace __attribute__((section(".noinit")));
+
+void TRACE_init(void)
+{
+    if(trace.magic != TRACE_MAGIC || trace.head >= TRACE_RECORDS)
+    {
+        trace.magic = TRACE_MAGIC;
+        trace.head = 0;
+        trace.count = 0;
+    }
+    trace.paused = false;
+    trace.last_us = (uint32_t)OSA_TimeGetUsec();
+    TRACE_byte(TRACE_BOOT, RCM->SRS0);
+}
+
+static void TRACE_put(uint16_t dt, uint8_t channel, uint8_t data)
+{
+    trace_record_t *record = &trace.record[trace.head];
+
+    record->dt = dt;
+    record->channel = channel;
+    record->data = data;
+    if(++trace.head == TRACE_RECORDS)
+        trace.head = 0;
+    trace.count++;
+}
+
+void TRACE_byte(uint8_t channel, uint8_t data)
+{
+    //from thread and interrupt context alike
+    uint32_t primask = __get_PRIMASK();
+    uint32_t now;
+    uint32_t dt;
+
+    __disable_irq();
+    if(!trace.paused)
+    {
+        now = (uint32_t)OSA_TimeGetUsec();
+        dt = now - trace.last_us;
+        trace.last_us = now;
+        if(dt > 0xFFFF)
+            TRACE_put(dt >> 16, TRACE_GAP, 0);
+        TRACE_put(dt & 0xFFFF, channel, data);
+    }
+    __set_PRIMASK(primask);
+}
+
+void TRACE_block(uint8_t channel, const uint8_t *data, uint32_t size)
+{
+    while(size--)
+        TRACE_byte(channel, *data++);
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+  trace.h - capture of modem and I2C traffic for replay
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SOURCES_TRACE_H_
+#define SOURCES_TRACE_H_
+
+#include "Cpu.h"
+
+//#define BOOT_TRACE
+
+#define TRACE_MAGIC         (0x43525454) //'TTRC'
+#define TRACE_RECORDS       (2048)
+
+#define TRACE_UART_RX       (0x00)  //byte from the modem
+#define TRACE_UART_TX       (0x01)  //byte to the modem
+#define TRACE_I2C_RX        (0x02)  //command or payload byte from the host
+#define TRACE_I2C_TX        (0x03)  //reply started, data is the length's low byte
+#define TRACE_I2C_EVENT     (0x04)  //i2c_slave_event_t
+#define TRACE_BOOT          (0xFE)  //reset, data is RCM_SRS0
+#define TRACE_GAP           (0xFF)  //dt is in units of 65536us
+
+typedef struct
+{
+    uint16_t dt;                    //microseconds since the previous record
+    uint8_t  channel;
+    uint8_t  data;
+}trace_record_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t head;                  //next record written
+    uint32_t count;                 //records written since power on, wraps the ring
+    uint32_t last_us;
+    bool     paused;
+    trace_record_t record[TRACE_RECORDS];
+}trace_t;
+
+#ifdef BOOT_TRACE
+extern trace_t trace;
+
+void TRACE_init(void);
+void TRACE_byte(uint8_t channel, uint8_t data);
+void TRACE_block(uint8_t channel, const uint8_t *data, uint32_t size);
+#else
+#define TRACE_init()
+#define TRACE_byte(channel, data)
+#define TRACE_block(channel, data, size)
+#endif
+
+#endif /* SOURCES_TRACE_H_ */
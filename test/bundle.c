@@ -0,0 +1,247 @@
+/*
+  bundle.c - pack update images into one bundle file
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//Lays out a bundle for BOOT_LoadBundle: the manifest (boot_bundle_t) then
+//each image in the order given, which is the order they install in.
+//Prints the manifest's SHA-256, which goes in system_sha256 of the boot
+//flags with bundle_offset set; each entry carries its image's digest.
+//
+//With -f the manifest and each image are framed separately for
+//BOOT_TRANSFER_FRAMED, so every image starts on a frame boundary and
+//the entry offsets are offsets in the framed file.
+//
+//The manifest is written field by field, little endian, as the target
+//lays it out; the compression flag is always 0.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "boot.h"
+#include "sha256.h"
+#include "crc.h"
+
+#define BUNDLE_ENTRY_SIZE   (4 * sizeof(uint32_t) + SHA256_DIGEST_SIZE)
+#define BUNDLE_HEADER_SIZE  (2 * sizeof(uint32_t) + BOOT_BUNDLE_MAX * BUNDLE_ENTRY_SIZE)
+#define BUNDLE_FRAME_PAYLOAD (512)  //boot.c's BOOT_FRAME_PAYLOAD
+#define BUNDLE_FRAME_OVERHEAD (4)
+
+typedef struct
+{
+    uint32_t target;                //BOOT_IMAGE_*
+    const uint8_t *data;
+    uint32_t size;
+}bundle_image_t;
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+//bytes size of data takes in the file
+static uint32_t bundle_stored(uint32_t size, bool framed)
+{
+    uint32_t frames = (size + BUNDLE_FRAME_PAYLOAD - 1) / BUNDLE_FRAME_PAYLOAD;
+    return framed ? size + frames * BUNDLE_FRAME_OVERHEAD : size;
+}
+
+//<len:2 LE><payload><crc16:2 LE over len+payload>, full payloads but the last
+static uint32_t bundle_store(uint8_t *out, const uint8_t *data, uint32_t size, bool framed)
+{
+    uint32_t written = 0;
+
+    if(!framed)
+    {
+        memcpy(out, data, size);
+        return size;
+    }
+    for(uint32_t pos = 0; pos < size; pos += BUNDLE_FRAME_PAYLOAD)
+    {
+        uint8_t *frame = &out[written];
+        uint32_t len = size - pos < BUNDLE_FRAME_PAYLOAD ? size - pos : BUNDLE_FRAME_PAYLOAD;
+        uint16_t crc;
+
+        frame[0] = len;
+        frame[1] = len >> 8;
+        memcpy(&frame[2], &data[pos], len);
+        crc = CRC_crc16(CRC16_INIT, frame, len + 2);
+        frame[len + 2] = crc;
+        frame[len + 3] = crc >> 8;
+        written += len + BUNDLE_FRAME_OVERHEAD;
+    }
+    return written;
+}
+
+//the bundle in out, NULL on success, otherwise why it couldn't be made
+static const char *bundle_pack(const bundle_image_t *images, uint32_t count, bool framed,
+        uint8_t *out, uint32_t max, uint32_t *size, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    static sha256_t sha;
+    uint8_t header[BUNDLE_HEADER_SIZE];
+    uint32_t pos;
+
+    if(count == 0 || count > BOOT_BUNDLE_MAX)
+        return "one to three images";
+
+    memset(header, 0, sizeof(header));
+    put32(&header[0], BOOT_BUNDLE_MAGIC);
+    put32(&header[4], count);
+    pos = bundle_stored(sizeof(header), framed);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        uint8_t *entry = &header[8 + i * BUNDLE_ENTRY_SIZE];
+
+        if(images[i].target > BOOT_IMAGE_SYSTEM)
+            return "unknown target";
+        put32(&entry[0], images[i].target);
+        put32(&entry[4], pos);
+        put32(&entry[8], images[i].size);
+        put32(&entry[12], 0);
+        SHA256_init(&sha);
+        SHA256_update(&sha, images[i].data, images[i].size);
+        SHA256_final(&sha, &entry[16]);
+        pos += bundle_stored(images[i].size, framed);
+    }
+    if(pos > max)
+        return "too large";
+
+    SHA256_init(&sha);
+    SHA256_update(&sha, header, sizeof(header));
+    SHA256_final(&sha, digest);
+
+    pos = bundle_store(out, header, sizeof(header), framed);
+    for(uint32_t i = 0; i < count; i++)
+        pos += bundle_store(&out[pos], images[i].data, images[i].size, framed);
+    *size = pos;
+    return NULL;
+}
+
+#ifndef BUNDLE_NO_MAIN
+
+#define BUNDLE_MAX          (1024 * 1024)
+
+static void usage(const char *self)
+{
+    fprintf(stderr,
+        "usage: %s [-f] -o bundle [-b userboot.bin] [-u user.bin] [-s system.bin]\n"
+        "  -f          frame the contents for BOOT_TRANSFER_FRAMED\n"
+        "  -o bundle   file to write\n"
+        "  -b -u -s    the user module's bootloader and application, and the\n"
+        "              system application; installed in the order given\n",
+        self);
+}
+
+static uint8_t *load(const char *path, uint32_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t *data = malloc(BUNDLE_MAX);
+
+    if(!file || !data)
+    {
+        if(file)
+            fclose(file);
+        free(data);
+        return NULL;
+    }
+    *size = (uint32_t)fread(data, 1, BUNDLE_MAX, file);
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const names[] = { "userboot", "user", "system" };
+    bundle_image_t images[BOOT_BUNDLE_MAX];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    const char *output = NULL;
+    const char *error;
+    uint32_t count = 0;
+    uint32_t size;
+    uint8_t *out;
+    bool framed = false;
+    FILE *file;
+    int opt;
+
+    while((opt = getopt(argc, argv, "fo:b:u:s:")) != -1)
+    {
+        uint32_t target = opt == 'b' ? BOOT_IMAGE_USERBOOT : opt == 'u' ? BOOT_IMAGE_USER : BOOT_IMAGE_SYSTEM;
+
+        switch(opt)
+        {
+        case 'f': framed = true; break;
+        case 'o': output = optarg; break;
+        case 'b':
+        case 'u':
+        case 's':
+            if(count == BOOT_BUNDLE_MAX)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            images[count].target = target;
+            images[count].data = load(optarg, &images[count].size);
+            if(!images[count].data)
+            {
+                fprintf(stderr, "%s: can't read\n", optarg);
+                return 1;
+            }
+            count++;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if(!output || count == 0 || optind != argc)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    out = malloc(BUNDLE_MAX);
+    error = out ? bundle_pack(images, count, framed, out, BUNDLE_MAX, &size, digest) : "out of memory";
+    if(error)
+    {
+        fprintf(stderr, "%s: %s\n", output, error);
+        return 1;
+    }
+    file = fopen(output, "wb");
+    if(!file || fwrite(out, 1, size, file) != size || fclose(file) != 0)
+    {
+        fprintf(stderr, "%s: can't write\n", output);
+        return 1;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+        printf("%-8s %8u bytes\n", names[images[i].target], images[i].size);
+    printf("%-8s %8u bytes%s, manifest sha256 ", output, size, framed ? " framed" : "");
+    for(uint32_t i = 0; i < SHA256_DIGEST_SIZE; i++)
+        printf("%02x", digest[i]);
+    printf("\n");
+    return 0;
+}
+
+#endif
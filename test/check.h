@@ -0,0 +1,79 @@
+/*
+  check.h - assertions for the host tests
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+//Each test is one program: failed checks are reported and counted, and
+//CHECK_DONE() prints the tally and gives the exit status for make check.
+
+static uint32_t check_count;
+static uint32_t check_failures;
+
+#define CHECK(cond) \
+    do { \
+        check_count++; \
+        if(!(cond)) { \
+            check_failures++; \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while(0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        uint64_t check_a = (uint64_t)(actual); \
+        uint64_t check_e = (uint64_t)(expected); \
+        check_count++; \
+        if(check_a != check_e) { \
+            check_failures++; \
+            fprintf(stderr, "%s:%d: %s is 0x%" PRIX64 ", expected 0x%" PRIX64 "\n", \
+                    __FILE__, __LINE__, #actual, check_a, check_e); \
+        } \
+    } while(0)
+
+#define CHECK_MEM(actual, expected, size) \
+    CHECK(memcmp((actual), (expected), (size)) == 0)
+
+//known answers are written as hex strings
+static inline uint32_t unhex(const char *hex, uint8_t *out)
+{
+    uint32_t size = 0;
+
+    while(hex[0] && hex[1])
+    {
+        unsigned int b;
+        sscanf(hex, "%2x", &b);
+        out[size++] = (uint8_t)b;
+        hex += 2;
+    }
+    return size;
+}
+
+#define CHECK_DONE(name) \
+    (printf("%-12s %" PRIu32 " checks, %" PRIu32 " failed\n", (name), check_count, check_failures), \
+     check_failures ? 1 : 0)
+
+#endif /* TEST_CHECK_H_ */
@@ -0,0 +1,517 @@
+/*
+  factory_prog.c - program a unit through its factory mode
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//The fixture's side of factory.h.  It repeats FACTORY_SYNC until the unit
+//answers, moves to FACTORY_BAUD, sends each image as an OPEN, its DATA
+//frames and a CLOSE, then a RESET.  Frames go out while the unit's credit
+//allows, at most window of them in flight; a NAK, or no progress for
+//FACTORY_PROG_TIMEOUT_US, goes back to the first frame not yet processed.
+//
+//factory_prog_send and factory_prog_receive only build frames and take
+//reply bytes, so the same code drives a serial port here and the fixture
+//model in test_factory.c.  Frames and replies are read and written field
+//by field, little endian, as the target lays them out.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "boot.h"
+#include "factory.h"
+#include "sha256.h"
+#include "crc.h"
+
+#define FACTORY_PROG_IMAGES     (3)
+#define FACTORY_PROG_FRAME_MAX  (sizeof(factory_header_t) + FACTORY_BLOCK + sizeof(uint16_t))
+#define FACTORY_PROG_SYNC_BAUD  (115200)
+#define FACTORY_PROG_SETTLE_US  (1000)      //after the sync reply, for the unit to change rate
+#define FACTORY_PROG_TIMEOUT_US (250000)    //above an EZPort sector's erase and program
+
+typedef enum
+{
+    FACTORY_PROG_SYNC,
+    FACTORY_PROG_SESSION,
+    FACTORY_PROG_DONE,
+    FACTORY_PROG_FAILED,
+}factory_prog_state_t;
+
+typedef struct
+{
+    uint32_t target;                //BOOT_IMAGE_*
+    const uint8_t *data;
+    uint32_t size;
+}factory_image_t;
+
+//frames are numbered from 0 through the session; seq is the low byte
+typedef struct
+{
+    factory_prog_state_t state;
+    const factory_image_t *images;
+    uint32_t count;
+    uint32_t window;                //frames in flight at most
+    uint8_t sha256[FACTORY_PROG_IMAGES][SHA256_DIGEST_SIZE];
+    uint32_t frames;                //in the session, RESET included
+    uint32_t acked;                 //frames the unit has processed
+    uint32_t sent;                  //next frame to send
+    uint32_t high;                  //frames ever sent
+    uint32_t limit;                 //first frame without credit
+    uint64_t progress_us;           //acked last moved, or sending resumed
+    uint64_t synced_us;
+    uint32_t matched;               //of FACTORY_SYNC_OK
+    uint8_t reply[sizeof(factory_reply_t)];
+    uint32_t reply_size;
+    uint32_t install_us[FACTORY_PROG_IMAGES];   //CLOSE values, in image order
+    uint32_t naks;
+    uint32_t timeouts;
+    uint32_t resent;                //frames sent again
+    const char *error;              //once FACTORY_PROG_FAILED
+}factory_prog_t;
+
+static void put16(uint8_t *p, uint16_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static uint32_t prog_blocks(uint32_t size)
+{
+    return (size + FACTORY_BLOCK - 1) / FACTORY_BLOCK;
+}
+
+//the image frame n belongs to, count for the RESET, and its place in
+//that image: 0 the OPEN, then the DATA frames, then the CLOSE
+static uint32_t prog_locate(const factory_prog_t *p, uint32_t n, uint32_t *part)
+{
+    uint32_t image;
+
+    for(image = 0; image < p->count; image++)
+    {
+        uint32_t frames = prog_blocks(p->images[image].size) + 2;
+        if(n < frames)
+            break;
+        n -= frames;
+    }
+    *part = n;
+    return image;
+}
+
+static uint8_t prog_type(const factory_prog_t *p, uint32_t n)
+{
+    uint32_t part;
+    uint32_t image = prog_locate(p, n, &part);
+
+    if(image == p->count)
+        return FACTORY_RESET;
+    if(part == 0)
+        return FACTORY_OPEN;
+    return part <= prog_blocks(p->images[image].size) ? FACTORY_DATA : FACTORY_CLOSE;
+}
+
+//frame n in out, its size on the line
+static uint32_t prog_frame(const factory_prog_t *p, uint32_t n, uint8_t *out)
+{
+    uint8_t *payload = &out[sizeof(factory_header_t)];
+    uint8_t type = prog_type(p, n);
+    uint32_t part;
+    uint32_t image = prog_locate(p, n, &part);
+    uint32_t size = 0;
+    uint32_t arg = 0;
+
+    if(type == FACTORY_OPEN)
+    {
+        arg = p->images[image].target;
+        put32(payload, p->images[image].size);
+        memcpy(&payload[4], p->sha256[image], SHA256_DIGEST_SIZE);
+        size = sizeof(factory_open_t);
+    }
+    else if(type == FACTORY_DATA)
+    {
+        arg = (part - 1) * FACTORY_BLOCK;
+        size = p->images[image].size - arg < FACTORY_BLOCK ? p->images[image].size - arg : FACTORY_BLOCK;
+        memcpy(payload, &p->images[image].data[arg], size);
+    }
+
+    out[0] = type;
+    out[1] = n;
+    put16(&out[2], size);
+    put32(&out[4], arg);
+    put16(&payload[size], CRC_crc16(CRC16_INIT, out, sizeof(factory_header_t) + size));
+    return sizeof(factory_header_t) + size + sizeof(uint16_t);
+}
+
+static void factory_prog_start(factory_prog_t *p, const factory_image_t *images, uint32_t count, uint32_t window)
+{
+    static sha256_t sha;
+
+    memset(p, 0, sizeof(*p));
+    p->images = images;
+    p->count = count;
+    p->window = window;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        SHA256_init(&sha);
+        SHA256_update(&sha, images[i].data, images[i].size);
+        SHA256_final(&sha, p->sha256[i]);
+        p->frames += prog_blocks(images[i].size) + 2;
+    }
+    p->frames++;
+    p->limit = 1;
+}
+
+//the line rate the fixture's side should be at, changed between frames
+static uint32_t factory_prog_baud(const factory_prog_t *p)
+{
+    return p->state == FACTORY_PROG_SYNC ? FACTORY_PROG_SYNC_BAUD : FACTORY_BAUD;
+}
+
+//what to put on the line now into out, its size; 0 for nothing yet
+static uint32_t factory_prog_send(factory_prog_t *p, uint64_t now_us, uint8_t *out)
+{
+    if(p->state == FACTORY_PROG_SYNC)
+    {
+        //quiet once the answer starts, so the unit can change rate
+        if(p->matched)
+            return 0;
+        memcpy(out, FACTORY_SYNC, strlen(FACTORY_SYNC));
+        return strlen(FACTORY_SYNC);
+    }
+    if(p->state != FACTORY_PROG_SESSION || now_us - p->synced_us < FACTORY_PROG_SETTLE_US)
+        return 0;
+
+    if(p->sent != p->acked && now_us - p->progress_us > FACTORY_PROG_TIMEOUT_US)
+    {
+        p->timeouts++;
+        p->sent = p->acked;
+    }
+    if(p->sent == p->frames || p->sent >= p->limit || p->sent - p->acked >= p->window)
+        return 0;
+    //OPEN, CLOSE and RESET go with nothing else in flight
+    if(prog_type(p, p->sent) != FACTORY_DATA && p->sent != p->acked)
+        return 0;
+
+    if(p->sent == p->acked)
+        p->progress_us = now_us;
+    if(p->sent < p->high)
+        p->resent++;
+    uint32_t size = prog_frame(p, p->sent++, out);
+    if(p->sent > p->high)
+        p->high = p->sent;
+    return size;
+}
+
+static bool prog_reply(factory_prog_t *p, uint64_t now_us)
+{
+    static const char *const failed[] = {
+        [FACTORY_OPEN] = "the unit refused the image",
+        [FACTORY_DATA] = "programming failed",
+        [FACTORY_CLOSE] = "the image didn't verify",
+        [FACTORY_RESET] = "the unit refused the reset",
+    };
+    const uint8_t *r = p->reply;
+    uint16_t crc = r[8] | r[9] << 8;
+
+    if(crc != CRC_crc16(CRC16_INIT, r, offsetof(factory_reply_t, crc)))
+        return false;
+
+    //next and limit are the low bytes of frame numbers at or past acked
+    uint32_t acked = p->acked + (uint8_t)(r[2] - (uint8_t)p->acked);
+    uint32_t value = r[4] | r[5] << 8 | r[6] << 16 | (uint32_t)r[7] << 24;
+    if(acked > p->high)
+        return true;
+    if(acked != p->acked)
+    {
+        p->acked = acked;
+        p->progress_us = now_us;
+    }
+    p->limit = acked + (uint8_t)(r[3] - r[2]);
+    if(p->sent < acked)
+        p->sent = acked;
+
+    if(r[0] == FACTORY_NAK)
+    {
+        p->naks++;
+        p->sent = acked;
+        p->progress_us = now_us;
+    }
+    else if(r[0] == FACTORY_FAIL)
+    {
+        p->state = FACTORY_PROG_FAILED;
+        p->error = r[1] && r[1] <= FACTORY_RESET ? failed[r[1]] : "the unit failed";
+    }
+    else if(r[1] == FACTORY_CLOSE && value)
+    {
+        //a repeated ACK carries no time
+        uint32_t part;
+        uint32_t image = prog_locate(p, acked - 1, &part);
+        if(image < p->count)
+            p->install_us[image] = value;
+    }
+    else if(r[1] == FACTORY_RESET && acked == p->frames)
+    {
+        p->state = FACTORY_PROG_DONE;
+    }
+    return true;
+}
+
+static bool prog_status(uint8_t data)
+{
+    return data == FACTORY_ACK || data == FACTORY_NAK || data == FACTORY_FAIL;
+}
+
+//a byte from the unit
+static void factory_prog_receive(factory_prog_t *p, uint8_t data, uint64_t now_us)
+{
+    if(p->state == FACTORY_PROG_SYNC)
+    {
+        const char *ok = FACTORY_SYNC_OK;
+        p->matched = data == ok[p->matched] ? p->matched + 1 : (data == ok[0]);
+        if(p->matched == strlen(FACTORY_SYNC_OK))
+        {
+            p->state = FACTORY_PROG_SESSION;
+            p->synced_us = now_us;
+        }
+        return;
+    }
+    if(p->state != FACTORY_PROG_SESSION || (p->reply_size == 0 && !prog_status(data)))
+        return;
+
+    p->reply[p->reply_size++] = data;
+    if(p->reply_size < sizeof(p->reply))
+        return;
+    if(prog_reply(p, now_us))
+    {
+        p->reply_size = 0;
+        return;
+    }
+    //damaged: start again at the next status byte
+    uint32_t skip = 1;
+    while(skip < p->reply_size && !prog_status(p->reply[skip]))
+        skip++;
+    p->reply_size -= skip;
+    memmove(p->reply, &p->reply[skip], p->reply_size);
+}
+
+#ifndef FACTORY_PROG_NO_MAIN
+
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/select.h>
+
+#define FACTORY_PROG_MAX        (1024 * 1024)
+
+static void usage(const char *self)
+{
+    fprintf(stderr,
+        "usage: %s -d port [-w frames] [-t seconds] [-s system.bin] [-b userboot.bin] [-u user.bin]\n"
+        "  -d port     the fixture's serial port on the modem LPUART pins\n"
+        "  -w frames   in flight at most, 1 to %d (default %d)\n"
+        "  -t seconds  for the whole unit, sync included (default 60)\n"
+        "  -s -b -u    the system application, and the user module's bootloader\n"
+        "              and application; installed in the order given\n",
+        self, FACTORY_WINDOW, FACTORY_WINDOW);
+}
+
+static uint8_t *load(const char *path, uint32_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t *data = malloc(FACTORY_PROG_MAX);
+
+    if(!file || !data)
+    {
+        if(file)
+            fclose(file);
+        free(data);
+        return NULL;
+    }
+    *size = (uint32_t)fread(data, 1, FACTORY_PROG_MAX, file);
+    fclose(file);
+    return data;
+}
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool port_baud(int fd, uint32_t baud)
+{
+    struct termios tio;
+    speed_t speed = baud == FACTORY_BAUD ? B500000 : B115200;
+
+    if(tcgetattr(fd, &tio) != 0)
+        return false;
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    return tcsetattr(fd, TCSADRAIN, &tio) == 0;
+}
+
+static bool port_write(int fd, const uint8_t *data, uint32_t size)
+{
+    while(size)
+    {
+        ssize_t n = write(fd, data, size);
+        if(n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const names[] = { "userboot", "user", "system" };
+    static factory_prog_t prog;
+    factory_image_t images[FACTORY_PROG_IMAGES];
+    uint8_t frame[FACTORY_PROG_FRAME_MAX];
+    const char *port = NULL;
+    uint32_t window = FACTORY_WINDOW;
+    uint32_t seconds = 60;
+    uint32_t count = 0;
+    uint32_t baud = FACTORY_PROG_SYNC_BAUD;
+    uint64_t start;
+    int opt;
+    int fd;
+
+    while((opt = getopt(argc, argv, "d:w:t:s:b:u:")) != -1)
+    {
+        uint32_t target = opt == 'b' ? BOOT_IMAGE_USERBOOT : opt == 'u' ? BOOT_IMAGE_USER : BOOT_IMAGE_SYSTEM;
+
+        switch(opt)
+        {
+        case 'd': port = optarg; break;
+        case 'w': window = strtoul(optarg, NULL, 0); break;
+        case 't': seconds = strtoul(optarg, NULL, 0); break;
+        case 's':
+        case 'b':
+        case 'u':
+            if(count == FACTORY_PROG_IMAGES)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            images[count].target = target;
+            images[count].data = load(optarg, &images[count].size);
+            if(!images[count].data)
+            {
+                fprintf(stderr, "%s: can't read\n", optarg);
+                return 1;
+            }
+            count++;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if(!port || count == 0 || window == 0 || window > FACTORY_WINDOW || optind != argc)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    fd = open(port, O_RDWR | O_NOCTTY);
+    if(fd < 0 || !port_baud(fd, baud))
+    {
+        fprintf(stderr, "%s: can't open\n", port);
+        return 1;
+    }
+    tcflush(fd, TCIOFLUSH);
+
+    factory_prog_start(&prog, images, count, window);
+    start = now();
+    while(prog.state == FACTORY_PROG_SYNC || prog.state == FACTORY_PROG_SESSION)
+    {
+        uint64_t t = now();
+        struct timeval tv = { 0, 1000 };
+        fd_set rd;
+        uint8_t in[64];
+        uint32_t size;
+        ssize_t n;
+
+        if(t - start > seconds * 1000000ULL)
+        {
+            fprintf(stderr, "%s: %s\n", port, prog.state == FACTORY_PROG_SYNC ? "no answer" : "timed out");
+            return 1;
+        }
+        if(factory_prog_baud(&prog) != baud)
+        {
+            baud = factory_prog_baud(&prog);
+            if(!port_baud(fd, baud))
+            {
+                fprintf(stderr, "%s: can't set %u baud\n", port, baud);
+                return 1;
+            }
+        }
+        size = factory_prog_send(&prog, t, frame);
+        if(size && !port_write(fd, frame, size))
+        {
+            fprintf(stderr, "%s: can't write\n", port);
+            return 1;
+        }
+        //the sync string goes out whole before the next, never queued up
+        if(size && prog.state == FACTORY_PROG_SYNC)
+            tcdrain(fd);
+
+        FD_ZERO(&rd);
+        FD_SET(fd, &rd);
+        if(select(fd + 1, &rd, NULL, NULL, &tv) <= 0)
+            continue;
+        n = read(fd, in, sizeof(in));
+        for(ssize_t i = 0; i < n; i++)
+            factory_prog_receive(&prog, in[i], now());
+    }
+    close(fd);
+
+    if(prog.state == FACTORY_PROG_FAILED)
+    {
+        uint32_t part;
+        uint32_t image = prog_locate(&prog, prog.acked ? prog.acked - 1 : 0, &part);
+        fprintf(stderr, "%s: %s\n", image < count ? names[images[image].target] : port, prog.error);
+        return 1;
+    }
+    for(uint32_t i = 0; i < count; i++)
+        printf("%-8s %8u bytes %8.1f ms\n", names[images[i].target], images[i].size, prog.install_us[i] / 1000.0);
+    printf("unit     %8.1f ms, %u NAKs, %u timeouts, %u frames resent\n",
+           (now() - start) / 1000.0, prog.naks, prog.timeouts, prog.resent);
+    return 0;
+}
+
+#endif
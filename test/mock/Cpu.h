@@ -0,0 +1,96 @@
+/*
+  Cpu.h - host stand-in for the Processor Expert CPU header
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_CPU_H_
+#define TEST_MOCK_CPU_H_
+
+//Just enough of Generated_Code/Cpu.h and the KSDK for the target-independent
+//sources (ring, crc, sha256, ...) to build natively.  PRIMASK is a plain
+//variable so tests can check what ran with interrupts masked.  SysTick and
+//SCB are a simulated counter (mock/systick.c): every register access lets
+//mock_systick_step core cycles pass and, with PRIMASK clear, takes a
+//pending tick by calling SysTick_Handler.  __WFI calls mock_wfi when a test
+//sets it, to let time pass until something wakes the core.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+#define FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE  (1024)
+#define FSL_FEATURE_FLASH_PFLASH_BLOCK_SIZE         (0x40000)
+#define FSL_FEATURE_FLASH_PFLASH_BLOCK_COUNT        (1)
+#define PGM_SIZE_BYTE                               (4)
+
+extern uint32_t mock_primask;
+
+static inline void __disable_irq(void) { mock_primask = 1; }
+static inline void __enable_irq(void) { mock_primask = 0; }
+static inline uint32_t __get_PRIMASK(void) { return mock_primask; }
+static inline void __set_PRIMASK(uint32_t primask) { mock_primask = primask; }
+
+uint32_t OSA_TimeGetMsec(void);
+void OSA_TimeDelay(uint32_t ms);
+void NVIC_SystemReset(void);
+
+typedef struct
+{
+    uint32_t CTRL;
+    uint32_t LOAD;
+    uint32_t VAL;
+    uint32_t CALIB;
+}SysTick_Type;
+
+typedef struct
+{
+    uint32_t CPUID;
+    uint32_t ICSR;
+}SCB_Type;
+
+#define SysTick_CTRL_ENABLE_Msk     (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk    (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk  (1UL << 2)
+#define SysTick_CTRL_COUNTFLAG_Msk  (1UL << 16)
+#define SysTick_LOAD_RELOAD_Msk     (0xFFFFFFUL)
+#define SCB_ICSR_PENDSTSET_Msk      (1UL << 26)
+#define SysTick_IRQn                (-1)
+#define FSL_FEATURE_SYSTICK_HAS_EXT_REF (0)
+
+extern SysTick_Type mock_systick_regs;
+extern SCB_Type mock_scb_regs;
+extern uint32_t mock_systick_step;
+extern uint64_t mock_systick_cycles;
+
+SysTick_Type *mock_systick(void);
+SCB_Type *mock_scb(void);
+void mock_systick_run(uint32_t cycles);
+uint32_t CLOCK_SYS_GetSystickFreq(void);
+
+#define SysTick                     (mock_systick())
+#define SCB                         (mock_scb())
+
+static inline void NVIC_SetPriority(int irq, uint32_t priority) { (void)irq; (void)priority; }
+extern void (*mock_wfi)(void);
+static inline void __WFI(void) { if(mock_wfi) mock_wfi(); }
+
+#endif /* TEST_MOCK_CPU_H_ */
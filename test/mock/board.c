@@ -0,0 +1,134 @@
+/*
+  board.c - virtual time for the host board model
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "board.h"
+#include "osa_timer.h"
+
+uint64_t board_ns;
+bool board_irqs_off;
+
+static board_model_t *models;
+
+void board_reset(void)
+{
+    board_ns = 0;
+    board_irqs_off = false;
+    models = NULL;
+}
+
+void board_add(board_model_t *model)
+{
+    model->link = models;
+    models = model;
+}
+
+bool board_irqs(void)
+{
+    return !mock_primask && !board_irqs_off;
+}
+
+static board_model_t *board_due(uint64_t *at)
+{
+    board_model_t *due = NULL;
+
+    *at = BOARD_NEVER;
+    for(board_model_t *model = models; model; model = model->link)
+    {
+        uint64_t next = model->next();
+        if(next < *at)
+        {
+            *at = next;
+            due = model;
+        }
+    }
+    return due;
+}
+
+void board_advance(uint64_t ns)
+{
+    uint64_t end = board_ns + ns;
+
+    //a model's run may schedule work for any later time, so look again
+    //after each one; models running late catch up at the current time
+    for(;;)
+    {
+        uint64_t at;
+        board_model_t *due = board_due(&at);
+
+        if(!due || at > end)
+            break;
+        if(at > board_ns)
+            board_ns = at;
+        due->run();
+    }
+    board_ns = end;
+}
+
+void board_pin(uint32_t pin, bool high)
+{
+    for(board_model_t *model = models; model; model = model->link)
+        if(model->pin)
+            model->pin(pin, high);
+}
+
+uint32_t OSA_TimeGetMsec(void)
+{
+    board_advance(BOARD_POLL_NS);
+    return (uint32_t)(board_ns / BOARD_MS);
+}
+
+uint64_t OSA_TimeGetUsec(void)
+{
+    board_advance(BOARD_POLL_NS);
+    return board_ns / BOARD_US;
+}
+
+void OSA_TimeDelay(uint32_t ms)
+{
+    board_advance(ms * BOARD_MS);
+}
+
+void OSA_TimeDelayUsec(uint32_t usec)
+{
+    board_advance(usec * BOARD_US);
+}
+
+uint64_t OSA_TimeGetCycles(void)
+{
+    board_advance(BOARD_POLL_NS);
+    return board_ns * BOARD_CORE_MHZ / BOARD_US;
+}
+
+void OSA_TimeIdle(uint32_t ms)
+{
+    //the WFI: the next interrupt wakes it, masked or not, and is taken
+    //as the caller unmasks; the model that raises it runs here instead
+    uint32_t primask = mock_primask;
+    uint64_t end = board_ns + ms * BOARD_MS;
+    uint64_t at;
+
+    mock_primask = 0;
+    if(board_due(&at) && at < end)
+        end = at > board_ns ? at : board_ns;
+    board_advance(end - board_ns);
+    mock_primask = primask;
+}
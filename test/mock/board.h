@@ -0,0 +1,60 @@
+/*
+  board.h - host model of the board around the bootloader
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_BOARD_H_
+#define TEST_MOCK_BOARD_H_
+
+//A virtual clock for tests that run the loaders end to end.  The OSA timing
+//calls read it and delays advance it; every read also costs BOARD_POLL_NS,
+//so the bootloader's busy-wait loops let time pass.  OSA_TimeIdle sleeps
+//until the next model action, as the WFI does until an interrupt.  The devices on the
+//board (modem, SPI flashes) are models that say when they next act and
+//are run as the clock reaches that time.  Driver interrupt work is only
+//done while interrupts could be taken: PRIMASK clear and board_irqs_off,
+//which stands in for the NVIC mask the flash routines apply, false.
+
+#include "Cpu.h"
+
+#define BOARD_NEVER         (UINT64_MAX)
+#define BOARD_POLL_NS       (2000)
+#define BOARD_US            (1000ULL)
+#define BOARD_MS            (1000000ULL)
+#define BOARD_CORE_MHZ      (48)            //OSA_TimeGetCycles
+
+typedef struct board_model
+{
+    uint64_t (*next)(void);                 //ns of its next action, BOARD_NEVER for none
+    void (*run)(void);                      //take the actions due by board_ns
+    void (*pin)(uint32_t pin, bool high);   //a GPIO changed level, may be NULL
+    struct board_model *link;
+}board_model_t;
+
+extern uint64_t board_ns;
+extern bool board_irqs_off;
+
+void board_reset(void);                     //time 0, no models
+void board_add(board_model_t *model);
+void board_advance(uint64_t ns);
+bool board_irqs(void);                      //interrupts would be taken now
+void board_pin(uint32_t pin, bool high);
+
+#endif /* TEST_MOCK_BOARD_H_ */
@@ -0,0 +1,221 @@
+/*
+  ezport.c - host model of the user module's EZPort
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ezport.h"
+#include "board.h"
+#include "gpio1.h"
+#include "spiComEZPort.h"
+
+#define EZPORT_WIP          (0x01)
+#define EZPORT_WEN          (0x02)
+#define EZPORT_SECTION_MAX  (256)
+
+uint8_t mock_ezport[MOCK_EZPORT_SIZE];
+uint32_t mock_ezport_erases;
+uint32_t mock_ezport_programs;
+uint32_t mock_ezport_violations;
+uint32_t mock_ezport_last;
+uint32_t mock_ezport_boots;
+
+static bool cs_low;
+static bool reset_low;
+static bool enabled;
+static bool wen;
+static uint64_t busy_until;
+static uint8_t opcode;
+static uint32_t count;
+static uint32_t address;
+static uint8_t section[EZPORT_SECTION_MAX];
+static uint32_t section_len;
+
+static bool EZPORT_busy(void)
+{
+    return board_ns < busy_until;
+}
+
+static uint8_t EZPORT_exchange(uint8_t out)
+{
+    uint32_t n = count++;
+
+    if(!cs_low)
+        return 0xFF;
+    if(!enabled)
+    {
+        mock_ezport_violations++;
+        return 0xFF;
+    }
+
+    if(n == 0)
+    {
+        opcode = out;
+        if(EZPORT_busy() && opcode != 0x05)
+        {
+            mock_ezport_violations++;
+            opcode = 0;
+        }
+        return 0xFF;
+    }
+
+    switch(opcode)
+    {
+    case 0x05:
+        return (EZPORT_busy() ? EZPORT_WIP : 0) | (wen ? EZPORT_WEN : 0);
+    case 0x03:
+    case 0x02:
+    case 0xD8:
+        if(n <= 3)
+        {
+            address = (address << 8 | out) & (MOCK_EZPORT_SIZE - 1);
+            return 0xFF;
+        }
+        if(opcode == 0x03)
+            return mock_ezport[address++ & (MOCK_EZPORT_SIZE - 1)];
+        if(opcode == 0x02)
+        {
+            if(section_len == EZPORT_SECTION_MAX)
+                mock_ezport_violations++;
+            else
+                section[section_len++] = out;
+        }
+        return 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+//the flash command starts as the select goes high
+static void EZPORT_deselect(void)
+{
+    if(!enabled || count == 0)
+        return;
+    if(opcode == 0x06)
+        wen = true;
+    else if(opcode == 0x04)
+        wen = false;
+    if(opcode != 0x02 && opcode != 0xD8)
+        return;
+
+    if(!wen || count < 4)
+    {
+        mock_ezport_violations++;
+        return;
+    }
+    wen = false;
+
+    if(opcode == 0xD8)
+    {
+        memset(&mock_ezport[address & ~(MOCK_EZPORT_SECTOR_SIZE - 1)], 0xFF, MOCK_EZPORT_SECTOR_SIZE);
+        busy_until = board_ns + MOCK_EZPORT_ERASE_US * BOARD_US;
+        mock_ezport_erases++;
+        return;
+    }
+
+    //the FTFE programs whole phrases, each once after an erase
+    if(section_len == 0 || section_len % MOCK_EZPORT_PHRASE_SIZE || address % MOCK_EZPORT_PHRASE_SIZE)
+    {
+        mock_ezport_violations++;
+        return;
+    }
+    for(uint32_t i = 0; i < section_len; i++)
+    {
+        if(mock_ezport[address + i] != 0xFF)
+        {
+            mock_ezport_violations++;
+            return;
+        }
+    }
+    memcpy(&mock_ezport[address], section, section_len);
+    busy_until = board_ns + (uint64_t)MOCK_EZPORT_PROGRAM_US * BOARD_US * section_len / 1024;
+    mock_ezport_programs++;
+    mock_ezport_last = address;
+}
+
+static uint64_t EZPORT_next(void)
+{
+    return BOARD_NEVER;
+}
+
+static void EZPORT_run(void)
+{
+}
+
+static void EZPORT_pin(uint32_t pin, bool high)
+{
+    if(pin == M1_EZPCS)
+    {
+        cs_low = !high;
+        if(cs_low)
+        {
+            count = 0;
+            opcode = 0;
+            address = 0;
+            section_len = 0;
+        }
+        else
+            EZPORT_deselect();
+    }
+    else if(pin == M1_RESET)
+    {
+        reset_low = !high;
+        if(reset_low)
+        {
+            //a reset aborts EZPort, and any flash command with it
+            enabled = false;
+            wen = false;
+            busy_until = 0;
+        }
+        else
+        {
+            enabled = cs_low;
+            if(!enabled)
+                mock_ezport_boots++;
+        }
+    }
+}
+
+static board_model_t ezport_model = {
+    .next = EZPORT_next,
+    .run = EZPORT_run,
+    .pin = EZPORT_pin,
+};
+
+void mock_ezport_init(void)
+{
+    memset(mock_ezport, 0xFF, sizeof(mock_ezport));
+    mock_ezport_erases = 0;
+    mock_ezport_programs = 0;
+    mock_ezport_violations = 0;
+    mock_ezport_last = 0;
+    mock_ezport_boots = 0;
+    cs_low = false;
+    reset_low = false;
+    enabled = false;
+    wen = false;
+    busy_until = 0;
+    board_add(&ezport_model);
+    mock_spi_attach(FSL_SPICOMEZPORT, EZPORT_exchange);
+}
+
+bool mock_ezport_enabled(void)
+{
+    return enabled;
+}
@@ -0,0 +1,54 @@
+/*
+  ezport.h - host model of the user module's EZPort
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_EZPORT_H_
+#define TEST_MOCK_EZPORT_H_
+
+//The user module (M1) as ext_flash.c sees it on the EZPort bus, a
+//Kinetis part with an FTFE: it enters EZPort when M1_RESET is released
+//with M1_EZPCS low and runs its application when released with it high.
+//In EZPort it takes WREN/WRDI, RDSR, READ, section program (0x02, whole
+//16 byte phrases over erased flash) and sector erase (0xD8); the times
+//are the part's typical ones, a section program scaled from 1KB.  Bytes
+//clocked while not in EZPort, or a command it would refuse, count a
+//violation.
+
+#include "Cpu.h"
+
+#define MOCK_EZPORT_SIZE            (256 * 1024)
+#define MOCK_EZPORT_SECTOR_SIZE     (4096)
+#define MOCK_EZPORT_PHRASE_SIZE     (16)
+#define MOCK_EZPORT_ERASE_US        (15000)     //tersscr, 4KB sector
+#define MOCK_EZPORT_PROGRAM_US      (5000)      //tpgmsec1k, per 1KB section
+
+extern uint8_t mock_ezport[MOCK_EZPORT_SIZE];
+extern uint32_t mock_ezport_erases;
+extern uint32_t mock_ezport_programs;
+extern uint32_t mock_ezport_violations;
+extern uint32_t mock_ezport_last;           //address of the last section programmed
+extern uint32_t mock_ezport_boots;          //resets released into the application
+
+//powers on now: erased and running, on the FSL_SPICOMEZPORT bus
+void mock_ezport_init(void);
+bool mock_ezport_enabled(void);             //in EZPort, the core held
+
+#endif /* TEST_MOCK_EZPORT_H_ */
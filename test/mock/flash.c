@@ -0,0 +1,78 @@
+/*
+  flash.c - host model of the internal flash
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "flash.h"
+#include "flash1.h"
+#include "board.h"
+
+uint8_t mock_flash[FSL_FEATURE_FLASH_PFLASH_BLOCK_SIZE];
+uint32_t mock_flash_erases;
+uint32_t mock_flash_programs;
+uint32_t mock_flash_violations;
+
+void mock_flash_reset(void)
+{
+    memset(mock_flash, 0xFF, sizeof(mock_flash));
+    mock_flash_erases = 0;
+    mock_flash_programs = 0;
+    mock_flash_violations = 0;
+}
+
+static void FLASH_busy(uint64_t ns)
+{
+    board_irqs_off = true;
+    board_advance(ns);
+    board_irqs_off = false;
+}
+
+bool FLASH_erase_sector(uint32_t sector_address)
+{
+    if(sector_address % FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE || sector_address >= sizeof(mock_flash))
+    {
+        mock_flash_violations++;
+        return false;
+    }
+    FLASH_busy(MOCK_FLASH_ERASE_US * BOARD_US);
+    memset(&mock_flash[sector_address], 0xFF, FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE);
+    mock_flash_erases++;
+    return true;
+}
+
+bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size)
+{
+    if(address % PGM_SIZE_BYTE || size % PGM_SIZE_BYTE || address + size > sizeof(mock_flash))
+    {
+        mock_flash_violations++;
+        return false;
+    }
+    FLASH_busy((uint64_t)size / PGM_SIZE_BYTE * MOCK_FLASH_PROGRAM_US * BOARD_US);
+    for(uint32_t i = 0; i < size; i++)
+    {
+        if(mock_flash[address + i] != 0xFF && block[i] != 0xFF)
+            mock_flash_violations++;
+        mock_flash[address + i] &= block[i];
+    }
+    mock_flash_programs += size / PGM_SIZE_BYTE;
+
+    //flash.c verifies in place
+    return memcmp(&mock_flash[address], block, size) == 0;
+}
@@ -0,0 +1,46 @@
+/*
+  flash1.h - host stand-in for the flash driver component
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_FLASH1_H_
+#define TEST_MOCK_FLASH1_H_
+
+#include "Cpu.h"
+
+typedef struct { uint32_t PFlashBase; }FLASH_SSD_CONFIG, *PFLASH_SSD_CONFIG;
+
+extern FLASH_SSD_CONFIG flash1_InitConfig0;
+
+uint32_t FlashInit(PFLASH_SSD_CONFIG pSSDConfig);
+
+//mock/flash.c: flash.h's FLASH_* over an array standing in for the P-flash,
+//each command taking the FTFA's typical time with the NVIC masked
+#define MOCK_FLASH_ERASE_US         (14000)     //tersscr, 1KB sector
+#define MOCK_FLASH_PROGRAM_US       (65)        //tpgm4, per longword
+
+extern uint8_t mock_flash[FSL_FEATURE_FLASH_PFLASH_BLOCK_SIZE];
+extern uint32_t mock_flash_erases;
+extern uint32_t mock_flash_programs;
+extern uint32_t mock_flash_violations;      //unaligned, out of range or over unerased bytes
+
+void mock_flash_reset(void);
+
+#endif /* TEST_MOCK_FLASH1_H_ */
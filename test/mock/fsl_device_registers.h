@@ -0,0 +1,29 @@
+/*
+  fsl_device_registers.h - host stand-in for the KSDK register headers
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_FSL_DEVICE_REGISTERS_H_
+#define TEST_MOCK_FSL_DEVICE_REGISTERS_H_
+
+//the registers a test needs come with the component that uses them
+#include "Cpu.h"
+
+#endif /* TEST_MOCK_FSL_DEVICE_REGISTERS_H_ */
@@ -0,0 +1,119 @@
+/*
+  gpio.c - host model of the GPIO driver
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "gpio1.h"
+#include "board.h"
+
+//every modelled line idles high: the chip selects are outputs driven
+//high, UBLOX_RESET_N and M1_RESET are pulled up on the far side
+#define GPIO_PORTS      (5)
+#define GPIO_INDEX(pin) (GPIO_EXTRACT_PORT(pin) * 32 + GPIO_EXTRACT_PIN(pin))
+
+PORT_Type mock_ports[GPIO_PORTS];
+
+const gpio_input_pin_user_config_t gpio1_InpConfig0[] = {
+    { .pinName = WAKE_M2, .config.pullSelect = kPortPullUp },
+    { .pinName = M1_RESET, .config.pullSelect = kPortPullDown },
+    { .pinName = GPIO_PINS_OUT_OF_RANGE },
+};
+
+const gpio_output_pin_user_config_t gpio1_OutConfig0[] = {
+    { .pinName = WAKE_M1, .config.outputLogic = 0 },
+    { .pinName = M2_SS, .config.outputLogic = 1 },
+    { .pinName = M1_EZPCS, .config.outputLogic = 1 },
+    { .pinName = GPIO_PINS_OUT_OF_RANGE },
+};
+
+static bool output[GPIO_PORTS * 32];
+static bool latch[GPIO_PORTS * 32];
+
+static bool GPIO_level(uint32_t index)
+{
+    return !output[index] || latch[index];
+}
+
+static void GPIO_set(uint32_t pin, bool out, bool high)
+{
+    uint32_t index = GPIO_INDEX(pin);
+    bool was = GPIO_level(index);
+
+    output[index] = out;
+    latch[index] = high;
+    if(GPIO_level(index) != was)
+        board_pin(pin, !was);
+}
+
+void mock_gpio_reset(void)
+{
+    memset(output, 0, sizeof(output));
+    memset(latch, 0, sizeof(latch));
+    memset(mock_ports, 0, sizeof(mock_ports));
+}
+
+void GPIO_DRV_Init(const gpio_input_pin_user_config_t *inputPins, const gpio_output_pin_user_config_t *outputPins)
+{
+    for(; inputPins && inputPins->pinName != GPIO_PINS_OUT_OF_RANGE; inputPins++)
+        GPIO_DRV_InputPinInit(inputPins);
+    for(; outputPins && outputPins->pinName != GPIO_PINS_OUT_OF_RANGE; outputPins++)
+        GPIO_DRV_OutputPinInit(outputPins);
+}
+
+void GPIO_DRV_InputPinInit(const gpio_input_pin_user_config_t *inputPin)
+{
+    uint32_t index = GPIO_INDEX(inputPin->pinName);
+    GPIO_set(inputPin->pinName, false, latch[index]);
+}
+
+void GPIO_DRV_OutputPinInit(const gpio_output_pin_user_config_t *outputPin)
+{
+    GPIO_set(outputPin->pinName, true, outputPin->config.outputLogic);
+}
+
+void GPIO_DRV_SetPinDir(uint32_t pin, gpio_pin_direction_t direction)
+{
+    GPIO_set(pin, direction == kGpioDigitalOutput, latch[GPIO_INDEX(pin)]);
+}
+
+void GPIO_DRV_SetPinOutput(uint32_t pin)
+{
+    GPIO_set(pin, output[GPIO_INDEX(pin)], true);
+}
+
+void GPIO_DRV_ClearPinOutput(uint32_t pin)
+{
+    GPIO_set(pin, output[GPIO_INDEX(pin)], false);
+}
+
+void GPIO_DRV_WritePinOutput(uint32_t pin, uint32_t value)
+{
+    GPIO_set(pin, output[GPIO_INDEX(pin)], value != 0);
+}
+
+uint32_t GPIO_DRV_ReadPinInput(uint32_t pin)
+{
+    return GPIO_level(GPIO_INDEX(pin));
+}
+
+void PORT_HAL_SetMuxMode(PORT_Type *base, uint32_t pin, port_mux_t mux)
+{
+    base->PCR[pin] = mux;
+}
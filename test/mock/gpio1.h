@@ -0,0 +1,105 @@
+/*
+  gpio1.h - host stand-in for the GPIO component
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_GPIO1_H_
+#define TEST_MOCK_GPIO1_H_
+
+#include "Cpu.h"
+#include "pin_mux.h"
+
+#define GPIO_PORT_SHIFT             (0x8U)
+#define GPIO_MAKE_PIN(r,p)          (((r)<< GPIO_PORT_SHIFT) | (p))
+#define GPIO_EXTRACT_PORT(v)        (((v) >> GPIO_PORT_SHIFT) & 0xFFU)
+#define GPIO_EXTRACT_PIN(v)         ((v) & 0xFFU)
+
+enum
+{
+    WAKE_M2 = GPIO_MAKE_PIN(GPIOC_IDX, 6U),
+    M1_RESET = GPIO_MAKE_PIN(GPIOC_IDX, 5U),
+    WAKE_M1 = GPIO_MAKE_PIN(GPIOC_IDX, 7U),
+    M2_SS = GPIO_MAKE_PIN(GPIOD_IDX, 4U),
+    M1_EZPCS = GPIO_MAKE_PIN(GPIOE_IDX, 16U),
+    GPIO_PINS_OUT_OF_RANGE = 0xFFFFFFFFU,
+};
+
+typedef enum
+{
+    kGpioDigitalInput,
+    kGpioDigitalOutput,
+}gpio_pin_direction_t;
+
+typedef enum
+{
+    kPortPullDown,
+    kPortPullUp,
+}port_pull_t;
+
+typedef enum
+{
+    kPortIntDisabled,
+}port_interrupt_config_t;
+
+typedef enum
+{
+    kPortPinDisabled,
+    kPortMuxAsGpio,
+    kPortMuxAlt2,
+}port_mux_t;
+
+typedef struct
+{
+    bool isPullEnable;
+    port_pull_t pullSelect;
+    bool isPassiveFilterEnabled;
+    port_interrupt_config_t interrupt;
+}gpio_input_pin_t;
+
+typedef struct
+{
+    uint32_t outputLogic;
+}gpio_output_pin_t;
+
+typedef struct { uint32_t pinName; gpio_input_pin_t config; }gpio_input_pin_user_config_t;
+typedef struct { uint32_t pinName; gpio_output_pin_t config; }gpio_output_pin_user_config_t;
+
+typedef struct { uint32_t PCR[32]; }PORT_Type;
+extern PORT_Type mock_ports[5];
+#define PORTD                       (&mock_ports[3])
+#define PORTE                       (&mock_ports[4])
+
+extern const gpio_input_pin_user_config_t gpio1_InpConfig0[];
+extern const gpio_output_pin_user_config_t gpio1_OutConfig0[];
+
+void GPIO_DRV_Init(const gpio_input_pin_user_config_t *inputPins, const gpio_output_pin_user_config_t *outputPins);
+void GPIO_DRV_InputPinInit(const gpio_input_pin_user_config_t *inputPin);
+void GPIO_DRV_OutputPinInit(const gpio_output_pin_user_config_t *outputPin);
+void GPIO_DRV_SetPinDir(uint32_t pin, gpio_pin_direction_t direction);
+void GPIO_DRV_SetPinOutput(uint32_t pin);
+void GPIO_DRV_ClearPinOutput(uint32_t pin);
+void GPIO_DRV_WritePinOutput(uint32_t pin, uint32_t output);
+uint32_t GPIO_DRV_ReadPinInput(uint32_t pin);
+void PORT_HAL_SetMuxMode(PORT_Type *base, uint32_t pin, port_mux_t mux);
+
+//mock/gpio.c: all pins inputs, levels reported through board_pin
+void mock_gpio_reset(void);
+
+#endif /* TEST_MOCK_GPIO1_H_ */
@@ -0,0 +1,155 @@
+/*
+  i2cCom1.h - host stand-in for the I2C slave component, its driver and DMA
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_I2CCOM1_H_
+#define TEST_MOCK_I2CCOM1_H_
+
+//The slice of the KSDK I2C slave driver, the I2C0 and DMA0 registers and
+//the interrupt manager that ipc_i2c.c touches.  mock/i2c.c plays the bus:
+//the master addresses the slave, clocks bytes in and sends STOP, and the
+//driver's receive path (I2C_DRV_SlaveIRQHandler) or the DMA channel takes
+//each byte, the way the hardware routes them with and without DMAEN.
+//A master read takes the bytes the handler queued for transmit.
+
+#include "Cpu.h"
+
+#define FSL_I2CCOM1                 (0)
+
+typedef enum
+{
+    kI2CSlaveStartDetect  = 0x01u,
+    kI2CSlaveTxReq        = 0x02u,
+    kI2CSlaveRxReq        = 0x04u,
+    kI2CSlaveTxNAK        = 0x08u,
+    kI2CSlaveTxEmpty      = 0x10u,
+    kI2CSlaveRxFull       = 0x20u,
+    kI2CSlaveAbort        = 0x40u,
+    kI2CSlaveStopDetect   = 0x80u,
+}i2c_slave_event_t;
+
+typedef struct
+{
+    volatile uint32_t txSize;
+    volatile uint32_t rxSize;
+    const uint8_t *txBuff;
+    uint8_t *rxBuff;
+    bool isTxBusy;
+    bool isRxBusy;
+}i2c_slave_state_t;
+
+typedef struct { uint16_t address; }i2c_slave_user_config_t;
+
+extern i2c_slave_state_t i2cCom1_SlaveState;
+extern const i2c_slave_user_config_t i2cCom1_SlaveConfig0;
+
+void I2C_DRV_SlaveInit(uint32_t instance, const i2c_slave_user_config_t *userConfig, i2c_slave_state_t *slave);
+void I2C_DRV_SlaveDeinit(uint32_t instance);
+
+typedef struct
+{
+    uint8_t D;
+    bool    dmaen;                  //C1[DMAEN]
+    bool    high_drive;
+    uint8_t glitch_width;
+}I2C_Type;
+
+typedef struct
+{
+    struct
+    {
+        uint32_t SAR;
+        uint32_t DAR;
+        uint32_t DSR_BCR;
+        uint32_t DCR;
+    }DMA[4];
+}DMA_Type;
+
+typedef struct
+{
+    uint8_t CHCFG[4];
+}DMAMUX_Type;
+
+typedef struct
+{
+    uint32_t SCGC6;
+    uint32_t SCGC7;
+}SIM_Type;
+
+extern I2C_Type mock_i2c0;
+extern DMA_Type mock_dma0;
+extern DMAMUX_Type mock_dmamux0;
+extern SIM_Type mock_sim;
+
+#define I2C0                        (&mock_i2c0)
+#define DMA0                        (&mock_dma0)
+#define DMAMUX0                     (&mock_dmamux0)
+#define SIM                         (&mock_sim)
+
+#define DMA_DSR_BCR_BCR_MASK        (0xFFFFFFu)
+#define DMA_DSR_BCR_BCR(x)          ((uint32_t)(x) & DMA_DSR_BCR_BCR_MASK)
+#define DMA_DSR_BCR_DONE_MASK       (1u << 24)
+#define DMA_DSR_BCR_BSY_MASK        (1u << 25)
+#define DMA_DSR_BCR_REQ_MASK        (1u << 26)
+#define DMA_DSR_BCR_BED_MASK        (1u << 28)
+#define DMA_DSR_BCR_BES_MASK        (1u << 29)
+#define DMA_DSR_BCR_CE_MASK         (1u << 30)
+#define DMA_DCR_D_REQ_MASK          (1u << 7)
+#define DMA_DCR_DSIZE(x)            (((uint32_t)(x) & 3u) << 17)
+#define DMA_DCR_DINC_MASK           (1u << 19)
+#define DMA_DCR_SSIZE(x)            (((uint32_t)(x) & 3u) << 20)
+#define DMA_DCR_CS_MASK             (1u << 29)
+#define DMA_DCR_ERQ_MASK            (1u << 30)
+#define DMA_DCR_EINT_MASK           (1u << 31)
+#define DMAMUX_CHCFG_SOURCE(x)      ((uint8_t)((x) & 0x3Fu))
+#define DMAMUX_CHCFG_ENBL_MASK      (0x80u)
+#define SIM_SCGC6_DMAMUX_MASK       (1u << 1)
+#define SIM_SCGC7_DMA_MASK          (1u << 8)
+
+typedef enum
+{
+    DMA0_IRQn = 0,
+    I2C0_IRQn = 8,
+}IRQn_Type;
+
+void INT_SYS_EnableIRQ(IRQn_Type irq);
+void INT_SYS_DisableIRQ(IRQn_Type irq);
+void OSA_InstallIntHandler(int32_t irq, void (*handler)(void));
+
+static inline void I2C_HAL_SetDmaCmd(I2C_Type *base, bool enable) { base->dmaen = enable; }
+static inline void I2C_HAL_SetHighDriveCmd(I2C_Type *base, bool enable) { base->high_drive = enable; }
+static inline void I2C_HAL_SetGlitchWidth(I2C_Type *base, uint8_t width) { base->glitch_width = width; }
+
+//the bus, driven by the test
+extern void (*mock_i2c_callback)(i2c_slave_event_t event);
+extern uint32_t mock_i2c_irqs;      //I2C0 interrupts taken
+extern uint32_t mock_dma_irqs;      //DMA0 interrupts taken
+extern bool mock_dma_defer;         //leave the DMA done interrupt pending
+
+void mock_i2c_reset(void);
+void mock_i2c_address(void);
+void mock_i2c_byte(uint8_t data);
+void mock_i2c_read(uint8_t *data, uint32_t size);
+bool mock_i2c_enabled(void);        //I2C0 interrupt unmasked at the NVIC
+void mock_i2c_stop(void);
+void mock_dma_service(void);
+
+#endif /* TEST_MOCK_I2CCOM1_H_ */
@@ -0,0 +1,324 @@
+/*
+  lpuart.c - host model of the LPUART driver and its line
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "lpuartUblox.h"
+#include "board.h"
+
+//The driver calls follow KSDK 1.2 fsl_lpuart_driver.c, and
+//LPUART_IRQ is its LPUART_DRV_IRQHandler.  Underneath, the transmitter
+//moves the data register to the shift register as soon as it empties and
+//hands each byte to the peer once its stop bit is out; the receiver holds
+//one byte, and a second one before the interrupt takes it is an overrun.
+
+lpuart_state_t lpuartUblox_State;
+LPUART_Type mock_lpuart0;
+lpuart_user_config_t lpuartUblox_InitConfig0 = { .baudRate = 115200 };
+uint32_t mock_lpuart_baud;
+uint32_t mock_lpuart_overruns;
+void (*mock_lpuart_peer)(uint8_t data);
+
+static lpuart_state_t *lpuart;          //g_lpuartStatePtr
+static bool tie;
+static bool rie;
+static bool enabled;
+static bool rdrf;
+static uint8_t rdr;
+static bool tdr_full;
+static uint8_t tdr;
+static bool shifting;
+static uint8_t shift;
+static uint64_t shift_end;
+
+uint64_t mock_lpuart_byte_ns(void)
+{
+    //start, 8 data and stop bits
+    return 10 * 1000000000ULL / mock_lpuart_baud;
+}
+
+static bool LPUART_irq_pending(void)
+{
+    if(!lpuart || !board_irqs())
+        return false;
+    return (rie && rdrf) || (tie && !tdr_full && lpuart->txSize);
+}
+
+static uint64_t LPUART_next(void)
+{
+    if(LPUART_irq_pending() || (tdr_full && !shifting))
+        return board_ns;
+    return shifting ? shift_end : BOARD_NEVER;
+}
+
+static void LPUART_shift(void)
+{
+    if(shifting && board_ns >= shift_end)
+    {
+        shifting = false;
+        if(mock_lpuart_peer)
+            mock_lpuart_peer(shift);
+    }
+    if(!shifting && tdr_full)
+    {
+        shifting = true;
+        shift = tdr;
+        tdr_full = false;
+        shift_end = board_ns + mock_lpuart_byte_ns();
+    }
+}
+
+static void LPUART_IRQ(void)
+{
+    if(!lpuart->isTxBusy && !lpuart->isRxBusy)
+        return;
+
+    if(rie && rdrf)
+    {
+        rdrf = false;
+        *lpuart->rxBuff = rdr;
+        if(lpuart->rxCallback != NULL)
+        {
+            lpuart->rxCallback(FSL_LPUARTUBLOX, lpuart);
+        }
+        else
+        {
+            ++lpuart->rxBuff;
+            if(--lpuart->rxSize == 0)
+                lpuart->isRxBusy = false;
+        }
+    }
+
+    if(tie && !tdr_full && lpuart->txSize)
+    {
+        tdr = *lpuart->txBuff;
+        tdr_full = true;
+        if(lpuart->txCallback != NULL)
+        {
+            lpuart->txCallback(FSL_LPUARTUBLOX, lpuart);
+        }
+        else
+        {
+            ++lpuart->txBuff;
+            --lpuart->txSize;
+        }
+        if(lpuart->txSize == 0)
+        {
+            tie = false;
+            lpuart->isTxBusy = false;
+        }
+    }
+}
+
+static void LPUART_run(void)
+{
+    LPUART_shift();
+    if(LPUART_irq_pending())
+        LPUART_IRQ();
+    LPUART_shift();
+}
+
+static board_model_t lpuart_model = {
+    .next = LPUART_next,
+    .run = LPUART_run,
+};
+
+void mock_lpuart_reset(void)
+{
+    lpuart = NULL;
+    tie = rie = enabled = false;
+    rdrf = tdr_full = shifting = false;
+    mock_lpuart_baud = lpuartUblox_InitConfig0.baudRate;
+    mock_lpuart_overruns = 0;
+    mock_lpuart_peer = NULL;
+    board_add(&lpuart_model);
+}
+
+void mock_lpuart_rx(uint8_t data)
+{
+    if(!enabled)
+        return;
+    if(rdrf)
+    {
+        mock_lpuart_overruns++;
+        return;
+    }
+    rdr = data;
+    rdrf = true;
+}
+
+void LPUART_DRV_Init(uint32_t instance, lpuart_state_t *lpuartStatePtr, const lpuart_user_config_t *lpuartUserConfig)
+{
+    (void)instance;
+    if(lpuart)
+        return;
+    memset(lpuartStatePtr, 0, sizeof(lpuart_state_t));
+    lpuart = lpuartStatePtr;
+    mock_lpuart_baud = lpuartUserConfig->baudRate;
+    rdrf = false;
+    enabled = true;
+}
+
+void LPUART_DRV_Deinit(uint32_t instance)
+{
+    (void)instance;
+    if(!lpuart)
+        return;
+    //waits for transmission complete
+    while(tdr_full || shifting)
+        board_advance(BOARD_POLL_NS);
+    tie = rie = enabled = false;
+    lpuart = NULL;
+}
+
+lpuart_rx_callback_t LPUART_DRV_InstallRxCallback(uint32_t instance, lpuart_rx_callback_t function,
+                                                   uint8_t *rxBuff, void *callbackParam, bool alwaysEnableRxIrq)
+{
+    lpuart_rx_callback_t current = lpuart->rxCallback;
+
+    (void)instance;
+    lpuart->rxCallback = function;
+    lpuart->rxCallbackParam = callbackParam;
+    lpuart->rxBuff = rxBuff;
+    lpuart->isRxBusy = true;
+    rie = alwaysEnableRxIrq;
+    return current;
+}
+
+lpuart_tx_callback_t LPUART_DRV_InstallTxCallback(uint32_t instance, lpuart_tx_callback_t function,
+                                                   uint8_t *txBuff, void *callbackParam)
+{
+    lpuart_tx_callback_t current = lpuart->txCallback;
+
+    (void)instance;
+    lpuart->txCallback = function;
+    lpuart->txCallbackParam = callbackParam;
+    lpuart->txBuff = txBuff;
+    return current;
+}
+
+static lpuart_status_t LPUART_start(const uint8_t *txBuff, uint32_t txSize)
+{
+    if(lpuart->isTxBusy)
+        return kStatus_LPUART_TxBusy;
+    if(txSize == 0)
+        return kStatus_LPUART_NoDataToDeal;
+    lpuart->txBuff = txBuff;
+    lpuart->txSize = txSize;
+    lpuart->isTxBusy = true;
+    tie = true;
+    return kStatus_LPUART_Success;
+}
+
+lpuart_status_t LPUART_DRV_SendData(uint32_t instance, const uint8_t *txBuff, uint32_t txSize)
+{
+    (void)instance;
+    lpuart->isTxBlocking = false;
+    return LPUART_start(txBuff, txSize);
+}
+
+lpuart_status_t LPUART_DRV_SendDataBlocking(uint32_t instance, const uint8_t *txBuff, uint32_t txSize, uint32_t timeout)
+{
+    lpuart_status_t status;
+
+    (void)instance;
+    lpuart->isTxBlocking = true;
+    status = LPUART_start(txBuff, txSize);
+    if(status != kStatus_LPUART_Success)
+        return status;
+
+    //the bare metal OSA_SemaWait polls the millisecond clock
+    uint32_t start = OSA_TimeGetMsec();
+    while(lpuart->isTxBusy)
+    {
+        if(OSA_TimeGetMsec() - start >= timeout)
+        {
+            tie = false;
+            lpuart->isTxBusy = false;
+            return kStatus_LPUART_Timeout;
+        }
+    }
+    return kStatus_LPUART_Success;
+}
+
+lpuart_status_t LPUART_DRV_GetTransmitStatus(uint32_t instance, uint32_t *bytesRemaining)
+{
+    (void)instance;
+    board_advance(BOARD_POLL_NS);
+    if(bytesRemaining)
+        *bytesRemaining = lpuart->txSize;
+    return lpuart->txSize ? kStatus_LPUART_TxBusy : kStatus_LPUART_Success;
+}
+
+bool LPUART_HAL_GetStatusFlag(LPUART_Type *base, lpuart_status_flag_t statusFlag)
+{
+    (void)base;
+    (void)statusFlag;
+    //each read is a poll: TC sets once the shift register is empty
+    board_advance(BOARD_POLL_NS);
+    return !tdr_full && !shifting;
+}
+
+void LPUART_HAL_SetTransmitterCmd(LPUART_Type *base, bool enable)
+{
+    (void)base;
+    (void)enable;
+}
+
+void LPUART_HAL_SetReceiverCmd(LPUART_Type *base, bool enable)
+{
+    (void)base;
+    enabled = enable;
+    if(!enable)
+        rdrf = false;
+}
+
+lpuart_status_t LPUART_HAL_SetBaudRate(LPUART_Type *base, uint32_t sourceClockInHz, uint32_t desiredBaudRate)
+{
+    uint32_t best = 0;
+    uint32_t best_diff = UINT32_MAX;
+
+    //KSDK 1.2: baud = clock / (OSR * SBR), OSR 4 to 32, the closest wins
+    //and ties go to the higher OSR
+    for(uint32_t osr = 4; osr <= 32; osr++)
+    {
+        uint32_t sbr = sourceClockInHz / (desiredBaudRate * osr);
+        if(sbr == 0 || sbr > 0x1FFF)
+            continue;
+        uint32_t baud = sourceClockInHz / (osr * sbr);
+        uint32_t diff = baud > desiredBaudRate ? baud - desiredBaudRate : desiredBaudRate - baud;
+        if(diff <= best_diff)
+        {
+            best_diff = diff;
+            best = baud;
+        }
+    }
+    if(!best || best_diff >= desiredBaudRate / 100 * 3)
+        return kStatus_LPUART_Fail;
+    base->BAUD = best;
+    mock_lpuart_baud = best;
+    return kStatus_LPUART_Success;
+}
+
+uint32_t CLOCK_SYS_GetLpuartFreq(uint32_t instance)
+{
+    (void)instance;
+    return MOCK_LPUART_CLOCK_HZ;
+}
@@ -0,0 +1,102 @@
+/*
+  lpuartUblox.h - host stand-in for the modem LPUART component
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_LPUARTUBLOX_H_
+#define TEST_MOCK_LPUARTUBLOX_H_
+
+#include "Cpu.h"
+
+#define FSL_LPUARTUBLOX             (0)
+
+typedef enum
+{
+    kStatus_LPUART_Success                  = 0x00U,
+    kStatus_LPUART_Fail                     = 0x01U,
+    kStatus_LPUART_TxBusy                   = 0x07U,
+    kStatus_LPUART_NoDataToDeal             = 0x0DU,
+    kStatus_LPUART_Timeout                  = 0x0BU,
+}lpuart_status_t;
+
+typedef void (*lpuart_rx_callback_t)(uint32_t instance, void *lpuartState);
+typedef void (*lpuart_tx_callback_t)(uint32_t instance, void *lpuartState);
+
+typedef struct
+{
+    const uint8_t *txBuff;
+    uint8_t *rxBuff;
+    volatile size_t txSize;
+    volatile size_t rxSize;
+    volatile bool isTxBusy;
+    volatile bool isRxBusy;
+    volatile bool isTxBlocking;
+    volatile bool isRxBlocking;
+    lpuart_rx_callback_t rxCallback;
+    void *rxCallbackParam;
+    lpuart_tx_callback_t txCallback;
+    void *txCallbackParam;
+}lpuart_state_t;
+
+typedef struct { uint32_t baudRate; }lpuart_user_config_t;
+
+extern lpuart_state_t lpuartUblox_State;
+extern unsigned char ublox_rx[];
+extern lpuart_user_config_t lpuartUblox_InitConfig0;
+
+void LPUART_DRV_Init(uint32_t instance, lpuart_state_t *lpuartStatePtr, const lpuart_user_config_t *lpuartUserConfig);
+void LPUART_DRV_Deinit(uint32_t instance);
+lpuart_rx_callback_t LPUART_DRV_InstallRxCallback(uint32_t instance, lpuart_rx_callback_t function,
+                                                   uint8_t *rxBuff, void *callbackParam, bool alwaysEnableRxIrq);
+lpuart_tx_callback_t LPUART_DRV_InstallTxCallback(uint32_t instance, lpuart_tx_callback_t function,
+                                                   uint8_t *txBuff, void *callbackParam);
+lpuart_status_t LPUART_DRV_SendData(uint32_t instance, const uint8_t *txBuff, uint32_t txSize);
+lpuart_status_t LPUART_DRV_SendDataBlocking(uint32_t instance, const uint8_t *txBuff, uint32_t txSize, uint32_t timeout);
+lpuart_status_t LPUART_DRV_GetTransmitStatus(uint32_t instance, uint32_t *bytesRemaining);
+
+//the fsl_lpuart_hal.h and clock manager calls factory.c changes the rate with
+typedef struct { uint32_t BAUD; }LPUART_Type;
+
+typedef enum
+{
+    kLpuartTxComplete               = 0x40000016U,
+}lpuart_status_flag_t;
+
+extern LPUART_Type mock_lpuart0;
+#define LPUART0                     (&mock_lpuart0)
+#define MOCK_LPUART_CLOCK_HZ        (4000000U)      //MCGIRCLK, fast IRC
+
+bool LPUART_HAL_GetStatusFlag(LPUART_Type *base, lpuart_status_flag_t statusFlag);
+void LPUART_HAL_SetTransmitterCmd(LPUART_Type *base, bool enable);
+void LPUART_HAL_SetReceiverCmd(LPUART_Type *base, bool enable);
+lpuart_status_t LPUART_HAL_SetBaudRate(LPUART_Type *base, uint32_t sourceClockInHz, uint32_t desiredBaudRate);
+uint32_t CLOCK_SYS_GetLpuartFreq(uint32_t instance);
+
+//mock/lpuart.c: the driver above over a line with a model at the far end,
+//one byte every mock_lpuart_byte_ns() each way
+extern uint32_t mock_lpuart_baud;               //as set, divider rounding included
+extern uint32_t mock_lpuart_overruns;
+extern void (*mock_lpuart_peer)(uint8_t data);  //a byte sent reached the far end
+
+void mock_lpuart_reset(void);
+void mock_lpuart_rx(uint8_t data);              //the far end's byte arrived
+uint64_t mock_lpuart_byte_ns(void);
+
+#endif /* TEST_MOCK_LPUARTUBLOX_H_ */
@@ -0,0 +1,321 @@
+/*
+  modem.c - host emulator of the u-blox modem
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "modem.h"
+#include "board.h"
+#include "lpuartUblox.h"
+
+#define MODEM_LINE_MAX      (600)
+#define MODEM_OUT_SIZE      (4096)
+#define MODEM_NONE          (UINT64_MAX)
+#define XON                 (0x11)
+#define XOFF                (0x13)
+
+mock_modem_stats_t mock_modem_stats;
+
+static const mock_modem_config_t *config;
+static bool wedged;
+static uint32_t rng;
+static bool up;
+static bool reset_held;
+static uint64_t up_at;
+static bool echo;
+static bool ifc;
+static bool xoff;
+static char line[MODEM_LINE_MAX];
+static uint32_t line_len;
+static char cmd[MODEM_LINE_MAX];
+static bool cmd_pending;
+static uint64_t cmd_at;
+static uint8_t out[MODEM_OUT_SIZE];
+static uint64_t out_head;               //counts of bytes queued and sent
+static uint64_t out_tail;
+static uint64_t out_at;                 //the byte on the line arrives
+static uint64_t pause_pos;              //out_head that waits pause_ns first
+static uint64_t pause_ns;
+static uint64_t data_pos;               //the first payload byte
+
+static uint32_t MODEM_random(void)
+{
+    //xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static bool MODEM_chance(uint32_t ppm)
+{
+    return ppm && MODEM_random() % 1000000 < ppm;
+}
+
+static void MODEM_queue(const void *data, uint32_t size)
+{
+    const uint8_t *p = data;
+
+    if(out_head == out_tail)
+        out_at = board_ns + mock_lpuart_byte_ns();
+    while(size-- && out_tail - out_head < MODEM_OUT_SIZE)
+        out[out_tail++ % MODEM_OUT_SIZE] = *p++;
+}
+
+static void MODEM_queue_string(const char *s)
+{
+    MODEM_queue(s, strlen(s));
+}
+
+static void MODEM_result(bool ok)
+{
+    if(!ok)
+    {
+        mock_modem_stats.errors++;
+        MODEM_queue_string("\r\nERROR\r\n");
+        return;
+    }
+    if(MODEM_chance(config->stall_ppm))
+    {
+        mock_modem_stats.stalls++;
+        pause_pos = out_tail;
+        pause_ns = config->stall_ms * BOARD_MS;
+    }
+    MODEM_queue_string("\r\nOK\r\n");
+}
+
+static const mock_modem_file_t *MODEM_file(const char *name)
+{
+    for(const mock_modem_file_t *file = config->files; file && file->name; file++)
+        if(strcmp(file->name, name) == 0)
+            return file;
+    return NULL;
+}
+
+static bool MODEM_urdblock(const char *args)
+{
+    //"<filename>",<offset>,<size>
+    char name[256];
+    char *end;
+    const char *quote;
+
+    if(*args++ != '"' || !(quote = strchr(args, '"')) || quote - args >= (int)sizeof(name))
+        return false;
+    memcpy(name, args, quote - args);
+    name[quote - args] = 0;
+    if(quote[1] != ',')
+        return false;
+    unsigned long offset = strtoul(&quote[2], &end, 10);
+    if(*end++ != ',')
+        return false;
+    unsigned long size = strtoul(end, &end, 10);
+    if(*end)
+        return false;
+
+    const mock_modem_file_t *file = MODEM_file(name);
+    if(!file || offset > file->size)
+        return false;
+    if(size > file->size - offset)
+        size = file->size - offset;
+
+    char head[300];
+    snprintf(head, sizeof(head), "\r\n+URDBLOCK: \"%s\",%lu,\"", name, size);
+    MODEM_queue_string(head);
+    if(mock_modem_stats.first_data_ns == 0 && data_pos == MODEM_NONE && size)
+        data_pos = out_tail;
+    MODEM_queue(&file->data[offset], size);
+    MODEM_queue_string("\"\r\n");
+    mock_modem_stats.urdblocks++;
+    return true;
+}
+
+static void MODEM_execute(void)
+{
+    mock_modem_stats.commands++;
+    if(strcmp(cmd, "AT") == 0)
+        MODEM_result(true);
+    else if(strcmp(cmd, "ATE0") == 0 || strcmp(cmd, "ATE1") == 0)
+    {
+        echo = cmd[3] == '1';
+        MODEM_result(true);
+    }
+    else if(strcmp(cmd, "AT+IFC=1,1") == 0 || strcmp(cmd, "AT+IFC=0,0") == 0)
+    {
+        ifc = cmd[7] == '1';
+        MODEM_result(true);
+    }
+    else if(strncmp(cmd, "AT+URDBLOCK=", 12) == 0)
+        MODEM_result(MODEM_urdblock(&cmd[12]));
+    else
+        MODEM_result(false);
+}
+
+static void MODEM_rx(uint8_t data)
+{
+    if(!up)
+        return;
+    if(ifc && (data == XON || data == XOFF))
+    {
+        if(data == XOFF && !xoff)
+            mock_modem_stats.xoffs++;
+        xoff = data == XOFF;
+        if(!xoff && out_at < board_ns + mock_lpuart_byte_ns())
+            out_at = board_ns + mock_lpuart_byte_ns();
+        return;
+    }
+    if(echo)
+        MODEM_queue(&data, 1);
+    if(data != '\r')
+    {
+        if(line_len < MODEM_LINE_MAX - 1)
+            line[line_len++] = data;
+        return;
+    }
+
+    //anything ahead of the AT is line noise; one command at a time
+    line[line_len] = 0;
+    line_len = 0;
+    char *at = strstr(line, "AT");
+    if(!at || cmd_pending)
+        return;
+    strcpy(cmd, at);
+    cmd_pending = true;
+    cmd_at = board_ns + config->latency_us * BOARD_US;
+}
+
+static void MODEM_send(void)
+{
+    uint64_t byte_ns = mock_lpuart_byte_ns();
+    uint8_t data;
+
+    if(out_head == pause_pos)
+    {
+        pause_pos = MODEM_NONE;
+        out_at = board_ns + pause_ns + byte_ns;
+        return;
+    }
+    out_at = board_ns + byte_ns;
+    if(MODEM_chance(config->insert_ppm))
+    {
+        mock_modem_stats.faults++;
+        mock_lpuart_rx((uint8_t)MODEM_random());
+        return;
+    }
+
+    data = out[out_head % MODEM_OUT_SIZE];
+    if(out_head++ == data_pos)
+    {
+        data_pos = MODEM_NONE;
+        mock_modem_stats.first_data_ns = board_ns;
+    }
+    if(MODEM_chance(config->drop_ppm))
+    {
+        mock_modem_stats.faults++;
+        return;
+    }
+    if(MODEM_chance(config->garble_ppm))
+    {
+        mock_modem_stats.faults++;
+        data ^= 1 + MODEM_random() % 255;
+    }
+    mock_lpuart_rx(data);
+}
+
+static void MODEM_off(void)
+{
+    up = false;
+    echo = true;
+    ifc = false;
+    xoff = false;
+    line_len = 0;
+    cmd_pending = false;
+    out_head = out_tail = 0;
+    pause_pos = MODEM_NONE;
+    data_pos = MODEM_NONE;
+}
+
+static uint64_t MODEM_next(void)
+{
+    uint64_t next = BOARD_NEVER;
+
+    if(!up && !reset_held && !wedged)
+        next = up_at;
+    if(cmd_pending && cmd_at < next)
+        next = cmd_at;
+    if(out_head != out_tail && !xoff && out_at < next)
+        next = out_at;
+    return next;
+}
+
+static void MODEM_run(void)
+{
+    if(!up && !reset_held && !wedged && board_ns >= up_at)
+    {
+        up = true;
+        mock_modem_stats.ready_ns = board_ns;
+        if(config->banner)
+            MODEM_queue_string(config->banner);
+    }
+    if(cmd_pending && board_ns >= cmd_at)
+    {
+        cmd_pending = false;
+        MODEM_execute();
+    }
+    if(out_head != out_tail && !xoff && board_ns >= out_at)
+        MODEM_send();
+}
+
+static void MODEM_pin(uint32_t pin, bool high)
+{
+    if(pin != MOCK_UBLOX_RESET_N)
+        return;
+    if(!high)
+    {
+        reset_held = true;
+        MODEM_off();
+    }
+    else if(reset_held)
+    {
+        reset_held = false;
+        wedged = false;
+        up_at = board_ns + config->boot_ms * BOARD_MS;
+        mock_modem_stats.resets++;
+    }
+}
+
+static board_model_t modem_model = {
+    .next = MODEM_next,
+    .run = MODEM_run,
+    .pin = MODEM_pin,
+};
+
+void mock_modem_init(const mock_modem_config_t *modem)
+{
+    config = modem;
+    wedged = modem->wedged;
+    rng = modem->seed ? modem->seed : 1;
+    memset(&mock_modem_stats, 0, sizeof(mock_modem_stats));
+    reset_held = false;
+    MODEM_off();
+    up_at = board_ns + modem->boot_ms * BOARD_MS;
+    mock_lpuart_peer = MODEM_rx;
+    board_add(&modem_model);
+}
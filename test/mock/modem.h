@@ -0,0 +1,78 @@
+/*
+  modem.h - host emulator of the u-blox modem
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_MODEM_H_
+#define TEST_MOCK_MODEM_H_
+
+//The far end of the LPUART (mock/lpuart.c) for the loaders: the commands
+//boot.c sends (AT, ATE0, AT+IFC, AT+URDBLOCK) over a file table, answered
+//with V.250 framing after latency_us.  It comes up boot_ms after power on
+//or after UBLOX_RESET_N is released, echoes until ATE0 and honours
+//XON/XOFF once AT+IFC=1,1 turns it on.  Faults hit the bytes it sends,
+//each drawn from a generator seeded by the config so runs repeat.
+
+#include "Cpu.h"
+#include "gpio1.h"
+
+#define MOCK_UBLOX_RESET_N          GPIO_MAKE_PIN(GPIOA_IDX, 1U)
+
+typedef struct
+{
+    const char *name;
+    const uint8_t *data;
+    uint32_t size;
+}mock_modem_file_t;
+
+typedef struct
+{
+    uint32_t boot_ms;           //power on or reset release to answering
+    bool wedged;                //doesn't come up until reset
+    const char *banner;         //sent on coming up, NULL for none
+    uint32_t latency_us;        //command line end to response
+    uint32_t drop_ppm;          //bytes sent lost on the line
+    uint32_t garble_ppm;        //bytes sent corrupted
+    uint32_t insert_ppm;        //noise bytes ahead of a byte sent
+    uint32_t stall_ppm;         //responses whose result code is held back
+    uint32_t stall_ms;
+    uint32_t seed;
+    const mock_modem_file_t *files;     //ends with a NULL name
+}mock_modem_config_t;
+
+typedef struct
+{
+    uint32_t commands;
+    uint32_t urdblocks;
+    uint32_t errors;            //ERROR results
+    uint32_t faults;            //bytes dropped, garbled or inserted
+    uint32_t stalls;
+    uint32_t resets;            //UBLOX_RESET_N pulses
+    uint32_t xoffs;
+    uint64_t ready_ns;          //when it last came up
+    uint64_t first_data_ns;     //first URDBLOCK payload byte delivered, 0 none
+}mock_modem_stats_t;
+
+extern mock_modem_stats_t mock_modem_stats;
+
+//powers on now; config is read as it runs, so a test can change the faults
+void mock_modem_init(const mock_modem_config_t *config);
+
+#endif /* TEST_MOCK_MODEM_H_ */
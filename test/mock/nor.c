@@ -0,0 +1,195 @@
+/*
+  nor.c - host model of the external staging flash
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "nor.h"
+#include "board.h"
+#include "gpio1.h"
+#include "spiComEZPort.h"
+#include "ext_flash.h"
+
+#define NOR_PAGE_SIZE       (256)
+#define NOR_SECTOR_SIZE     (4096)
+
+#define NOR_WIP             (0x01)
+#define NOR_WEL             (0x02)
+
+uint8_t mock_nor[MOCK_NOR_SIZE];
+uint32_t mock_nor_erases;
+uint32_t mock_nor_programs;
+uint32_t mock_nor_violations;
+
+static bool selected;
+static bool locked;
+static bool wel;
+static bool reset_enabled;
+static uint64_t busy_until;
+static uint8_t opcode;
+static uint32_t count;              //bytes clocked in this select
+static uint32_t address;
+static uint8_t page[NOR_PAGE_SIZE];
+static uint32_t page_len;
+
+static bool NOR_busy(void)
+{
+    return board_ns < busy_until;
+}
+
+static uint8_t NOR_exchange(uint8_t out)
+{
+    uint32_t n = count++;
+
+    if(!selected)
+        return 0xFF;
+
+    if(n == 0)
+    {
+        //only the status can be read while a program or erase runs
+        opcode = out;
+        if(NOR_busy() && opcode != 0x05)
+        {
+            mock_nor_violations++;
+            opcode = 0;
+        }
+        if(opcode == 0x99 && !reset_enabled)
+            opcode = 0;
+        reset_enabled = false;
+        return 0xFF;
+    }
+
+    switch(opcode)
+    {
+    case 0x05:
+        return (NOR_busy() ? NOR_WIP : 0) | (wel ? NOR_WEL : 0);
+    case 0x03:
+    case 0x02:
+    case 0x20:
+        if(n <= 3)
+        {
+            address = (address << 8 | out) & (MOCK_NOR_SIZE - 1);
+            return 0xFF;
+        }
+        if(opcode == 0x03)
+            return mock_nor[address++ & (MOCK_NOR_SIZE - 1)];
+        if(opcode == 0x02)
+        {
+            //past the end of the page the part wraps to its start
+            if(page_len == NOR_PAGE_SIZE)
+                mock_nor_violations++;
+            else
+                page[page_len++] = out;
+        }
+        return 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+//programs, erases and the unlock start as the select goes high
+static void NOR_deselect(void)
+{
+    if(count != 1 && (opcode == 0x06 || opcode == 0x04 || opcode == 0x98 || opcode == 0x66 || opcode == 0x99))
+        mock_nor_violations++;
+    else if(opcode == 0x06)
+        wel = true;
+    else if(opcode == 0x04)
+        wel = false;
+    else if(opcode == 0x66)
+        reset_enabled = true;
+    else if(opcode == 0x99)
+        wel = false;
+
+    if(opcode != 0x02 && opcode != 0x20 && opcode != 0x98)
+        return;
+    if(!wel || (opcode != 0x98 && (locked || count < 4)))
+    {
+        mock_nor_violations++;
+        return;
+    }
+    wel = false;
+
+    if(opcode == 0x98)
+        locked = false;
+    else if(opcode == 0x20)
+    {
+        memset(&mock_nor[address & ~(NOR_SECTOR_SIZE - 1)], 0xFF, NOR_SECTOR_SIZE);
+        busy_until = board_ns + MOCK_NOR_ERASE_US * BOARD_US;
+        mock_nor_erases++;
+    }
+    else
+    {
+        for(uint32_t i = 0; i < page_len; i++)
+        {
+            uint8_t *cell = &mock_nor[(address & ~(NOR_PAGE_SIZE - 1)) | ((address + i) & (NOR_PAGE_SIZE - 1))];
+            if((*cell & page[i]) != page[i])
+                mock_nor_violations++;
+            *cell &= page[i];
+        }
+        busy_until = board_ns + MOCK_NOR_PROGRAM_US * BOARD_US;
+        mock_nor_programs++;
+    }
+}
+
+static uint64_t NOR_next(void)
+{
+    return BOARD_NEVER;
+}
+
+static void NOR_run(void)
+{
+}
+
+static void NOR_pin(uint32_t pin, bool high)
+{
+    if(pin != M2_SS || selected == !high)
+        return;
+    selected = !high;
+    if(selected)
+    {
+        count = 0;
+        opcode = 0;
+        address = 0;
+        page_len = 0;
+    }
+    else
+        NOR_deselect();
+}
+
+static board_model_t nor_model = {
+    .next = NOR_next,
+    .run = NOR_run,
+    .pin = NOR_pin,
+};
+
+void mock_nor_init(void)
+{
+    memset(mock_nor, 0xFF, sizeof(mock_nor));
+    mock_nor_erases = 0;
+    mock_nor_programs = 0;
+    mock_nor_violations = 0;
+    selected = false;
+    locked = true;
+    wel = false;
+    reset_enabled = false;
+    busy_until = 0;
+    board_add(&nor_model);
+    mock_spi_attach(EXT_STAGING, NOR_exchange);
+}
@@ -0,0 +1,46 @@
+/*
+  nor.h - host model of the external staging flash
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_NOR_H_
+#define TEST_MOCK_NOR_H_
+
+//The SPI NOR on M2_SS that ext_flash.c drives as EXT_STAGING, an
+//SST26-class part: global block protection set at power on until 0x98,
+//WREN before each program or erase, and a busy time after it that RDSR
+//reports.  The times are the datasheet maxima.  A command the part
+//would ignore, or a program over bits not erased, counts a violation.
+
+#include "Cpu.h"
+
+#define MOCK_NOR_SIZE               (2 * 1024 * 1024)
+#define MOCK_NOR_ERASE_US           (25000)     //tSE, 4KB sector
+#define MOCK_NOR_PROGRAM_US         (1500)      //tPP, up to a 256 byte page
+
+extern uint8_t mock_nor[MOCK_NOR_SIZE];
+extern uint32_t mock_nor_erases;
+extern uint32_t mock_nor_programs;
+extern uint32_t mock_nor_violations;
+
+//powers on now: erased, write protected, on the EXT_STAGING bus
+void mock_nor_init(void);
+
+#endif /* TEST_MOCK_NOR_H_ */
@@ -0,0 +1,42 @@
+/*
+  osa1.h - host stand-in for the OS abstraction component
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_OSA1_H_
+#define TEST_MOCK_OSA1_H_
+
+#include "Cpu.h"
+
+typedef enum
+{
+    kSimClockGatePortA,
+    kSimClockGatePortB,
+    kSimClockGatePortC,
+    kSimClockGatePortD,
+    kSimClockGatePortE,
+}sim_clock_gate_name_t;
+
+extern uint32_t g_xtal0ClkFreq;
+
+void SIM_HAL_EnableClock(void *base, sim_clock_gate_name_t name);
+void OSA_Init(void);
+
+#endif /* TEST_MOCK_OSA1_H_ */
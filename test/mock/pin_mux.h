@@ -0,0 +1,52 @@
+/*
+  pin_mux.h - host stand-in for the pin mux component
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_PIN_MUX_H_
+#define TEST_MOCK_PIN_MUX_H_
+
+#include "Cpu.h"
+
+enum
+{
+    CoreDebug_IDX,
+    GPIOA_IDX,
+    GPIOC_IDX,
+    GPIOD_IDX,
+    GPIOE_IDX,
+    LLWU_IDX,
+    OSC0_IDX,
+    RCM_IDX,
+    I2C0_IDX,
+    SPI0_IDX,
+    LPUART0_IDX,
+};
+
+void init_coredebug_pins(uint32_t instance);
+void init_gpio_pins(uint32_t instance);
+void init_llwu_pins(uint32_t instance);
+void init_osc_pins(uint32_t instance);
+void init_rcm_pins(uint32_t instance);
+void init_i2c_pins(uint32_t instance);
+void init_spi_pins(uint32_t instance);
+void init_lpuart_pins(uint32_t instance);
+
+#endif /* TEST_MOCK_PIN_MUX_H_ */
@@ -0,0 +1,97 @@
+/*
+  spi.c - host stand-in for the KSDK SPI master driver
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "spiComEZPort.h"
+#include "board.h"
+
+uint64_t mock_spi_bytes[MOCK_SPI_INSTANCES];
+
+static uint32_t spi_baud[MOCK_SPI_INSTANCES];
+static mock_spi_device_t spi_device[MOCK_SPI_INSTANCES];
+
+void mock_spi_reset(void)
+{
+    memset(mock_spi_bytes, 0, sizeof(mock_spi_bytes));
+    memset(spi_baud, 0, sizeof(spi_baud));
+    memset(spi_device, 0, sizeof(spi_device));
+}
+
+void mock_spi_attach(uint32_t instance, mock_spi_device_t device)
+{
+    spi_device[instance] = device;
+}
+
+spi_status_t SPI_DRV_MasterInit(uint32_t instance, spi_master_state_t *state)
+{
+    state->baud = 0;
+    spi_baud[instance] = 0;
+    return kStatus_SPI_Success;
+}
+
+void SPI_DRV_MasterConfigureBus(uint32_t instance, const spi_master_user_config_t *device, uint32_t *calculatedBaudRate)
+{
+    uint32_t best = 0;
+
+    //the SPI's prescaler (1 to 8) and divider (2 to 512), the fastest
+    //rate that isn't over the one asked for
+    for(uint32_t prescaler = 1; prescaler <= 8; prescaler++)
+        for(uint32_t divider = 2; divider <= 512; divider <<= 1)
+        {
+            uint32_t baud = MOCK_SPI_CLOCK_HZ / (prescaler * divider);
+            if(baud <= device->bitsPerSec && baud > best)
+                best = baud;
+        }
+    spi_baud[instance] = best;
+    *calculatedBaudRate = best;
+}
+
+spi_status_t SPI_DRV_MasterTransferBlocking(uint32_t instance, const spi_master_user_config_t *device,
+        const uint8_t *sendBuffer, uint8_t *receiveBuffer, size_t transferByteCount, uint32_t timeout)
+{
+    uint64_t byte_ns;
+
+    assert(device == NULL && spi_baud[instance]);
+
+    //the bytes are moved by the SPI interrupt; with it held off the
+    //driver waits out the timeout on its semaphore
+    if(!board_irqs())
+    {
+        board_advance(timeout * BOARD_MS);
+        return kStatus_SPI_Timeout;
+    }
+
+    board_advance(MOCK_SPI_TRANSFER_NS);
+    byte_ns = 8ULL * 1000000000ULL / spi_baud[instance];
+    if(byte_ns < MOCK_SPI_BYTE_NS)
+        byte_ns = MOCK_SPI_BYTE_NS;
+    for(size_t i = 0; i < transferByteCount; i++)
+    {
+        uint8_t out = sendBuffer ? sendBuffer[i] : 0;
+        uint8_t in = spi_device[instance] ? spi_device[instance](out) : 0xFF;
+
+        board_advance(byte_ns);
+        if(receiveBuffer)
+            receiveBuffer[i] = in;
+    }
+    mock_spi_bytes[instance] += transferByteCount;
+    return kStatus_SPI_Success;
+}
@@ -0,0 +1,79 @@
+/*
+  spiComEZPort.h - host stand-in for the EZPort SPI component
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TEST_MOCK_SPICOMEZPORT_H_
+#define TEST_MOCK_SPICOMEZPORT_H_
+
+#include "Cpu.h"
+
+#define FSL_SPICOMEZPORT            (0)
+
+typedef enum
+{
+    kStatus_SPI_Success = 0,
+    kStatus_SPI_Timeout = 3,
+}spi_status_t;
+
+typedef enum { kSpiClockPolarity_ActiveHigh, kSpiClockPolarity_ActiveLow }spi_clock_polarity_t;
+typedef enum { kSpiClockPhase_FirstEdge, kSpiClockPhase_SecondEdge }spi_clock_phase_t;
+typedef enum { kSpiMsbFirst, kSpiLsbFirst }spi_shift_direction_t;
+typedef enum { kSpi8BitMode, kSpi16BitMode }spi_data_bitcount_mode_t;
+
+typedef struct { uint32_t baud; }spi_master_state_t;
+
+typedef struct
+{
+    uint32_t bitsPerSec;
+    spi_clock_polarity_t polarity;
+    spi_clock_phase_t phase;
+    spi_shift_direction_t direction;
+    spi_data_bitcount_mode_t bitCount;
+}spi_master_user_config_t;
+
+extern spi_master_state_t spiComEZPort_MasterState;
+extern uint32_t spiComEZPort_calculatedBaudRate;
+extern const spi_master_user_config_t spiComEZPort_MasterConfig0;
+
+spi_status_t SPI_DRV_MasterInit(uint32_t instance, spi_master_state_t *state);
+void SPI_DRV_MasterConfigureBus(uint32_t instance, const spi_master_user_config_t *device, uint32_t *calculatedBaudRate);
+spi_status_t SPI_DRV_MasterTransferBlocking(uint32_t instance, const spi_master_user_config_t *device,
+        const uint8_t *sendBuffer, uint8_t *receiveBuffer, size_t transferByteCount, uint32_t timeout);
+
+//mock/spi.c: the two SPI masters on the board clock.  Each byte takes the
+//longer of its bits at the configured rate and the driver's interrupt to
+//move it; each blocking transfer also pays the driver's setup and wait.
+//A device on the bus answers every byte clocked while its chip select
+//is low, and sees the select through board_pin; 0xFF floats back with
+//no device.  Both costs are estimates for the 48MHz core, not measured.
+#define MOCK_SPI_INSTANCES          (2)
+#define MOCK_SPI_CLOCK_HZ           (24000000U)     //bus clock; fastest SCK is half
+#define MOCK_SPI_BYTE_NS            (1500)          //interrupt per byte
+#define MOCK_SPI_TRANSFER_NS        (10000)         //setup, semaphore, return
+
+typedef uint8_t (*mock_spi_device_t)(uint8_t out);
+
+extern uint64_t mock_spi_bytes[MOCK_SPI_INSTANCES];
+
+void mock_spi_reset(void);
+void mock_spi_attach(uint32_t instance, mock_spi_device_t device);
+
+#endif /* TEST_MOCK_SPICOMEZPORT_H_ */
@@ -0,0 +1,78 @@
+/*
+  systick.c - simulated SysTick for the host tests
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Cpu.h"
+
+#define MOCK_CORE_HZ    (48000000)
+
+void SysTick_Handler(void);
+
+SysTick_Type mock_systick_regs;
+SCB_Type mock_scb_regs;
+uint32_t mock_systick_step;         //core cycles per register access
+uint64_t mock_systick_cycles;       //core cycles since the last reset of the count
+
+uint32_t CLOCK_SYS_GetSystickFreq(void)
+{
+    return MOCK_CORE_HZ;
+}
+
+//Counts down to 0, raising COUNTFLAG and PENDSTSET on the 1 -> 0 step, and
+//reloads on the next cycle.  COUNTFLAG is left for the test to clear since
+//which register an access reads isn't visible here.
+void mock_systick_run(uint32_t cycles)
+{
+    SysTick_Type *systick = &mock_systick_regs;
+
+    while(cycles-- && (systick->CTRL & SysTick_CTRL_ENABLE_Msk))
+    {
+        mock_systick_cycles++;
+        if(systick->VAL == 0)
+        {
+            systick->VAL = systick->LOAD & SysTick_LOAD_RELOAD_Msk;
+        }
+        else if(--systick->VAL == 0)
+        {
+            systick->CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+            if(systick->CTRL & SysTick_CTRL_TICKINT_Msk)
+                mock_scb_regs.ICSR |= SCB_ICSR_PENDSTSET_Msk;
+        }
+    }
+
+    if(!mock_primask && (mock_scb_regs.ICSR & SCB_ICSR_PENDSTSET_Msk))
+    {
+        mock_scb_regs.ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+        SysTick_Handler();
+    }
+}
+
+SysTick_Type *mock_systick(void)
+{
+    mock_systick_run(mock_systick_step);
+    return &mock_systick_regs;
+}
+
+SCB_Type *mock_scb(void)
+{
+    mock_systick_run(mock_systick_step);
+    return &mock_scb_regs;
+}
@@ -0,0 +1,196 @@
+/*
+  perf_decode.c - decodes a saved or I2C-read perf_t record
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//Reads the perf_t returned by I2C command READ_PERF, or a flash dump with
+//the record saved at BOOT_PERF_ADDRESS (-a 0x5800 for a dump from 0), and
+//prints the counters and timers.
+//
+//The record is taken apart field by field as the target lays it out,
+//little endian, and the sizes in its header are trusted over this build's
+//enums: a record from newer firmware shows its extra entries by index,
+//one from older firmware only the entries it has.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "perf.h"
+
+#define PERF_HEADER_SIZE    (8)
+#define PERF_STAT_SIZE      (4 * sizeof(uint32_t))
+#define PERF_DECODE_MAX     (255)   //the header counts are a byte each
+
+typedef struct
+{
+    uint32_t version;
+    uint32_t counters;
+    uint32_t timers;
+    uint32_t counter[PERF_DECODE_MAX];
+    perf_stat_t timer[PERF_DECODE_MAX];
+}perf_record_t;
+
+//in perf.h order
+static const char *const counter_names[] = {
+    "ublox_bytes", "spi_bytes", "http_bytes", "read_retries",
+    "ring_overruns", "ring_stalls", "i2c_commands", "i2c_irqs",
+};
+
+static const char *const timer_names[] = {
+    "flash_erase", "flash_program", "ext_erase", "ext_program",
+    "phase_modem", "phase_system", "phase_user", "phase_update",
+};
+
+#define NAMES(names)    (sizeof(names) / sizeof(names[0]))
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//NULL on success, otherwise why the record was rejected
+static const char *perf_parse(const uint8_t *data, uint32_t size, perf_record_t *record)
+{
+    const uint8_t *p = data + PERF_HEADER_SIZE;
+    uint32_t magic;
+
+    if(size < PERF_HEADER_SIZE)
+        return "short record";
+    magic = get32(data);
+    if(magic == 0xFFFFFFFF)
+        return "erased, no record saved";
+    if(magic != PERF_MAGIC)
+        return "bad magic";
+    record->version = data[4];
+    record->counters = data[5];
+    record->timers = data[6];
+    if(record->version != PERF_VERSION)
+        return "unknown version";
+    if(size < PERF_HEADER_SIZE + record->counters * 4 + record->timers * PERF_STAT_SIZE)
+        return "short record";
+
+    for(uint32_t i = 0; i < record->counters; i++, p += 4)
+        record->counter[i] = get32(p);
+    for(uint32_t i = 0; i < record->timers; i++, p += PERF_STAT_SIZE)
+    {
+        record->timer[i].count = get32(p);
+        record->timer[i].sum_us = get32(p + 4);
+        record->timer[i].min_us = get32(p + 8);
+        record->timer[i].max_us = get32(p + 12);
+    }
+    return NULL;
+}
+
+static void perf_print(const perf_record_t *record, FILE *out)
+{
+    fprintf(out, "perf record version %u, %u counters, %u timers\n",
+            record->version, record->counters, record->timers);
+    for(uint32_t i = 0; i < record->counters; i++)
+    {
+        if(i < NAMES(counter_names))
+            fprintf(out, "%-16s %10u\n", counter_names[i], record->counter[i]);
+        else
+            fprintf(out, "counter %-8u %10u\n", i, record->counter[i]);
+    }
+
+    fprintf(out, "%-16s %10s %12s %10s %10s %10s\n", "timer", "count", "total us", "min us", "avg us", "max us");
+    for(uint32_t i = 0; i < record->timers; i++)
+    {
+        const perf_stat_t *stat = &record->timer[i];
+        char name[17];
+
+        if(i < NAMES(timer_names))
+            snprintf(name, sizeof(name), "%s", timer_names[i]);
+        else
+            snprintf(name, sizeof(name), "timer %u", i);
+        if(stat->count == 0)
+            fprintf(out, "%-16s %10u\n", name, 0);
+        else
+            fprintf(out, "%-16s %10u %12u %10u %10u %10u\n", name, stat->count, stat->sum_us,
+                    stat->min_us, stat->sum_us / stat->count, stat->max_us);
+    }
+}
+
+//the record at address in a dump starting at 0, or the whole file
+static const char *perf_load(const char *path, long address, perf_record_t *record)
+{
+    static uint8_t data[FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE];
+    FILE *file = fopen(path, "rb");
+    uint32_t size;
+
+    if(!file)
+        return "can't open";
+    if(fseek(file, address, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return "can't seek";
+    }
+    size = (uint32_t)fread(data, 1, sizeof(data), file);
+    fclose(file);
+    return perf_parse(data, size, record);
+}
+
+#ifndef PERF_DECODE_NO_MAIN
+
+static void usage(const char *self)
+{
+    fprintf(stderr,
+        "usage: %s [-a address] record\n"
+        "  record      raw READ_PERF reply, or a flash dump with -a\n"
+        "  -a address  offset of the record in the dump (0x5800 from 0)\n",
+        self);
+}
+
+int main(int argc, char **argv)
+{
+    static perf_record_t record;
+    long address = 0;
+    const char *error;
+    int opt;
+
+    while((opt = getopt(argc, argv, "a:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'a': address = strtol(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if(optind != argc - 1)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    error = perf_load(argv[optind], address, &record);
+    if(error)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], error);
+        return 1;
+    }
+    perf_print(&record, stdout);
+    return 0;
+}
+
+#endif
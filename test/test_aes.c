@@ -0,0 +1,143 @@
+/*
+  test_aes.c - AES-128 and CTR known answers
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "aes.h"
+#include "check.h"
+
+static void check_block(const char *key, const char *plain, const char *cipher)
+{
+    aes_t ctx;
+    uint8_t k[AES_KEY_SIZE];
+    uint8_t in[AES_BLOCK_SIZE];
+    uint8_t want[AES_BLOCK_SIZE];
+    uint8_t out[AES_BLOCK_SIZE];
+
+    unhex(key, k);
+    unhex(plain, in);
+    unhex(cipher, want);
+    AES_init(&ctx, k);
+    AES_encrypt(&ctx, in, out);
+    CHECK_MEM(out, want, sizeof(want));
+}
+
+//FIPS 197 appendix C.1 and SP 800-38A F.1.1 (ECB-AES128)
+static void test_block(void)
+{
+    check_block("000102030405060708090a0b0c0d0e0f",
+                "00112233445566778899aabbccddeeff",
+                "69c4e0d86a7b0430d8cdb78070b4c55a");
+    check_block("2b7e151628aed2a6abf7158809cf4f3c",
+                "6bc1bee22e409f96e93d7e117393172a",
+                "3ad77bb40d7a3660a89ecaf32466ef97");
+    check_block("2b7e151628aed2a6abf7158809cf4f3c",
+                "ae2d8a571e03ac9c9eb76fac45af8e51",
+                "f5d3d58503b9699de785895a96fdbaaf");
+    check_block("2b7e151628aed2a6abf7158809cf4f3c",
+                "30c81c46a35ce411e5fbc1191a0a52ef",
+                "43b1cd7f598ece23881b00e3ed030688");
+}
+
+//SP 800-38A F.5.1 (CTR-AES128) first block: nonce f0..fb, counter fcfdfeff.
+//Its later blocks carry out of the low byte, which counter_hi | pos / 16
+//never does, so only the first block applies.
+static void test_ctr_vector(void)
+{
+    aes_t ctx;
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t nonce[AES_NONCE_SIZE];
+    uint8_t data[AES_BLOCK_SIZE];
+    uint8_t want[AES_BLOCK_SIZE];
+
+    unhex("2b7e151628aed2a6abf7158809cf4f3c", key);
+    unhex("f0f1f2f3f4f5f6f7f8f9fafb", nonce);
+    unhex("6bc1bee22e409f96e93d7e117393172a", data);
+    unhex("874d6191b620e3261bef6864990db6ce", want);
+    AES_init(&ctx, key);
+    AES_ctr(&ctx, nonce, 0xFCFDFEFF, 0, data, sizeof(data));
+    CHECK_MEM(data, want, sizeof(want));
+}
+
+//keystream built block by block from AES_encrypt: nonce || BE(hi | block)
+static void keystream(const aes_t *ctx, const uint8_t *nonce, uint32_t counter_hi, uint8_t *out, uint32_t size)
+{
+    uint8_t block[AES_BLOCK_SIZE];
+
+    memcpy(block, nonce, AES_NONCE_SIZE);
+    for(uint32_t n = 0; n * AES_BLOCK_SIZE < size; n++)
+    {
+        uint32_t counter = counter_hi | n;
+
+        block[12] = counter >> 24;
+        block[13] = counter >> 16;
+        block[14] = counter >> 8;
+        block[15] = counter;
+        AES_encrypt(ctx, block, &out[n * AES_BLOCK_SIZE]);
+    }
+}
+
+//chunks land at any image offset, so a chunk starting mid-block must pick
+//up the keystream where the previous one stopped
+static void test_ctr_offsets(void)
+{
+    aes_t ctx;
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t nonce[AES_NONCE_SIZE];
+    uint8_t stream[256];
+    uint8_t data[256];
+    uint32_t chunks[] = {1, 7, 16, 32, 33, 100};
+    uint32_t image_hi = 2U << 28;
+
+    unhex("000102030405060708090a0b0c0d0e0f", key);
+    unhex("a0a1a2a3a4a5a6a7a8a9aaab", nonce);
+    AES_init(&ctx, key);
+    keystream(&ctx, nonce, image_hi, stream, sizeof(stream));
+
+    for(uint32_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+    {
+        memset(data, 0, sizeof(data));
+        for(uint32_t pos = 0; pos < sizeof(data); pos += chunks[c])
+        {
+            uint32_t len = chunks[c];
+            if(len > sizeof(data) - pos)
+                len = sizeof(data) - pos;
+            AES_ctr(&ctx, nonce, image_hi, pos, &data[pos], len);
+        }
+        CHECK_MEM(data, stream, sizeof(stream));
+    }
+
+    //a second pass decrypts, and another image gets another keystream
+    AES_ctr(&ctx, nonce, image_hi, 0, data, sizeof(data));
+    for(uint32_t i = 0; i < sizeof(data); i++)
+        CHECK_EQ(data[i], 0);
+    AES_ctr(&ctx, nonce, 3U << 28, 0, data, AES_BLOCK_SIZE);
+    CHECK(memcmp(data, stream, AES_BLOCK_SIZE) != 0);
+}
+
+int main(void)
+{
+    test_block();
+    test_ctr_vector();
+    test_ctr_offsets();
+    return CHECK_DONE("aes");
+}
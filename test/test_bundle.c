@@ -0,0 +1,263 @@
+/*
+  test_bundle.c - bundle against per-file updates from the modem emulator
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "check.h"
+#include "board.h"
+#include "modem.h"
+#include "flash1.h"
+#include "ezport.h"
+
+//the loaders and their statics; VERSION_* come from the build
+#include "../Sources/boot.c"
+
+#define BUNDLE_NO_MAIN
+#include "bundle.c"
+
+#define USERBOOT_SIZE   (8 * 1024)
+#define USER_SIZE       (24 * 1024)
+#define SYSTEM_SIZE     (32 * 1024)
+#define BUNDLE_SIZE     (96 * 1024)
+#define LATENCY_US      (5000)      //command to response, file system included
+
+//the Processor Expert configuration of the EZPort bus
+spi_master_state_t spiComEZPort_MasterState;
+uint32_t spiComEZPort_calculatedBaudRate;
+const spi_master_user_config_t spiComEZPort_MasterConfig0 = {
+    .bitsPerSec = 4000000U,
+};
+
+//what PERIPH_init brings up for the loaders, as periph.c and Events.c do
+static uint32_t periph_up;
+
+void lpuartUblox_RxCallback(uint32_t instance, void *lpuartState)
+{
+    lpuart_state_t *ptr = (lpuart_state_t *)lpuartState;
+    (void)instance;
+    RING_push(&ublox_ring, *(ptr->rxBuff));
+}
+
+void PERIPH_init(uint32_t units)
+{
+    if((units & PERIPH_UBLOX) && !(periph_up & PERIPH_UBLOX))
+    {
+        LPUART_DRV_Init(FSL_LPUARTUBLOX, &lpuartUblox_State, &lpuartUblox_InitConfig0);
+        LPUART_DRV_InstallRxCallback(FSL_LPUARTUBLOX, lpuartUblox_RxCallback, ublox_rx, NULL, true);
+    }
+    if((units & PERIPH_EZPORT) && !(periph_up & PERIPH_EZPORT))
+    {
+        SPI_DRV_MasterInit(FSL_SPICOMEZPORT, &spiComEZPort_MasterState);
+        SPI_DRV_MasterConfigureBus(FSL_SPICOMEZPORT, &spiComEZPort_MasterConfig0, &spiComEZPort_calculatedBaudRate);
+    }
+    periph_up |= units;
+}
+
+void PERIPH_deinit(uint32_t units)
+{
+    periph_up &= ~units;
+}
+
+void NVIC_SystemReset(void)
+{
+    CHECK(false);
+}
+
+static uint8_t userboot[USERBOOT_SIZE];
+static uint8_t user[USER_SIZE];
+static uint8_t system_image[SYSTEM_SIZE];
+static uint8_t digests[3][SHA256_DIGEST_SIZE];
+static uint8_t userboot_frm[USERBOOT_SIZE + USERBOOT_SIZE / 64];
+static uint8_t user_frm[USER_SIZE + USER_SIZE / 64];
+static uint8_t system_frm[SYSTEM_SIZE + SYSTEM_SIZE / 64];
+static uint8_t plain[BUNDLE_SIZE];
+static uint8_t framed[BUNDLE_SIZE];
+static uint8_t manifest_digest[2][SHA256_DIGEST_SIZE];
+
+static mock_modem_file_t files[] = {
+    { "userboot.bin", userboot, sizeof(userboot) },
+    { "user.bin", user, sizeof(user) },
+    { "system.bin", system_image, sizeof(system_image) },
+    { "userboot.frm", userboot_frm, 0 },
+    { "user.frm", user_frm, 0 },
+    { "system.frm", system_frm, 0 },
+    { "update.bnd", plain, 0 },
+    { "update.bfr", framed, 0 },
+    { NULL },
+};
+
+static const mock_modem_config_t modem = {
+    .boot_ms = 100,
+    .latency_us = LATENCY_US,
+    .seed = 1,
+    .files = files,
+};
+
+static void fill(uint8_t *image, uint32_t size, uint32_t seed)
+{
+    for(uint32_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+}
+
+static void make_images(void)
+{
+    //system first: it's the image the device can't run without
+    const bundle_image_t images[] = {
+        { BOOT_IMAGE_SYSTEM, system_image, sizeof(system_image) },
+        { BOOT_IMAGE_USERBOOT, userboot, sizeof(userboot) },
+        { BOOT_IMAGE_USER, user, sizeof(user) },
+    };
+
+    fill(userboot, sizeof(userboot), 1);
+    fill(user, sizeof(user), 2);
+    fill(system_image, sizeof(system_image), 3);
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        SHA256_init(&sha);
+        SHA256_update(&sha, images[i].data, images[i].size);
+        SHA256_final(&sha, digests[images[i].target]);
+    }
+    files[3].size = bundle_store(userboot_frm, userboot, sizeof(userboot), true);
+    files[4].size = bundle_store(user_frm, user, sizeof(user), true);
+    files[5].size = bundle_store(system_frm, system_image, sizeof(system_image), true);
+    CHECK(bundle_pack(images, 3, false, plain, sizeof(plain), &files[6].size, manifest_digest[0]) == NULL);
+    CHECK(bundle_pack(images, 3, true, framed, sizeof(framed), &files[7].size, manifest_digest[1]) == NULL);
+}
+
+static void setup(uint32_t mode)
+{
+    board_reset();
+    mock_gpio_reset();
+    GPIO_DRV_Init(gpio1_InpConfig0, gpio1_OutConfig0);
+    mock_lpuart_reset();
+    mock_flash_reset();
+    mock_spi_reset();
+    mock_modem_init(&modem);
+    mock_ezport_init();
+
+    periph_up = 0;
+    RING_flush(&ublox_ring);
+    ublox_ring.throttled = false;
+    ublox_ring.overruns = 0;
+    ublox_ring.stalls = 0;
+    memset(&ublox_stats, 0, sizeof(ublox_stats));
+    ublox_stats.read_size = UBLOX_READ_SIZE;
+    clean_reads = 0;
+    ublox_flow = 0;
+    ublox_flow_out = false;
+    image_source = BOOT_FLAG_ERASED;
+    transfer_mode = mode;
+}
+
+//every image installed, the user module booted into the new one
+static void check_installed(void)
+{
+    CHECK_MEM(&mock_flash[SYSTEM_APP_ADDRESS], system_image, sizeof(system_image));
+    CHECK_MEM(&mock_ezport[0], userboot, sizeof(userboot));
+    CHECK_MEM(&mock_ezport[USER_APP_ADDRESS], user, sizeof(user));
+    CHECK_EQ(mock_ezport_boots, 1);
+    CHECK_EQ(mock_ezport_violations, 0);
+    CHECK_EQ(mock_flash_violations, 0);
+}
+
+//BOOT_CheckFlag's three files, in its order, from power on
+static bool install_files(uint32_t mode)
+{
+    bool framing = mode == BOOT_TRANSFER_FRAMED;
+    bool ok;
+
+    setup(mode);
+    BOOT_ublox_wait_ready();
+    ok = BOOT_LoadSystemFromUblox(framing ? "system.frm" : "system.bin", sizeof(system_image), 0,
+            digests[BOOT_IMAGE_SYSTEM]);
+    PERIPH_init(PERIPH_EZPORT);
+    BOOT_UserEnter();
+    ok = BOOT_LoadUserFromUblox(0x0, framing ? "userboot.frm" : "userboot.bin", sizeof(userboot), 0,
+            digests[BOOT_IMAGE_USERBOOT]) && ok;
+    ok = BOOT_LoadUserFromUblox(USER_APP_ADDRESS, framing ? "user.frm" : "user.bin", sizeof(user), 0,
+            digests[BOOT_IMAGE_USER]) && ok;
+    BOOT_UserExit();
+    return ok;
+}
+
+//and the same from the bundle
+static bool install_bundle(uint32_t mode)
+{
+    bool framing = mode == BOOT_TRANSFER_FRAMED;
+
+    setup(mode);
+    BOOT_ublox_wait_ready();
+    return BOOT_LoadBundle(framing ? "update.bfr" : "update.bnd", 0, manifest_digest[framing]);
+}
+
+static void test_bundle(void)
+{
+    CHECK(install_bundle(BOOT_FLAG_ERASED));
+    check_installed();
+    CHECK(install_bundle(BOOT_TRANSFER_FRAMED));
+    check_installed();
+}
+
+//a manifest that doesn't match its digest installs nothing
+static void test_manifest(void)
+{
+    plain[8] ^= 0x01;
+    CHECK(!install_bundle(BOOT_FLAG_ERASED));
+    CHECK_EQ(mock_flash_erases, 0);
+    CHECK_EQ(mock_ezport_erases, 0);
+    plain[8] ^= 0x01;
+}
+
+//the time from power on to the last image in, and the URDBLOCK requests
+//it took
+static void bench(void)
+{
+    uint32_t bytes = sizeof(userboot) + sizeof(user) + sizeof(system_image);
+
+    printf("bundle       %-6s %-7s %9s %6s %8s\n", "mode", "update", "total", "reads", "B/s");
+    for(uint32_t framing = 0; framing < 2; framing++)
+    {
+        uint32_t mode = framing ? BOOT_TRANSFER_FRAMED : BOOT_FLAG_ERASED;
+        uint64_t ns[2];
+
+        for(uint32_t bundled = 0; bundled < 2; bundled++)
+        {
+            CHECK(bundled ? install_bundle(mode) : install_files(mode));
+            check_installed();
+            ns[bundled] = board_ns;
+            printf("bundle       %-6s %-7s %7.2f s %6" PRIu32 " %8.0f\n", framing ? "framed" : "plain",
+                   bundled ? "bundle" : "files", board_ns / 1e9, mock_modem_stats.urdblocks, bytes * 1e9 / board_ns);
+        }
+        //the manifest is one more read and the images the same ones
+        CHECK(ns[1] < ns[0] + ns[0] / 50);
+    }
+}
+
+int main(void)
+{
+    make_images();
+    test_bundle();
+    test_manifest();
+    bench();
+    return CHECK_DONE("bundle");
+}
@@ -0,0 +1,88 @@
+/*
+  test_crc.c - CRC16 and block hash known answers
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "crc.h"
+#include "check.h"
+
+//CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, not reflected
+static void test_crc16(void)
+{
+    uint8_t data[256];
+
+    CHECK_EQ(CRC_crc16(CRC16_INIT, (const uint8_t *)"123456789", 9), 0x29B1);
+    CHECK_EQ(CRC_crc16(CRC16_INIT, data, 0), 0xFFFF);
+
+    for(uint32_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)i;
+    CHECK_EQ(CRC_crc16(CRC16_INIT, data, sizeof(data)), 0x3FBD);
+
+    //frames are checked in one call, but the CRC must chain
+    for(uint32_t cut = 0; cut <= sizeof(data); cut += 17)
+    {
+        uint16_t crc = CRC_crc16(CRC16_INIT, data, cut);
+        CHECK_EQ(CRC_crc16(crc, &data[cut], sizeof(data) - cut), 0x3FBD);
+    }
+}
+
+//a BOOT_TRANSFER_FRAMED frame carrying "123456789":
+//<len:2 LE><payload><crc16:2 LE over len+payload>
+static void test_frame(void)
+{
+    const uint8_t frame[2 + 9 + 2] = {9, 0, '1', '2', '3', '4', '5', '6', '7', '8', '9', 0x0B, 0x9F};
+    uint16_t crc = frame[11] | (frame[12] << 8);
+
+    CHECK_EQ(CRC_crc16(CRC16_INIT, frame, 11), crc);
+}
+
+//MurmurHash3_x86_32, seed 0, so READ_HASHES can be checked with any
+//stock implementation; lengths cover the unrolled and the tail loops
+static void test_hash32(void)
+{
+    uint32_t words[256] = {0};
+    uint8_t *bytes = (uint8_t *)words;
+
+    CHECK_EQ(CRC_hash32(words, 0), 0);
+
+    memcpy(words, "test", 4);
+    CHECK_EQ(CRC_hash32(words, 1), 0xBA6BD213);
+
+    memcpy(words, "abcdefgh", 8);
+    CHECK_EQ(CRC_hash32(words, 2), 0x49DDCCC4);
+
+    memcpy(words, "The quick brown fox jumps over the lazy dog!", 44);
+    CHECK_EQ(CRC_hash32(words, 11), 0xB254003B);
+
+    //a 1 KB hash block
+    for(uint32_t i = 0; i < sizeof(words); i++)
+        bytes[i] = (uint8_t)i;
+    CHECK_EQ(CRC_hash32(words, 256), 0x9F5E3B19);
+}
+
+int main(void)
+{
+    test_crc16();
+    test_frame();
+    test_hash32();
+    return CHECK_DONE("crc");
+}
@@ -0,0 +1,131 @@
+/*
+  test_ed25519.c - Ed25519 verification known answers
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "ed25519.h"
+#include "check.h"
+
+typedef struct
+{
+    const char *public_key;
+    const char *message;
+    const char *signature;
+}vector_t;
+
+//RFC 8032 section 7.1, tests 1 to 3
+static const vector_t vectors[] = {
+    {
+        "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+        "",
+        "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+        "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b",
+    },
+    {
+        "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+        "72",
+        "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+        "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00",
+    },
+    {
+        "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+        "af82",
+        "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+        "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a",
+    },
+};
+
+//group order L, little endian
+static const uint8_t L[32] = {
+    0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58, 0xD6, 0x9C, 0xF7, 0xA2, 0xDE, 0xF9, 0xDE, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+static void test_vectors(void)
+{
+    uint8_t key[ED25519_KEY_SIZE];
+    uint8_t message[16];
+    uint8_t signature[ED25519_SIGNATURE_SIZE];
+
+    for(uint32_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++)
+    {
+        uint32_t size = unhex(vectors[v].message, message);
+
+        unhex(vectors[v].public_key, key);
+        unhex(vectors[v].signature, signature);
+        CHECK(ED25519_verify(signature, key, message, size));
+    }
+}
+
+//anything that doesn't match must be refused, not just most things
+static void test_rejects(void)
+{
+    uint8_t key[ED25519_KEY_SIZE];
+    uint8_t other[ED25519_KEY_SIZE];
+    uint8_t message[16];
+    uint8_t signature[ED25519_SIGNATURE_SIZE];
+    uint8_t bad[ED25519_SIGNATURE_SIZE];
+    uint32_t size;
+    uint32_t carry = 0;
+
+    unhex(vectors[2].public_key, key);
+    unhex(vectors[1].public_key, other);
+    unhex(vectors[2].signature, signature);
+    size = unhex(vectors[2].message, message);
+
+    //every bit of R and S
+    for(uint32_t bit = 0; bit < ED25519_SIGNATURE_SIZE * 8; bit++)
+    {
+        memcpy(bad, signature, sizeof(bad));
+        bad[bit / 8] ^= 1 << (bit % 8);
+        CHECK(!ED25519_verify(bad, key, message, size));
+    }
+
+    //message and key
+    message[0] ^= 0x01;
+    CHECK(!ED25519_verify(signature, key, message, size));
+    message[0] ^= 0x01;
+    CHECK(!ED25519_verify(signature, other, message, size));
+    CHECK(!ED25519_verify(signature, key, message, size + 1));
+
+    //S + L is the same scalar mod L but not canonical
+    memcpy(bad, signature, sizeof(bad));
+    for(uint32_t i = 0; i < 32; i++)
+    {
+        carry += bad[32 + i] + L[i];
+        bad[32 + i] = (uint8_t)carry;
+        carry >>= 8;
+    }
+    CHECK(!ED25519_verify(bad, key, message, size));
+
+    //a public key off the curve
+    memset(other, 0, sizeof(other));
+    other[0] = 2;
+    CHECK(!ED25519_verify(signature, other, message, size));
+}
+
+int main(void)
+{
+    test_vectors();
+    test_rejects();
+    return CHECK_DONE("ed25519");
+}
@@ -0,0 +1,284 @@
+/*
+  test_ezport.c - user module programming from the I2C host, against the EZPort model
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//ipc_i2c.c runs its command task on the board clock while a host model
+//plays the I2C master: USER_ENTER, then for each block a READ_STATUS poll
+//until the slave isn't busy and a WRITE_USER_BLOCK, then USER_EXIT.  The
+//blocks go over ext_flash.c into the EZPort model.  Build with
+//-DUSER_SLOTS=1 to take the reception and programming overlap away.
+
+#include <setjmp.h>
+
+#include "check.h"
+#include "board.h"
+#include "ezport.h"
+#include "flash1.h"
+#include "i2cCom1.h"
+#include "../Sources/ipc_i2c.c"
+
+#define IMAGE_SIZE      (32 * 1024)
+#define HOST_POLL_US    (100)       //between status reads while busy
+
+//the Processor Expert configuration of the EZPort bus
+spi_master_state_t spiComEZPort_MasterState;
+uint32_t spiComEZPort_calculatedBaudRate;
+const spi_master_user_config_t spiComEZPort_MasterConfig0 = {
+    .bitsPerSec = 4000000U,
+};
+
+//what main brings up before i2cCom1_Task, as periph.c does
+void PERIPH_init(uint32_t units)
+{
+    if(units & PERIPH_EZPORT)
+    {
+        SPI_DRV_MasterInit(FSL_SPICOMEZPORT, &spiComEZPort_MasterState);
+        SPI_DRV_MasterConfigureBus(FSL_SPICOMEZPORT, &spiComEZPort_MasterConfig0, &spiComEZPort_calculatedBaudRate);
+    }
+}
+
+void PERIPH_deinit(uint32_t units)
+{
+    (void)units;
+}
+
+void NVIC_SystemReset(void)
+{
+    CHECK(false);
+}
+
+static uint8_t image[IMAGE_SIZE];
+
+//the host: each transaction takes its bytes' time on the bus, and is
+//held off while the slave stretches the clock with its interrupt masked
+typedef enum
+{
+    HOST_IDLE,
+    HOST_ENTER,
+    HOST_POLL,
+    HOST_BLOCK,
+    HOST_EXIT,
+    HOST_DONE,
+}host_state_t;
+
+static struct
+{
+    host_state_t state;
+    uint64_t at;                //the transaction in flight ends
+    uint64_t byte_ns;           //9 clocks at the bus rate
+    uint32_t block;             //next block of the image to send
+    uint32_t polls;
+    uint32_t errors;            //status reads with the error bit set
+    uint64_t bus_ns;            //the bus's time with the slave never busy
+}host;
+
+static void HOST_start(host_state_t state, uint32_t bytes)
+{
+    uint64_t ns = bytes * host.byte_ns;
+
+    host.state = state;
+    host.at = board_ns + ns;
+    host.bus_ns += ns;
+}
+
+static uint64_t HOST_next(void)
+{
+    if(host.state == HOST_IDLE || host.state == HOST_DONE)
+        return BOARD_NEVER;
+    if(!board_irqs() || !mock_i2c_enabled())
+        return BOARD_NEVER;
+    return host.at;
+}
+
+static void HOST_run(void)
+{
+    static uint8_t payload[sizeof(i2c_block_t)];
+    uint8_t result;
+
+    switch(host.state)
+    {
+    case HOST_ENTER:
+        mock_i2c_address();
+        mock_i2c_byte(CMDI2C_USER_ENTER);
+        mock_i2c_stop();
+        //address and command, then address and the status byte
+        HOST_start(HOST_POLL, 4);
+        break;
+    case HOST_POLL:
+        mock_i2c_address();
+        mock_i2c_byte(CMDI2C_READ_STATUS);
+        mock_i2c_stop();
+        mock_i2c_read(&result, 1);
+        mock_i2c_stop();
+        host.polls++;
+        if(result & 0x02)
+            host.errors++;
+        //polls repeated while busy are waiting, not the bus's own time
+        if(result & 0x01)
+            host.at = board_ns + HOST_POLL_US * BOARD_US + 4 * host.byte_ns;
+        else if(host.block * BLOCK_SIZE < IMAGE_SIZE)
+            HOST_start(HOST_BLOCK, 2 + sizeof(payload));
+        else
+            HOST_start(HOST_EXIT, 2);
+        break;
+    case HOST_BLOCK:
+    {
+        uint32_t index = USER_APP_ADDRESS / BLOCK_SIZE + host.block;
+
+        payload[0] = index >> 8;
+        payload[1] = index;
+        memcpy(&payload[2], &image[host.block * BLOCK_SIZE], BLOCK_SIZE);
+        mock_i2c_address();
+        mock_i2c_byte(CMDI2C_WRITE_USER_BLOCK);
+        for(uint32_t i = 0; i < sizeof(payload); i++)
+            mock_i2c_byte(payload[i]);
+        mock_i2c_stop();
+        host.block++;
+        HOST_start(HOST_POLL, 4);
+        break;
+    }
+    case HOST_EXIT:
+        mock_i2c_address();
+        mock_i2c_byte(CMDI2C_USER_EXIT);
+        mock_i2c_stop();
+        host.state = HOST_DONE;
+        break;
+    default:
+        break;
+    }
+}
+
+static board_model_t host_model = {
+    .next = HOST_next,
+    .run = HOST_run,
+};
+
+//SCHED_run doesn't return: a task of its own starts the host once the
+//command loop is up and leaves once the user module runs the new image
+static sched_task_t stop_task;
+static jmp_buf stop;
+static uint64_t start_ns;
+static uint64_t end_ns;
+
+static void stop_fn(sched_task_t *task, uint32_t events)
+{
+    (void)events;
+    if(host.state == HOST_IDLE)
+    {
+        start_ns = board_ns;
+        HOST_start(HOST_ENTER, 2);
+    }
+    else if(host.state == HOST_DONE && mock_ezport_boots == 2)
+    {
+        end_ns = board_ns;
+        longjmp(stop, 1);
+    }
+    SCHED_sleep(task, 1);
+}
+
+typedef struct
+{
+    uint64_t ns;                //USER_ENTER to the new image running
+    uint64_t bus_ns;
+    uint64_t task_ns;           //the command task's own time, programming
+}run_t;
+
+static run_t program(uint32_t bus_hz)
+{
+    run_t run;
+
+    board_reset();
+    mock_gpio_reset();
+    mock_spi_reset();
+    mock_flash_reset();
+    mock_ezport_init();
+    mock_i2c_reset();
+    mock_i2c_callback = i2cCom1_Handler;
+    memset(&sched, 0, sizeof(sched));
+    memset(&host, 0, sizeof(host));
+    host.byte_ns = 9ULL * 1000000000ULL / bus_hz;
+    board_add(&host_model);
+
+    i2cCom1_UserData.state = STI2C_IDLE;
+    status.byte = 0;
+    user_entered = false;
+    user_queued = 0;
+    user_rx = 0;
+    user_tx = 0;
+
+    //main's bring up: the user module runs its old image
+    GPIO_DRV_Init(gpio1_InpConfig0, gpio1_OutConfig0);
+    PERIPH_init(PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT);
+    SCHED_add(&stop_task, stop_fn);
+    SCHED_sleep(&stop_task, 0);
+    if(!setjmp(stop))
+        i2cCom1_Task();
+
+    run.ns = end_ns - start_ns;
+    run.bus_ns = host.bus_ns;
+    run.task_ns = command_task.busy_cycles / BOARD_CORE_MHZ * BOARD_US;
+
+    CHECK_MEM(&mock_ezport[USER_APP_ADDRESS], image, IMAGE_SIZE);
+    CHECK_EQ(mock_ezport_violations, 0);
+    CHECK_EQ(mock_ezport_erases, IMAGE_SIZE / MOCK_EZPORT_SECTOR_SIZE);
+    //the vectors last, once every block is in
+    CHECK_EQ(mock_ezport_last, USER_APP_ADDRESS);
+    CHECK_EQ(host.errors, 0);
+    CHECK_EQ(status.fields.error, 0);
+    CHECK_EQ(mock_flash_erases, 0);
+    return run;
+}
+
+//the time from USER_ENTER to the new image running, with the bus and
+//the programming each would take alone
+static void bench(void)
+{
+    static const uint32_t rates[] = { 100000, 400000, 1000000 };
+
+    printf("%-12s %8s %9s %9s %9s %7s\n", USER_SLOTS > 1 ? "ezport" : "ezport_serial",
+           "bus kHz", "total", "bus", "program", "KB/s");
+    for(uint32_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        run_t run = program(rates[i]);
+
+        printf("%-12s %8" PRIu32 " %7.3f s %7.3f s %7.3f s %7.1f\n", USER_SLOTS > 1 ? "ezport" : "ezport_serial",
+               rates[i] / 1000, run.ns / 1e9, run.bus_ns / 1e9, run.task_ns / 1e9, IMAGE_SIZE / 1024 / (run.ns / 1e9));
+        if(USER_SLOTS > 1)
+        {
+            //a block arrives while the one before programs: the update
+            //takes about as long as the slower of the two alone
+            uint64_t slower = run.bus_ns > run.task_ns ? run.bus_ns : run.task_ns;
+            CHECK(run.ns < slower + slower / 4);
+        }
+        else
+        {
+            CHECK(run.ns > (run.bus_ns + run.task_ns) * 9 / 10);
+        }
+    }
+}
+
+int main(void)
+{
+    for(uint32_t i = 0; i < IMAGE_SIZE; i++)
+        image[i] = (uint8_t)(i * 31 + (i >> 8));
+    bench();
+    return CHECK_DONE(USER_SLOTS > 1 ? "ezport" : "ezport_serial");
+}
@@ -0,0 +1,341 @@
+/*
+  test_factory.c - a factory session from the fixture's programmer, against FACTORY_Task
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//factory_prog.c plays the fixture on the far end of the modem LPUART
+//while FACTORY_Task runs on the board clock: the sync at 115200, the
+//switch to FACTORY_BAUD, then the system image into the internal flash
+//model and the user module's two over EZPort.  Each side sends at its own
+//rate, and a byte sent at one rate and received at another arrives as
+//something else.  The bench garbles bytes both ways once the session runs
+//and compares stop-and-wait with the full window.
+
+#include <setjmp.h>
+
+#include "check.h"
+#include "board.h"
+#include "flash1.h"
+#include "ezport.h"
+
+//the loaders and their statics; VERSION_* come from the build
+#include "../Sources/boot.c"
+#include "../Sources/factory.c"
+
+#define FACTORY_PROG_NO_MAIN
+#include "factory_prog.c"
+
+#define SYSTEM_SIZE     (32 * 1024)
+#define USERBOOT_SIZE   (8 * 1024)
+#define USER_SIZE       (24 * 1024)
+#define HOST_POLL_US    (50)        //the fixture's loop with nothing to send
+
+//the Processor Expert configuration of the EZPort bus
+spi_master_state_t spiComEZPort_MasterState;
+uint32_t spiComEZPort_calculatedBaudRate;
+const spi_master_user_config_t spiComEZPort_MasterConfig0 = {
+    .bitsPerSec = 4000000U,
+};
+
+//what PERIPH_init brings up for FACTORY_Task, as periph.c and Events.c do
+static uint32_t periph_up;
+
+void lpuartUblox_RxCallback(uint32_t instance, void *lpuartState)
+{
+    lpuart_state_t *ptr = (lpuart_state_t *)lpuartState;
+    (void)instance;
+    RING_push(&ublox_ring, *(ptr->rxBuff));
+}
+
+void PERIPH_init(uint32_t units)
+{
+    if((units & PERIPH_UBLOX) && !(periph_up & PERIPH_UBLOX))
+    {
+        LPUART_DRV_Init(FSL_LPUARTUBLOX, &lpuartUblox_State, &lpuartUblox_InitConfig0);
+        LPUART_DRV_InstallRxCallback(FSL_LPUARTUBLOX, lpuartUblox_RxCallback, ublox_rx, NULL, true);
+    }
+    if((units & PERIPH_EZPORT) && !(periph_up & PERIPH_EZPORT))
+    {
+        SPI_DRV_MasterInit(FSL_SPICOMEZPORT, &spiComEZPort_MasterState);
+        SPI_DRV_MasterConfigureBus(FSL_SPICOMEZPORT, &spiComEZPort_MasterConfig0, &spiComEZPort_calculatedBaudRate);
+    }
+    periph_up |= units;
+}
+
+void PERIPH_deinit(uint32_t units)
+{
+    periph_up &= ~units;
+}
+
+//the session ends in a reset
+static jmp_buf reset;
+static uint64_t reset_ns;
+
+void NVIC_SystemReset(void)
+{
+    reset_ns = board_ns;
+    longjmp(reset, 1);
+}
+
+static bool bad_digest;            //the fixture sends the first image's wrong
+
+static uint8_t system_image[SYSTEM_SIZE];
+static uint8_t userboot[USERBOOT_SIZE];
+static uint8_t user[USER_SIZE];
+
+static const factory_image_t images[] = {
+    { BOOT_IMAGE_SYSTEM, system_image, sizeof(system_image) },
+    { BOOT_IMAGE_USERBOOT, userboot, sizeof(userboot) },
+    { BOOT_IMAGE_USER, user, sizeof(user) },
+};
+
+//the fixture: one frame at a time onto the line at its own rate, and the
+//unit's bytes into factory_prog_receive as they arrive
+static struct
+{
+    factory_prog_t prog;
+    uint32_t baud;
+    uint8_t out[FACTORY_PROG_FRAME_MAX];
+    uint32_t out_size;
+    uint32_t out_pos;
+    uint32_t out_baud;          //the byte on the line went out at
+    uint64_t at;                //it arrives
+    uint64_t poll;              //factory_prog_send next asked
+    uint32_t ppm;               //bytes garbled per million each way, in session
+    uint32_t seed;
+    uint32_t garbled;
+    uint64_t done_ns;
+}host;
+
+static uint64_t HOST_byte_ns(uint32_t baud)
+{
+    //start, 8 data and stop bits
+    return 10 * 1000000000ULL / baud;
+}
+
+static uint8_t HOST_line(uint8_t data, uint32_t sent, uint32_t received)
+{
+    if(sent != received)
+        return data ^ 0xA5;
+    if(host.ppm && host.prog.state == FACTORY_PROG_SESSION)
+    {
+        host.seed = host.seed * 1103515245 + 12345;
+        if((host.seed >> 8) % 1000000 < host.ppm)
+        {
+            host.garbled++;
+            data ^= 1 << (host.seed >> 29);
+        }
+    }
+    return data;
+}
+
+static uint64_t HOST_next(void)
+{
+    if(host.out_pos < host.out_size)
+        return host.at;
+    if(host.prog.state == FACTORY_PROG_DONE || host.prog.state == FACTORY_PROG_FAILED)
+        return BOARD_NEVER;
+    return host.poll;
+}
+
+static void HOST_run(void)
+{
+    if(host.out_pos < host.out_size)
+    {
+        if(board_ns < host.at)
+            return;
+        mock_lpuart_rx(HOST_line(host.out[host.out_pos++], host.out_baud, mock_lpuart_baud));
+        if(host.out_pos < host.out_size)
+        {
+            host.at += HOST_byte_ns(host.out_baud);
+            return;
+        }
+    }
+    if(board_ns < host.poll)
+        return;
+
+    //the rate changes with the line idle
+    host.baud = factory_prog_baud(&host.prog);
+    host.out_size = factory_prog_send(&host.prog, board_ns / BOARD_US, host.out);
+    host.out_pos = 0;
+    host.out_baud = host.baud;
+    host.at = board_ns + HOST_byte_ns(host.baud);
+    if(!host.out_size)
+        host.poll = board_ns + HOST_POLL_US * BOARD_US;
+}
+
+static void HOST_rx(uint8_t data)
+{
+    factory_prog_receive(&host.prog, HOST_line(data, mock_lpuart_baud, host.baud), board_ns / BOARD_US);
+    if(host.prog.state == FACTORY_PROG_DONE && !host.done_ns)
+        host.done_ns = board_ns;
+    host.poll = board_ns;
+}
+
+static board_model_t host_model = {
+    .next = HOST_next,
+    .run = HOST_run,
+};
+
+static void fill(uint8_t *image, uint32_t size, uint32_t seed)
+{
+    for(uint32_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+}
+
+//main's bring up as far as FACTORY_Task, then the task
+static bool session(const factory_image_t *list, uint32_t count, uint32_t window, uint32_t ppm, bool fixture)
+{
+    board_reset();
+    mock_gpio_reset();
+    GPIO_DRV_Init(gpio1_InpConfig0, gpio1_OutConfig0);
+    mock_lpuart_reset();
+    mock_flash_reset();
+    mock_spi_reset();
+    mock_ezport_init();
+
+    periph_up = 0;
+    RING_flush(&ublox_ring);
+    ublox_ring.high = UBLOX_RING_HIGH;
+    ublox_ring.throttled = false;
+    ublox_ring.overruns = 0;
+    image_open = false;
+    user_entered = false;
+    nak_sent = false;
+    next_seq = 0;
+
+    memset(&host, 0, sizeof(host));
+    factory_prog_start(&host.prog, list, count, window);
+    if(bad_digest)
+        host.prog.sha256[0][0] ^= 1;
+    host.ppm = ppm;
+    host.seed = 1;
+    if(fixture)
+    {
+        mock_lpuart_peer = HOST_rx;
+        board_add(&host_model);
+    }
+
+    PERIPH_init(PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT);
+    reset_ns = 0;
+    if(setjmp(reset))
+        return true;
+    FACTORY_Task();
+    return false;
+}
+
+//every image in, the user module running its new one
+static void check_installed(void)
+{
+    CHECK_EQ(host.prog.state, FACTORY_PROG_DONE);
+    CHECK_MEM(&mock_flash[SYSTEM_APP_ADDRESS], system_image, sizeof(system_image));
+    CHECK_MEM(&mock_ezport[0], userboot, sizeof(userboot));
+    CHECK_MEM(&mock_ezport[USER_APP_ADDRESS], user, sizeof(user));
+    CHECK_EQ(mock_ezport_boots, 1);
+    CHECK_EQ(mock_ezport_violations, 0);
+    CHECK_EQ(mock_flash_violations, 0);
+    //the credit stops the line while the internal flash programs
+    CHECK_EQ(mock_lpuart_overruns, 0);
+    CHECK_EQ(ublox_ring.overruns, 0);
+    for(uint32_t i = 0; i < 3; i++)
+        CHECK(host.prog.install_us[i] != 0);
+}
+
+//no fixture: the task gives up after FACTORY_LISTEN_MS and boot goes on
+static void test_absent(void)
+{
+    CHECK(!session(images, 3, FACTORY_WINDOW, 0, false));
+    CHECK(board_ns < (FACTORY_LISTEN_MS + 1) * BOARD_MS);
+    CHECK_EQ(mock_flash_erases, 0);
+    CHECK_EQ(mock_ezport_erases, 0);
+}
+
+static void test_session(void)
+{
+    CHECK(session(images, 3, FACTORY_WINDOW, 0, true));
+    check_installed();
+    CHECK_EQ(mock_lpuart_baud, FACTORY_BAUD);
+    CHECK_EQ(host.prog.naks, 0);
+    CHECK_EQ(host.prog.timeouts, 0);
+    CHECK_EQ(host.prog.resent, 0);
+}
+
+//an image that doesn't match its digest fails at CLOSE and is left
+//without its vectors; the unit resets once the fixture goes quiet
+static void test_mismatch(void)
+{
+    uint8_t erased[STAGE_VECTORS_SIZE];
+
+    memset(erased, 0xFF, sizeof(erased));
+    bad_digest = true;
+    CHECK(session(images, 1, FACTORY_WINDOW, 0, true));
+    bad_digest = false;
+    CHECK_EQ(host.prog.state, FACTORY_PROG_FAILED);
+    CHECK(strcmp(host.prog.error, "the image didn't verify") == 0);
+    CHECK_MEM(&mock_flash[SYSTEM_APP_ADDRESS], erased, sizeof(erased));
+    CHECK(reset_ns > FACTORY_IDLE_MS * BOARD_MS);
+    CHECK_EQ(mock_ezport_erases, 0);
+}
+
+//per unit: the first sync to the RESET's ACK, and each image's install
+//time as CLOSE reports it
+static void bench(void)
+{
+    static const struct { uint32_t window; uint32_t ppm; } rows[] = {
+        { 1, 0 },
+        { FACTORY_WINDOW, 0 },
+        { FACTORY_WINDOW, 100 },
+        { FACTORY_WINDOW, 1000 },
+    };
+    uint64_t unit_ns[4];
+    uint32_t bytes = SYSTEM_SIZE + USERBOOT_SIZE + USER_SIZE;
+
+    printf("%-12s %6s %5s %9s %9s %9s %9s %5s %5s %6s\n", "factory", "window", "ppm",
+           "unit", "system", "userboot", "user", "NAKs", "t/o", "KB/s");
+    for(uint32_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++)
+    {
+        CHECK(session(images, 3, rows[i].window, rows[i].ppm, true));
+        check_installed();
+        unit_ns[i] = host.done_ns;
+        printf("%-12s %6" PRIu32 " %5" PRIu32 " %7.3f s %6.1f ms %6.1f ms %6.1f ms %5" PRIu32 " %5" PRIu32 " %6.1f\n",
+               "factory", rows[i].window, rows[i].ppm, unit_ns[i] / 1e9,
+               host.prog.install_us[0] / 1e3, host.prog.install_us[1] / 1e3, host.prog.install_us[2] / 1e3,
+               host.prog.naks, host.prog.timeouts, bytes / 1024 / (unit_ns[i] / 1e9));
+        if(rows[i].ppm)
+            CHECK(host.garbled != 0 && host.prog.resent != 0);
+    }
+    //frames arrive while the one before programs
+    CHECK(unit_ns[1] < unit_ns[0]);
+}
+
+int main(void)
+{
+    fill(system_image, sizeof(system_image), 3);
+    fill(userboot, sizeof(userboot), 1);
+    fill(user, sizeof(user), 2);
+    test_absent();
+    test_session();
+    test_mismatch();
+    bench();
+    return CHECK_DONE("factory");
+}
@@ -0,0 +1,207 @@
+/*
+  test_i2c_slave.c - host model of the I2C slave receive path
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//ipc_i2c.c is built against mock/i2cCom1.h, whose bus plays a master
+//writing a command and its payload.  Payloads of I2C_DMA_MIN bytes or more
+//go to the DMA channel; build with -DI2C_DMA_MIN=0x10000 to run the same
+//sequences through the interrupt per byte path for comparison.  Each run
+//prints the ISR entries a 1026 byte WRITE_SYSTEM_BLOCK costs.
+
+#include <stdio.h>
+
+#include "i2cCom1.h"
+#include "../Sources/ipc_i2c.c"
+#include "check.h"
+
+perf_t perf;
+konekt_flash_id_t id;
+
+void GPIO_DRV_SetPinDir(uint32_t pin, gpio_pin_direction_t direction) { (void)pin; (void)direction; }
+void GPIO_DRV_SetPinOutput(uint32_t pin) { (void)pin; }
+void GPIO_DRV_ClearPinOutput(uint32_t pin) { (void)pin; }
+void GPIO_DRV_WritePinOutput(uint32_t pin, uint32_t output) { (void)pin; (void)output; }
+bool FLASH_erase_sector(uint32_t sector_address) { (void)sector_address; return true; }
+bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size) { (void)address; (void)block; (void)size; return true; }
+void EXT_read_block(uint32_t instance, uint32_t address, uint8_t* buffer, uint32_t count) { (void)instance; (void)address; memset(buffer, 0xFF, count); }
+void EXT_write_block(uint32_t instance, uint32_t address, uint8_t* buffer, uint32_t count) { (void)instance; (void)address; (void)buffer; (void)count; }
+void EXT_erase_sector(uint32_t instance, uint32_t address) { (void)instance; (void)address; }
+void BOOT_UserEnterStep(uint32_t step) { (void)step; }
+void BOOT_UserExitStep(uint32_t step) { (void)step; }
+void PERIPH_init(uint32_t units) { (void)units; }
+void PERIPH_deinit(uint32_t units) { (void)units; }
+uint32_t PERF_start(void) { return 0; }
+void PERF_stop(perf_timer_t timer, uint32_t start) { (void)timer; (void)start; }
+void NVIC_SystemReset(void) { }
+void OSA_TimeDelay(uint32_t ms) { (void)ms; }
+uint32_t OSA_TimeGetMsec(void) { return 0; }
+uint64_t OSA_TimeGetCycles(void) { return 0; }
+void OSA_TimeIdle(uint32_t ms) { (void)ms; }
+uint32_t CRC_hash32(const uint32_t *data, uint32_t words) { (void)data; (void)words; return 0; }
+
+static bool using_dma(void)
+{
+    return sizeof(i2c_block_t) >= I2C_DMA_MIN;
+}
+
+static void setup(void)
+{
+    mock_i2c_reset();
+    mock_i2c_callback = i2cCom1_Handler;
+    i2cCom1_DmaInit();
+    i2cCom1_UserData.state = STI2C_IDLE;
+    dma_active = false;
+    status.byte = 0;
+    user_entered = false;
+    user_queued = 0;
+    user_rx = 0;
+    user_tx = 0;
+    SCHED_add(&command_task, i2cCom1_Command);
+}
+
+//the master's side of a write: address, command, payload, STOP
+static void master_write(uint8_t command, const uint8_t *payload, uint32_t size)
+{
+    mock_i2c_address();
+    mock_i2c_byte(command);
+    for(uint32_t i = 0; i < size; i++)
+        mock_i2c_byte(payload[i]);
+    mock_i2c_stop();
+}
+
+static uint8_t payload[sizeof(i2c_block_t)];
+
+static void fill_payload(uint32_t seed)
+{
+    for(uint32_t i = 0; i < sizeof(payload); i++)
+        payload[i] = (uint8_t)(i * 7 + seed);
+}
+
+//a whole system block lands, is posted once, and marks the slave busy
+static void test_block(void)
+{
+    setup();
+    fill_payload(1);
+    master_write(CMDI2C_WRITE_SYSTEM_BLOCK, payload, sizeof(payload));
+
+    CHECK_MEM((const uint8_t *)&block, payload, sizeof(payload));
+    CHECK_EQ(command_task.events, FLAG_WRITE_SYSTEM);
+    CHECK_EQ(status.fields.busy, 1);
+    CHECK_EQ(i2cCom1_UserData.state, STI2C_IDLE);
+    CHECK(!dma_active);
+
+    uint32_t entries = mock_i2c_irqs + mock_dma_irqs;
+    printf("i2c_slave    %s: %u ISR entries per %u byte block\n",
+            using_dma() ? "DMA" : "per byte", entries, (unsigned)sizeof(payload) + 1);
+    //address, command byte and STOP, plus the DMA done or every payload byte
+    CHECK_EQ(entries, using_dma() ? 4 : 3 + sizeof(payload));
+}
+
+//the DMA done interrupt held off (by INT_SYS_DisableIRQ in the command
+//task) until after the STOP: the block is whole, so STOP finishes it and
+//the late DMA interrupt finds nothing left to do
+static void test_stop_after_done(void)
+{
+    if(!using_dma())
+        return;
+
+    setup();
+    user_entered = true;
+    fill_payload(2);
+    INT_SYS_DisableIRQ(DMA0_IRQn);
+    master_write(CMDI2C_WRITE_USER_BLOCK, payload, sizeof(payload));
+    CHECK_MEM((const uint8_t *)&user_block[0], payload, sizeof(payload));
+    CHECK_EQ(user_queued, 1);
+    CHECK_EQ(command_task.events, FLAG_WRITE_USER);
+    CHECK(!dma_active);
+
+    INT_SYS_EnableIRQ(DMA0_IRQn);
+    mock_dma_service();
+    CHECK_EQ(mock_dma_irqs, 1);
+    CHECK_EQ(user_queued, 1);
+    CHECK_EQ(user_rx, 1);
+
+    //and the next block goes to the other slot as usual
+    fill_payload(3);
+    master_write(CMDI2C_WRITE_USER_BLOCK, payload, sizeof(payload));
+    CHECK_MEM((const uint8_t *)&user_block[1], payload, sizeof(payload));
+    CHECK_EQ(user_queued, 2);
+    CHECK_EQ(status.fields.busy, 1);
+}
+
+//a STOP short of the payload drops the transfer without posting it
+static void test_short(void)
+{
+    if(!using_dma())
+        return;
+
+    setup();
+    fill_payload(4);
+    master_write(CMDI2C_WRITE_SYSTEM_BLOCK, payload, 100);
+    CHECK_EQ(command_task.events, 0);
+    CHECK_EQ(status.fields.busy, 0);
+    CHECK_EQ(i2cCom1_UserData.state, STI2C_IDLE);
+    CHECK(!dma_active);
+    CHECK(!mock_i2c0.dmaen);
+
+    //the slave takes the next command normally
+    fill_payload(5);
+    master_write(CMDI2C_WRITE_SYSTEM_BLOCK, payload, sizeof(payload));
+    CHECK_MEM((const uint8_t *)&block, payload, sizeof(payload));
+    CHECK_EQ(command_task.events, FLAG_WRITE_SYSTEM);
+}
+
+//short payloads stay on the interrupt path
+static void test_hash_request(void)
+{
+    const uint8_t request[] = {0x00, 0x02, 0x08};
+
+    setup();
+    master_write(CMDI2C_HASH_BLOCKS, request, sizeof(request));
+    CHECK_MEM((const uint8_t *)&hash_request, request, sizeof(request));
+    CHECK_EQ(command_task.events, FLAG_HASH_BLOCKS);
+    CHECK_EQ(mock_dma_irqs, 0);
+    CHECK_EQ(mock_i2c_irqs, 3 + sizeof(request));
+}
+
+//a busy slave ignores a second block until the first is programmed
+static void test_busy(void)
+{
+    setup();
+    fill_payload(6);
+    master_write(CMDI2C_WRITE_SYSTEM_BLOCK, payload, sizeof(payload));
+    fill_payload(7);
+    master_write(CMDI2C_WRITE_SYSTEM_BLOCK, payload, sizeof(payload));
+    fill_payload(6);
+    CHECK_MEM((const uint8_t *)&block, payload, sizeof(payload));
+    CHECK(!dma_active);
+    CHECK_EQ(i2cCom1_UserData.state, STI2C_IDLE);
+}
+
+int main(void)
+{
+    test_block();
+    test_stop_after_done();
+    test_short();
+    test_hash_request();
+    test_busy();
+    return CHECK_DONE(using_dma() ? "i2c_slave" : "i2c_slave_pio");
+}
@@ -0,0 +1,179 @@
+/*
+  test_osa_timer.c - SysTick timebase against a simulated counter
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//Built around the source itself so the tick count can be preset.
+#include "../Sources/osa_timer.c"
+
+#include "check.h"
+
+#define PERIOD          (48000U)    //core cycles per ms at 48 MHz
+#define LOAD            (PERIOD - 1U)
+
+//1 ms ticks from OSA_TimeInit, then the count and counter preset; no
+//cycles pass per access unless a test sets mock_systick_step
+static void reset(uint64_t ms, uint32_t val, bool pending)
+{
+    mock_primask = 0;
+    mock_systick_step = 0;
+    OSA_TimeInit();
+    SwTimerIsrCounter = (uint32_t)ms;
+    SwTimerIsrWraps = (uint32_t)(ms >> 32);
+    mock_systick_regs.VAL = val;
+    mock_systick_regs.CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+    mock_scb_regs.ICSR = pending ? SCB_ICSR_PENDSTSET_Msk : 0;
+    mock_systick_cycles = 0;
+}
+
+//cycles since OSA_TimeInit as the counter has it: a tick runs from the
+//reload (LOAD) down to 0, where PENDSTSET is raised for the next one
+static uint64_t truth(void)
+{
+    uint64_t ms = ((uint64_t)SwTimerIsrWraps << 32) | SwTimerIsrCounter;
+    uint32_t val = mock_systick_regs.VAL;
+
+    if((mock_scb_regs.ICSR & SCB_ICSR_PENDSTSET_Msk) && val != 0)
+        ms++;
+    return ms * PERIOD + LOAD - val;
+}
+
+static void test_counter(void)
+{
+    reset(5, LOAD - 4800, false);
+    CHECK_EQ(OSA_TimeGetCycles(), 5 * PERIOD + 4800);
+    CHECK_EQ(OSA_TimeGetUsec(), 5100);
+
+    //first count after the reload
+    reset(5, LOAD, false);
+    CHECK_EQ(OSA_TimeGetCycles(), 5 * PERIOD);
+
+    //last count before the wrap
+    reset(5, 1, false);
+    CHECK_EQ(OSA_TimeGetCycles(), 5 * PERIOD + LOAD - 1);
+    CHECK_EQ(OSA_TimeGetUsec(), 5999);
+}
+
+static void test_countflag(void)
+{
+    //tick already taken, COUNTFLAG left set: nothing more to add
+    reset(5, LOAD - 48, false);
+    mock_systick_regs.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+    CHECK_EQ(OSA_TimeGetCycles(), 5 * PERIOD + 48);
+    CHECK_EQ(OSA_TimeGetUsec(), 5001);
+}
+
+static void test_pending(void)
+{
+    //wrapped with the interrupt held off: the tick is counted here
+    mock_primask = 1;
+    reset(5, LOAD, true);
+    mock_primask = 1;
+    mock_systick_regs.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+    CHECK_EQ(OSA_TimeGetCycles(), 6 * PERIOD);
+    CHECK_EQ(OSA_TimeGetUsec(), 6000);
+    CHECK_EQ(SwTimerIsrCounter, 5);
+
+    //read on the wrap itself: PENDSTSET is already up, and the reread
+    //comes at least a cycle later, after the reload
+    reset(5, 0, true);
+    mock_primask = 1;
+    mock_systick_step = 1;
+    CHECK_EQ(OSA_TimeGetCycles(), 6 * PERIOD + 2);
+}
+
+static void test_race(void)
+{
+    //wraps between the first VAL read and the PENDSTSET check, so the
+    //first read (LOAD counts) must not be paired with the extra tick
+    reset(5, 2, false);
+    mock_systick_step = 1;
+    CHECK_EQ(OSA_TimeGetCycles(), 6 * PERIOD);
+    CHECK_EQ(SwTimerIsrCounter, 6);
+
+    //the same with the reread landing after the reload
+    reset(5, 3, false);
+    mock_systick_step = 2;
+    CHECK_EQ(OSA_TimeGetCycles(), 6 * PERIOD + 2);
+}
+
+static void test_rollover(void)
+{
+    //the interrupt carries into the upper word
+    reset(0xFFFFFFFFULL, LOAD, false);
+    SysTick_Handler();
+    CHECK_EQ(SwTimerIsrCounter, 0);
+    CHECK_EQ(SwTimerIsrWraps, 1);
+    CHECK_EQ(OSA_TimeGetUsec(), 0x100000000ULL * 1000 + 0);
+
+    //and so does a pending tick counted by the read
+    reset(0xFFFFFFFFULL, LOAD, true);
+    mock_primask = 1;
+    CHECK_EQ(OSA_TimeGetCycles(), 0x100000000ULL * PERIOD);
+    CHECK_EQ(OSA_TimeGetUsec(), 0x100000000ULL * 1000);
+
+    reset(0x1FFFFFFFFULL, 1, false);
+    CHECK_EQ(OSA_TimeGetUsec(), 0x1FFFFFFFFULL * 1000 + 999);
+}
+
+//Free-running across the 32 bit rollover with the interrupt taken
+//whenever PRIMASK allows: every read lies between the true time before
+//and after it and never goes backwards.
+static void test_sweep(uint32_t step)
+{
+    uint64_t last = 0;
+    uint64_t last_us = 0;
+    uint32_t bad = 0;
+
+    reset(0xFFFFFFFFULL, LOAD - 1000, false);
+    mock_systick_step = step;
+    for(uint32_t i = 0; i < 20000; i++)
+    {
+        uint64_t before = truth();
+        uint64_t cycles = OSA_TimeGetCycles();
+        uint64_t after = truth();
+        uint64_t us = OSA_TimeGetUsec();
+
+        if(cycles < before || cycles > after || cycles < last || us < last_us)
+        {
+            if(!bad++)
+                fprintf(stderr, "step %u, read %u: %" PRIu64 " not in %" PRIu64 "..%" PRIu64 "\n",
+                        step, i, cycles, before, after);
+        }
+        last = cycles;
+        last_us = us;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(SwTimerIsrWraps, 1);
+}
+
+int main(void)
+{
+    test_counter();
+    test_countflag();
+    test_pending();
+    test_race();
+    test_rollover();
+    test_sweep(1);
+    test_sweep(7);
+    test_sweep(13);
+    test_sweep(4999);
+    return CHECK_DONE("osa_timer");
+}
@@ -0,0 +1,253 @@
+/*
+  test_perf.c - perf_t kept, saved to flash and decoded on the host
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//Built around both sources: PERF_save writes into a simulated sector,
+//and perf_decode.c reads it back as it would a dump from the target.
+#include "../Sources/perf.c"
+#define PERF_DECODE_NO_MAIN
+#include "perf_decode.c"
+
+#include "check.h"
+
+#define SECTOR_SIZE     (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE)
+#define PERF_ADDRESS    (0x5800)    //BOOT_PERF_ADDRESS
+
+static uint64_t now_us;
+static uint8_t sector[SECTOR_SIZE];
+static uint32_t writes;
+
+uint64_t OSA_TimeGetUsec(void)
+{
+    return now_us;
+}
+
+bool FLASH_erase_sector(uint32_t sector_address)
+{
+    if(sector_address != PERF_ADDRESS)
+        return false;
+    memset(sector, 0xFF, sizeof(sector));
+    return true;
+}
+
+//programming only clears bits, in whole phrases inside the sector
+bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size)
+{
+    if(address < PERF_ADDRESS || address + size > PERF_ADDRESS + SECTOR_SIZE ||
+       address % PGM_SIZE_BYTE || size % PGM_SIZE_BYTE)
+        return false;
+    for(uint32_t i = 0; i < size; i++)
+        sector[address - PERF_ADDRESS + i] &= block[i];
+    writes++;
+    return true;
+}
+
+//what perf_print writes, for looking through
+static const char *printed(const perf_record_t *record)
+{
+    static char text[4096];
+    FILE *out = fmemopen(text, sizeof(text), "w");
+
+    perf_print(record, out);
+    fclose(out);
+    return text;
+}
+
+static void reset(void)
+{
+    memset(perf.counter, 0, sizeof(perf.counter));
+    memset(perf.timer, 0, sizeof(perf.timer));
+    memset(sector, 0xFF, sizeof(sector));
+    now_us = 0;
+    writes = 0;
+}
+
+static void timed(perf_timer_t id, uint32_t us)
+{
+    uint32_t start = PERF_start();
+
+    now_us += us;
+    PERF_stop(id, start);
+}
+
+static void test_names(void)
+{
+    //a counter or timer added to perf.h needs its name here too
+    CHECK_EQ(NAMES(counter_names), PERF_COUNTERS);
+    CHECK_EQ(NAMES(timer_names), PERF_TIMERS);
+    CHECK_EQ(sizeof(perf_t), PERF_HEADER_SIZE + PERF_COUNTERS * 4 + PERF_TIMERS * PERF_STAT_SIZE);
+}
+
+static void test_timers(void)
+{
+    reset();
+    now_us = 0xFFFFFF00;    //the microsecond count wraps the 32 bit start
+    timed(PERF_FLASH_ERASE, 300);
+    timed(PERF_FLASH_ERASE, 100);
+    timed(PERF_FLASH_ERASE, 200);
+    CHECK_EQ(perf.timer[PERF_FLASH_ERASE].count, 3);
+    CHECK_EQ(perf.timer[PERF_FLASH_ERASE].sum_us, 600);
+    CHECK_EQ(perf.timer[PERF_FLASH_ERASE].min_us, 100);
+    CHECK_EQ(perf.timer[PERF_FLASH_ERASE].max_us, 300);
+    CHECK_EQ(perf.timer[PERF_FLASH_PROGRAM].count, 0);
+
+    PERF_COUNT(PERF_HTTP_BYTES, 1024);
+    PERF_COUNT(PERF_HTTP_BYTES, 512);
+    CHECK_EQ(perf.counter[PERF_HTTP_BYTES], 1536);
+}
+
+static void test_round_trip(void)
+{
+    static perf_record_t record;
+    const char *error;
+    const char *line;
+    uint32_t stat[5] = { 0 };
+
+    reset();
+    for(uint32_t i = 0; i < PERF_COUNTERS; i++)
+        PERF_COUNT(i, 0x01020304 * (i + 1));
+    for(uint32_t i = 0; i < PERF_TIMERS; i++)
+    {
+        timed(i, 10 + i);
+        timed(i, 1000 * (i + 1));
+    }
+    CHECK(PERF_save(PERF_ADDRESS));
+    CHECK_EQ(writes, 1);
+
+    error = perf_parse(sector, sizeof(sector), &record);
+    CHECK(error == NULL);
+    CHECK_EQ(record.version, PERF_VERSION);
+    CHECK_EQ(record.counters, PERF_COUNTERS);
+    CHECK_EQ(record.timers, PERF_TIMERS);
+    for(uint32_t i = 0; i < PERF_COUNTERS; i++)
+        CHECK_EQ(record.counter[i], perf.counter[i]);
+    for(uint32_t i = 0; i < PERF_TIMERS; i++)
+    {
+        CHECK_EQ(record.timer[i].count, 2);
+        CHECK_EQ(record.timer[i].sum_us, 10 + i + 1000 * (i + 1));
+        CHECK_EQ(record.timer[i].min_us, 10 + i);
+        CHECK_EQ(record.timer[i].max_us, 1000 * (i + 1));
+    }
+
+    //the printed line, count through max
+    line = strstr(printed(&record), "phase_update");
+    CHECK(line != NULL && sscanf(line, "phase_update %u %u %u %u %u",
+                                 &stat[0], &stat[1], &stat[2], &stat[3], &stat[4]) == 5);
+    CHECK_EQ(stat[0], 2);
+    CHECK_EQ(stat[1], 8017);
+    CHECK_EQ(stat[2], 17);
+    CHECK_EQ(stat[3], 4008);
+    CHECK_EQ(stat[4], 8000);
+
+    //a second save replaces the first rather than ANDing into it
+    perf.counter[PERF_I2C_IRQS] = 0xFFFFFFFF;
+    CHECK(PERF_save(PERF_ADDRESS));
+    CHECK(perf_parse(sector, sizeof(sector), &record) == NULL);
+    CHECK_EQ(record.counter[PERF_I2C_IRQS], 0xFFFFFFFF);
+}
+
+static void test_file(void)
+{
+    //as the tool reads it: the sector at its address in a dump from 0
+    static perf_record_t record;
+    char path[] = "/tmp/test_perf_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *file = fdopen(fd, "wb");
+    static uint8_t below[PERF_ADDRESS];
+
+    reset();
+    PERF_COUNT(PERF_UBLOX_BYTES, 123456);
+    timed(PERF_PHASE_UPDATE, 4000000);
+    CHECK(PERF_save(PERF_ADDRESS));
+    memset(below, 0xFF, sizeof(below));
+    fwrite(below, 1, sizeof(below), file);
+    fwrite(sector, 1, sizeof(sector), file);
+    fclose(file);
+
+    CHECK(perf_load(path, PERF_ADDRESS, &record) == NULL);
+    CHECK_EQ(record.counter[PERF_UBLOX_BYTES], 123456);
+    CHECK_EQ(record.timer[PERF_PHASE_UPDATE].max_us, 4000000);
+    CHECK(strcmp(perf_load(path, 0, &record), "erased, no record saved") == 0);
+    unlink(path);
+}
+
+static void test_reject(void)
+{
+    static perf_record_t record;
+    static uint8_t data[SECTOR_SIZE];
+
+    reset();
+    CHECK(strcmp(perf_parse(sector, sizeof(sector), &record), "erased, no record saved") == 0);
+    CHECK(PERF_save(PERF_ADDRESS));
+    CHECK(strcmp(perf_parse(sector, 4, &record), "short record") == 0);
+    CHECK(strcmp(perf_parse(sector, sizeof(perf_t) - 1, &record), "short record") == 0);
+    CHECK(perf_parse(sector, sizeof(perf_t), &record) == NULL);
+
+    memcpy(data, sector, sizeof(data));
+    data[0] ^= 1;
+    CHECK(strcmp(perf_parse(data, sizeof(data), &record), "bad magic") == 0);
+    memcpy(data, sector, sizeof(data));
+    data[4] = PERF_VERSION + 1;
+    CHECK(strcmp(perf_parse(data, sizeof(data), &record), "unknown version") == 0);
+}
+
+static void test_other_firmware(void)
+{
+    //the header's sizes decide: two more counters than this build knows,
+    //then a build with one counter and no timers
+    static perf_record_t record;
+    static uint8_t data[SECTOR_SIZE];
+    uint8_t *p = data + PERF_HEADER_SIZE;
+
+    memset(data, 0, sizeof(data));
+    memcpy(data, &(uint32_t){ PERF_MAGIC }, 4);
+    data[4] = PERF_VERSION;
+    data[5] = PERF_COUNTERS + 2;
+    data[6] = 1;
+    for(uint32_t i = 0; i < PERF_COUNTERS + 2; i++, p += 4)
+        memcpy(p, &(uint32_t){ i + 100 }, 4);
+    memcpy(p, &(uint32_t){ 7 }, 4);
+    CHECK(perf_parse(data, PERF_HEADER_SIZE + (PERF_COUNTERS + 2) * 4 + PERF_STAT_SIZE, &record) == NULL);
+    CHECK_EQ(record.counters, PERF_COUNTERS + 2);
+    CHECK_EQ(record.counter[PERF_COUNTERS + 1], PERF_COUNTERS + 101);
+    CHECK_EQ(record.timers, 1);
+    CHECK_EQ(record.timer[0].count, 7);
+    CHECK(strstr(printed(&record), "i2c_irqs") != NULL);
+    CHECK(strstr(printed(&record), "counter 9 ") != NULL);
+    CHECK(strstr(printed(&record), "ext_erase") == NULL);
+
+    data[5] = 1;
+    data[6] = 0;
+    CHECK(perf_parse(data, PERF_HEADER_SIZE + 4, &record) == NULL);
+    CHECK_EQ(record.counters, 1);
+    CHECK_EQ(record.counter[0], 100);
+}
+
+int main(void)
+{
+    test_names();
+    test_timers();
+    test_round_trip();
+    test_file();
+    test_reject();
+    test_other_firmware();
+    return CHECK_DONE("perf");
+}
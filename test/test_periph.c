@@ -0,0 +1,186 @@
+/*
+  test_periph.c - peripheral bring-up by units, and the arena rule
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//Built around the source itself, with its assert counted rather than fatal
+//and the drivers stubbed to record which are up.
+#include "Cpu.h"
+#undef assert
+#define assert(cond)    ((cond) ? (void)0 : (void)asserts++)
+static uint32_t asserts;
+
+#include "../Sources/periph.c"
+
+#include "check.h"
+
+static uint32_t core_inits;
+static bool i2c_up;
+static bool lpuart_up;
+static uint32_t flash_inits;
+static uint32_t spi_inits;
+
+uint32_t g_xtal0ClkFreq;
+const gpio_input_pin_user_config_t gpio1_InpConfig0[1];
+const gpio_output_pin_user_config_t gpio1_OutConfig0[1];
+i2c_slave_state_t i2cCom1_SlaveState;
+const i2c_slave_user_config_t i2cCom1_SlaveConfig0;
+FLASH_SSD_CONFIG flash1_InitConfig0;
+spi_master_state_t spiComEZPort_MasterState;
+uint32_t spiComEZPort_calculatedBaudRate;
+const spi_master_user_config_t spiComEZPort_MasterConfig0;
+lpuart_state_t lpuartUblox_State;
+unsigned char ublox_rx[8];
+lpuart_user_config_t lpuartUblox_InitConfig0;
+
+void SIM_HAL_EnableClock(void *base, sim_clock_gate_name_t name) { (void)base; (void)name; }
+void init_coredebug_pins(uint32_t instance) { (void)instance; }
+void init_gpio_pins(uint32_t instance) { (void)instance; }
+void init_llwu_pins(uint32_t instance) { (void)instance; }
+void init_osc_pins(uint32_t instance) { (void)instance; }
+void init_rcm_pins(uint32_t instance) { (void)instance; }
+void init_i2c_pins(uint32_t instance) { (void)instance; }
+void init_spi_pins(uint32_t instance) { (void)instance; }
+void init_lpuart_pins(uint32_t instance) { (void)instance; }
+void OSA_Init(void) { core_inits++; }
+void GPIO_DRV_Init(const gpio_input_pin_user_config_t *inputPins, const gpio_output_pin_user_config_t *outputPins) { (void)inputPins; (void)outputPins; }
+void OSA_InstallIntHandler(int32_t irq, void (*handler)(void)) { (void)irq; (void)handler; }
+void i2cCom1_IRQHandler(void) { }
+void lpuartUblox_RxCallback(uint32_t instance, void * lpuartState) { (void)instance; (void)lpuartState; }
+uint32_t FlashInit(PFLASH_SSD_CONFIG pSSDConfig) { (void)pSSDConfig; return flash_inits++; }
+spi_status_t SPI_DRV_MasterInit(uint32_t instance, spi_master_state_t *state) { (void)instance; (void)state; spi_inits++; return kStatus_SPI_Success; }
+void SPI_DRV_MasterConfigureBus(uint32_t instance, const spi_master_user_config_t *device, uint32_t *calculatedBaudRate) { (void)instance; (void)device; (void)calculatedBaudRate; }
+
+void I2C_DRV_SlaveInit(uint32_t instance, const i2c_slave_user_config_t *userConfig, i2c_slave_state_t *slave)
+{
+    (void)instance; (void)userConfig; (void)slave;
+    CHECK(!i2c_up);
+    i2c_up = true;
+}
+
+void I2C_DRV_SlaveDeinit(uint32_t instance)
+{
+    (void)instance;
+    CHECK(i2c_up);
+    i2c_up = false;
+}
+
+void LPUART_DRV_Init(uint32_t instance, lpuart_state_t *lpuartStatePtr, const lpuart_user_config_t *lpuartUserConfig)
+{
+    (void)instance; (void)lpuartStatePtr; (void)lpuartUserConfig;
+    CHECK(!lpuart_up);
+    lpuart_up = true;
+}
+
+void LPUART_DRV_Deinit(uint32_t instance)
+{
+    (void)instance;
+    CHECK(lpuart_up);
+    lpuart_up = false;
+}
+
+lpuart_rx_callback_t LPUART_DRV_InstallRxCallback(uint32_t instance, lpuart_rx_callback_t function,
+                                                   uint8_t *rxBuff, void *callbackParam, bool alwaysEnableRxIrq)
+{
+    (void)instance; (void)function; (void)rxBuff; (void)callbackParam; (void)alwaysEnableRxIrq;
+    return NULL;
+}
+
+//a fresh boot: nothing up
+static void reset(void)
+{
+    periph_up = 0;
+    asserts = 0;
+    core_inits = 0;
+    i2c_up = false;
+    lpuart_up = false;
+    flash_inits = 0;
+    spi_inits = 0;
+}
+
+static void test_update(void)
+{
+    //BOOT_CheckFlag with a flag set: the modem first, the rest as needed
+    reset();
+    PERIPH_init(PERIPH_UBLOX);
+    PERIPH_init(PERIPH_FLASH);
+    PERIPH_init(PERIPH_EZPORT);
+    PERIPH_init(PERIPH_EZPORT);
+    CHECK_EQ(core_inits, 1);
+    CHECK_EQ(flash_inits, 1);
+    CHECK_EQ(spi_inits, 1);
+    CHECK(lpuart_up);
+    CHECK(!i2c_up);
+    CHECK_EQ(asserts, 0);
+}
+
+static void test_command_loop(void)
+{
+    //main.c, the factory session and then i2cCom1_Task
+    reset();
+    PERIPH_init(PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT);
+    PERIPH_init(PERIPH_UBLOX);
+    PERIPH_deinit(PERIPH_UBLOX);
+    PERIPH_init(PERIPH_I2C);
+    CHECK_EQ(core_inits, 1);
+    CHECK(!lpuart_up);
+    CHECK(i2c_up);
+    CHECK_EQ(periph_up, PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT | PERIPH_I2C);
+    CHECK_EQ(asserts, 0);
+
+    //without the factory session the hand-over has nothing to take down
+    reset();
+    PERIPH_init(PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT);
+    PERIPH_deinit(PERIPH_UBLOX);
+    PERIPH_init(PERIPH_I2C);
+    CHECK(!lpuart_up);
+    CHECK(i2c_up);
+    CHECK_EQ(asserts, 0);
+}
+
+static void test_overlap(void)
+{
+    //either way round, one arena's writers coming up beside the other's
+    reset();
+    PERIPH_init(PERIPH_UBLOX);
+    PERIPH_init(PERIPH_I2C);
+    CHECK_EQ(asserts, 1);
+
+    reset();
+    PERIPH_init(PERIPH_I2C);
+    PERIPH_init(PERIPH_UBLOX | PERIPH_FLASH);
+    CHECK_EQ(asserts, 1);
+
+    reset();
+    PERIPH_init(PERIPH_UBLOX | PERIPH_I2C);
+    CHECK_EQ(asserts, 1);
+
+    //units outside the arenas don't count
+    CHECK(!ARENA_OVERLAP(PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT | PERIPH_UBLOX));
+    CHECK(!ARENA_OVERLAP(PERIPH_CORE | PERIPH_FLASH | PERIPH_EZPORT | PERIPH_I2C));
+}
+
+int main(void)
+{
+    test_update();
+    test_command_loop();
+    test_overlap();
+    return CHECK_DONE("periph");
+}
@@ -0,0 +1,263 @@
+/*
+  test_ready.c - modem readiness detection against the emulator
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <stdlib.h>
+
+#include "check.h"
+#include "board.h"
+#include "modem.h"
+#include "flash1.h"
+
+#include "../Sources/boot.c"
+
+#define SAMPLES         (50)
+#define BOOT_MAX_MS     (8000)      //modem power on to answering, drawn uniformly
+#define LATENCY_US      (5000)
+#define BANNER          "\r\nSTARTUP\r\n"
+//ATE0, AT+IFC and the read once the modem answers
+#define EXCHANGE_NS     ((3 * LATENCY_US + 10000) * BOARD_US)
+
+static uint32_t periph_up;
+
+void lpuartUblox_RxCallback(uint32_t instance, void *lpuartState)
+{
+    lpuart_state_t *ptr = (lpuart_state_t *)lpuartState;
+    (void)instance;
+    RING_push(&ublox_ring, *(ptr->rxBuff));
+}
+
+void PERIPH_init(uint32_t units)
+{
+    if((units & PERIPH_UBLOX) && !(periph_up & PERIPH_UBLOX))
+    {
+        LPUART_DRV_Init(FSL_LPUARTUBLOX, &lpuartUblox_State, &lpuartUblox_InitConfig0);
+        LPUART_DRV_InstallRxCallback(FSL_LPUARTUBLOX, lpuartUblox_RxCallback, ublox_rx, NULL, true);
+    }
+    periph_up |= units;
+}
+
+void PERIPH_deinit(uint32_t units)
+{
+    periph_up &= ~units;
+}
+
+void NVIC_SystemReset(void) { CHECK(false); }
+static uint8_t image[64];
+
+static const mock_modem_file_t files[] = {
+    { "system.bin", image, sizeof(image) },
+    { NULL },
+};
+
+static void setup(const mock_modem_config_t *modem)
+{
+    board_reset();
+    mock_gpio_reset();
+    mock_lpuart_reset();
+    mock_flash_reset();
+    mock_spi_reset();
+    mock_modem_init(modem);
+
+    periph_up = 0;
+    RING_flush(&ublox_ring);
+    ublox_ring.throttled = false;
+    memset(&ublox_stats, 0, sizeof(ublox_stats));
+    ublox_stats.read_size = UBLOX_READ_SIZE;
+    ublox_flow = 0;
+    ublox_flow_out = false;
+}
+
+//the wake-up BOOT_CheckFlag ran before BOOT_ublox_wait_ready, for comparison
+static void baseline_wait_ready(void)
+{
+    uint32_t retry = 3;
+
+    PERIPH_init(PERIPH_UBLOX);
+    for(;;)
+    {
+        RING_flush(&ublox_ring);
+        LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, (const uint8_t *)"ATE0\r", 5, 1000);
+        if(RING_find_string(&ublox_ring, "OK", 10000))
+            break;
+        LPUART_DRV_SendDataBlocking(FSL_LPUARTUBLOX, (const uint8_t *)"\x11", 1, 1000);
+        if(--retry == 0)
+        {
+            retry = 3;
+            BOOT_ublox_reset();
+            OSA_TimeDelay(3000);
+        }
+        OSA_TimeDelay(1000);
+    }
+}
+
+typedef struct
+{
+    const char *name;
+    void (*wait_ready)(void);
+}detector_t;
+
+static const detector_t detectors[] = {
+    { "probe", BOOT_ublox_wait_ready },
+    { "baseline", baseline_wait_ready },
+};
+
+//power on both ends at once, wait for the modem and read the first block;
+//returns the time to its first payload byte
+static uint64_t first_byte(const detector_t *detector, const mock_modem_config_t *modem)
+{
+    uint8_t buffer[sizeof(image)];
+
+    setup(modem);
+    detector->wait_ready();
+    CHECK_EQ(BOOT_ReadFromUblox("system.bin", 0, buffer, sizeof(buffer)), sizeof(buffer));
+    CHECK_MEM(buffer, image, sizeof(buffer));
+    CHECK(mock_modem_stats.first_data_ns > mock_modem_stats.ready_ns);
+    return mock_modem_stats.first_data_ns;
+}
+
+static const mock_modem_config_t quiet = {
+    .latency_us = LATENCY_US,
+    .files = files,
+};
+
+//a modem that is already up answers the first probe
+static void test_up(void)
+{
+    CHECK(first_byte(&detectors[0], &quiet) < EXCHANGE_NS);
+    CHECK_EQ(ublox_stats.probes, 0);
+    CHECK_EQ(ublox_stats.resets, 0);
+    CHECK_EQ(mock_modem_stats.commands, 3);
+}
+
+//probes back off from UBLOX_PROBE_MIN_MS to UBLOX_PROBE_MAX_MS while it
+//boots, so the one answered lands within the longest probe of it coming up
+static void test_backoff(void)
+{
+    mock_modem_config_t modem = quiet;
+
+    modem.boot_ms = 5000;
+    first_byte(&detectors[0], &modem);
+    CHECK(mock_modem_stats.first_data_ns - mock_modem_stats.ready_ns < UBLOX_PROBE_MAX_MS * BOARD_MS + EXCHANGE_NS);
+    //50 + 100 + ... + 800 is 1550 ms, then 800 ms a probe
+    CHECK_EQ(ublox_stats.probes, 5 + (5000 - 1550 + 799) / 800);
+    CHECK_EQ(ublox_stats.resets, 0);
+}
+
+//startup output cuts the probe in flight short and restarts the schedule
+static void test_banner(void)
+{
+    mock_modem_config_t modem = quiet;
+
+    modem.boot_ms = 5000;
+    modem.banner = BANNER;
+    first_byte(&detectors[0], &modem);
+    CHECK(mock_modem_stats.first_data_ns - mock_modem_stats.ready_ns < UBLOX_PROBE_MIN_MS * BOARD_MS + 2 * EXCHANGE_NS);
+    CHECK_EQ(ublox_stats.probes, 5 + (5000 - 1550 + 799) / 800);
+    CHECK_EQ(ublox_stats.resets, 0);
+}
+
+//one that never comes up is reset after UBLOX_RESET_AFTER_MS, once
+static void test_wedged(void)
+{
+    mock_modem_config_t modem = quiet;
+
+    modem.boot_ms = 3000;
+    modem.wedged = true;
+    uint64_t ns = first_byte(&detectors[0], &modem);
+    CHECK_EQ(ublox_stats.resets, 1);
+    CHECK_EQ(mock_modem_stats.resets, 1);
+    CHECK(ns > (UBLOX_RESET_AFTER_MS + 3000) * BOARD_MS);
+    //the reset waits for the probe in flight, the first answer for another
+    CHECK(ns < (UBLOX_RESET_AFTER_MS + 2 * UBLOX_PROBE_MAX_MS + 3000) * BOARD_MS + EXCHANGE_NS);
+    CHECK(ublox_stats.ready_ms >= UBLOX_RESET_AFTER_MS + 3000);
+}
+
+static int compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const uint64_t *sorted, uint32_t p)
+{
+    return sorted[(SAMPLES - 1) * p / 100] / 1e6;
+}
+
+//time to the first image byte over modem boot times drawn uniformly up
+//to BOOT_MAX_MS, with and without startup output; the wait is the part
+//after the modem could have answered
+static void bench(void)
+{
+    static uint64_t ttfb[2][SAMPLES];
+    static uint64_t wait[2][SAMPLES];
+    const char *banners[] = { NULL, BANNER };
+
+    printf("ready        %-8s %-7s %8s %8s %8s   %8s %8s %8s\n", "detector", "output",
+           "ttfb p50", "p90", "max", "wait p50", "p90", "max");
+    for(uint32_t banner = 0; banner < 2; banner++)
+    {
+        for(uint32_t d = 0; d < 2; d++)
+        {
+            uint32_t seed = 0x9E3779B9;
+
+            for(uint32_t i = 0; i < SAMPLES; i++)
+            {
+                mock_modem_config_t modem = quiet;
+
+                seed = seed * 1103515245 + 12345;
+                modem.boot_ms = (seed >> 8) % BOOT_MAX_MS;
+                modem.banner = banners[banner];
+                ttfb[d][i] = first_byte(&detectors[d], &modem);
+                wait[d][i] = ttfb[d][i] - mock_modem_stats.ready_ns;
+            }
+            qsort(ttfb[d], SAMPLES, sizeof(ttfb[d][0]), compare);
+            qsort(wait[d], SAMPLES, sizeof(wait[d][0]), compare);
+            printf("ready        %-8s %-7s %8.0f %8.0f %8.0f   %8.0f %8.0f %8.0f\n", detectors[d].name,
+                   banner ? "banner" : "none", percentile(ttfb[d], 50), percentile(ttfb[d], 90),
+                   percentile(ttfb[d], 100), percentile(wait[d], 50), percentile(wait[d], 90),
+                   percentile(wait[d], 100));
+        }
+
+        //the probes never leave a modem waiting longer than the longest of
+        //them, or the shortest once it speaks up, while the old loop's
+        //typical wait was longer than that
+        if(banner)
+            CHECK(wait[0][SAMPLES - 1] < UBLOX_PROBE_MIN_MS * BOARD_MS + 2 * EXCHANGE_NS);
+        else
+            CHECK(wait[0][SAMPLES - 1] < UBLOX_PROBE_MAX_MS * BOARD_MS + EXCHANGE_NS);
+        CHECK(wait[1][SAMPLES / 2] > wait[0][SAMPLES - 1]);
+        CHECK(ttfb[0][SAMPLES / 2] < ttfb[1][SAMPLES / 2]);
+    }
+}
+
+int main(void)
+{
+    for(uint32_t i = 0; i < sizeof(image); i++)
+        image[i] = 'a' + i % 26;
+    test_up();
+    test_backoff();
+    test_banner();
+    test_wedged();
+    bench();
+    return CHECK_DONE("ready");
+}
@@ -0,0 +1,292 @@
+/*
+  test_ring.c - ring buffer and flow control watermarks
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "Cpu.h"
+#include "ring.h"
+#include "check.h"
+
+#define SIZE    (64)
+#define HIGH    (48)
+#define LOW     (16)
+
+static uint8_t storage[SIZE];
+static uint32_t msec;
+static uint32_t xoffs;
+static uint32_t xons;
+static uint32_t xons_masked;
+
+//each read moves the clock on, so the timeouts run out
+uint32_t OSA_TimeGetMsec(void)
+{
+    return msec++;
+}
+
+static void throttle(bool stop)
+{
+    if(stop)
+        xoffs++;
+    else
+    {
+        xons++;
+        if(mock_primask)
+            xons_masked++;
+    }
+}
+
+static void setup(ring_t *ring, uint32_t high, uint32_t low)
+{
+    uint8_t *buffer = storage;
+
+    RING_init(ring, &buffer, sizeof(storage));
+    ring->high = high;
+    ring->low = low;
+    ring->throttle = throttle;
+    xoffs = 0;
+    xons = 0;
+    xons_masked = 0;
+}
+
+//XOFF once on reaching high, XON once on draining to low
+static void test_watermarks(void)
+{
+    ring_t ring;
+
+    setup(&ring, HIGH, LOW);
+    for(uint32_t i = 0; i < HIGH - 1; i++)
+        CHECK(RING_push(&ring, (uint8_t)i));
+    CHECK_EQ(xoffs, 0);
+    CHECK(!ring.throttled);
+
+    CHECK(RING_push(&ring, HIGH - 1));
+    CHECK_EQ(xoffs, 1);
+    CHECK_EQ(ring.stalls, 1);
+    CHECK(ring.throttled);
+
+    //bytes in flight after XOFF still land, without another XOFF
+    for(uint32_t i = HIGH; i < SIZE - 1; i++)
+        CHECK(RING_push(&ring, (uint8_t)i));
+    CHECK_EQ(xoffs, 1);
+
+    //draining through high doesn't release, only reaching low does
+    while(RING_available(&ring) > LOW + 1)
+        RING_pop(&ring);
+    CHECK_EQ(xons, 0);
+    CHECK(ring.throttled);
+    CHECK_EQ(RING_pop(&ring), SIZE - 1 - LOW - 1);
+    CHECK_EQ(xons, 1);
+    CHECK(!ring.throttled);
+
+    while(RING_pop(&ring) >= 0)
+        ;
+    CHECK_EQ(xons, 1);
+
+    //and again on the next burst
+    for(uint32_t i = 0; i < HIGH; i++)
+        RING_push(&ring, (uint8_t)i);
+    CHECK_EQ(xoffs, 2);
+    CHECK_EQ(ring.stalls, 2);
+}
+
+//high 0 leaves the sender alone
+static void test_no_watermark(void)
+{
+    ring_t ring;
+
+    setup(&ring, 0, 0);
+    ring.throttle = NULL;
+    for(uint32_t i = 0; i < SIZE - 1; i++)
+        CHECK(RING_push(&ring, (uint8_t)i));
+    CHECK_EQ(ring.stalls, 0);
+    CHECK(!ring.throttled);
+    CHECK(RING_isFull(&ring));
+    RING_flush(&ring);
+    CHECK_EQ(RING_available(&ring), 0);
+}
+
+//a full ring drops and counts, and keeps what it had
+static void test_overrun(void)
+{
+    ring_t ring;
+
+    setup(&ring, HIGH, LOW);
+    for(uint32_t i = 0; i < SIZE - 1; i++)
+        CHECK(RING_push(&ring, (uint8_t)i));
+    CHECK(RING_isFull(&ring));
+    CHECK(!RING_push(&ring, 0xAA));
+    CHECK(!RING_push(&ring, 0xBB));
+    CHECK_EQ(ring.overruns, 2);
+    CHECK_EQ(ring.received, SIZE + 1);
+    CHECK_EQ(RING_available(&ring), SIZE - 1);
+    for(uint32_t i = 0; i < SIZE - 1; i++)
+        CHECK_EQ(RING_pop(&ring), i);
+    CHECK_EQ(RING_pop(&ring), -1);
+}
+
+//RING_flush before a new command lets a throttled modem talk again
+static void test_flush_releases(void)
+{
+    ring_t ring;
+
+    setup(&ring, HIGH, LOW);
+    for(uint32_t i = 0; i < HIGH; i++)
+        RING_push(&ring, (uint8_t)i);
+    CHECK(ring.throttled);
+    RING_flush(&ring);
+    CHECK_EQ(xons, 1);
+    CHECK(!ring.throttled);
+    CHECK_EQ(RING_available(&ring), 0);
+
+    //the receive count outlives the flush, so a reader that drained the
+    //ring can still tell something arrived
+    CHECK_EQ(ring.received, HIGH);
+}
+
+//the release decision and XON are made with the receive interrupt held
+//off, and the caller's mask is put back as it was
+static void test_release_masked(void)
+{
+    ring_t ring;
+
+    setup(&ring, HIGH, LOW);
+    for(uint32_t i = 0; i < HIGH; i++)
+        RING_push(&ring, (uint8_t)i);
+    mock_primask = 0;
+    while(RING_available(&ring) > LOW)
+        RING_pop(&ring);
+    CHECK_EQ(xons, 1);
+    CHECK_EQ(xons_masked, 1);
+    CHECK_EQ(mock_primask, 0);
+
+    for(uint32_t i = 0; i < HIGH; i++)
+        RING_push(&ring, (uint8_t)i);
+    mock_primask = 1;
+    RING_flush(&ring);
+    CHECK_EQ(xons, 2);
+    CHECK_EQ(xons_masked, 2);
+    CHECK_EQ(mock_primask, 1);
+    mock_primask = 0;
+}
+
+//counts and order survive the indices wrapping
+static void test_wrap(void)
+{
+    ring_t ring;
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+
+    setup(&ring, HIGH, LOW);
+    for(uint32_t round = 0; round < 50; round++)
+    {
+        uint32_t in = (round * 7) % 40 + 1;
+        uint32_t out = (round * 5) % 40 + 1;
+
+        for(uint32_t i = 0; i < in; i++)
+        {
+            if(RING_push(&ring, (uint8_t)next_in))
+                next_in++;
+        }
+        CHECK_EQ(RING_available(&ring), next_in - next_out);
+        for(uint32_t i = 0; i < out && RING_available(&ring); i++)
+            CHECK_EQ(RING_pop(&ring), (uint8_t)next_out++);
+    }
+    CHECK_EQ(xoffs, ring.stalls);
+    CHECK_EQ(xons + ring.throttled, xoffs);
+}
+
+//the URDBLOCK reply parsing on top of the ring
+static void test_get(void)
+{
+    const char *reply = "\r\n+URDBLOCK: \"f\",4,\"ab\"c\"\r\n\r\nOK\r\n";
+    char field[16];
+    char payload[4];
+    ring_t ring;
+
+    setup(&ring, 0, 0);
+    for(const char *p = reply; *p; p++)
+        RING_push(&ring, *p);
+
+    CHECK(RING_find_string(&ring, "+URDBLOCK: \"", 100));
+    CHECK(RING_get_until(&ring, NULL, 0, ',', 100));
+    memset(field, 0x55, sizeof(field));
+    CHECK(RING_get_until(&ring, field, sizeof(field), ',', 100));
+    CHECK(strcmp(field, "4") == 0);
+    CHECK_EQ(RING_get(&ring, field, 1, 100), 1);
+    CHECK_EQ(RING_get(&ring, payload, 4, 100), 4);
+    CHECK(memcmp(payload, "ab\"c", 4) == 0);
+    CHECK_EQ(RING_get(&ring, field, 1, 100), 1);
+    CHECK_EQ(field[0], '"');
+    //the first \r\n ends the information text, a false start to skip
+    CHECK(RING_find_string(&ring, "\r\nOK\r\n", 100));
+    CHECK_EQ(RING_available(&ring), 0);
+
+    //nothing more arrives: each gives up on its timeout
+    CHECK(!RING_find_string(&ring, "OK", 10));
+    CHECK(!RING_get_until(&ring, NULL, 0, ',', 10));
+    CHECK_EQ(RING_get(&ring, payload, 4, 10), 0);
+}
+
+//a field longer than the buffer is consumed and fails, without writing
+//past the buffer, and what was kept is terminated
+static void test_get_until_bound(void)
+{
+    const char *reply = "123456789,7,";
+    struct
+    {
+        char field[5];
+        char guard[4];
+    }b;
+    ring_t ring;
+
+    setup(&ring, 0, 0);
+    for(const char *p = reply; *p; p++)
+        RING_push(&ring, *p);
+
+    memset(&b, 0x55, sizeof(b));
+    CHECK(!RING_get_until(&ring, b.field, sizeof(b.field), ',', 100));
+    CHECK(strcmp(b.field, "1234") == 0);
+    CHECK_MEM(b.guard, "\x55\x55\x55\x55", sizeof(b.guard));
+
+    //the next field starts clean after the delimiter
+    memset(&b, 0x55, sizeof(b));
+    CHECK(RING_get_until(&ring, b.field, sizeof(b.field), ',', 100));
+    CHECK(strcmp(b.field, "7") == 0);
+
+    //an empty field is an empty string
+    RING_push(&ring, ',');
+    CHECK(RING_get_until(&ring, b.field, sizeof(b.field), ',', 100));
+    CHECK_EQ(b.field[0], 0);
+}
+
+int main(void)
+{
+    test_watermarks();
+    test_no_watermark();
+    test_overrun();
+    test_flush_releases();
+    test_release_masked();
+    test_wrap();
+    test_get();
+    test_get_until_bound();
+    return CHECK_DONE("ring");
+}
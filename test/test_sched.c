@@ -0,0 +1,297 @@
+/*
+  test_sched.c - scheduler against the simulated SysTick
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <setjmp.h>
+
+#include "sched.h"
+#include "osa_timer.h"
+#include "check.h"
+
+#define PERIOD          (48000U)    //core cycles per ms at 48 MHz
+#define EVENT_IRQ       (0x01)
+#define EVENT_OTHER     (0x02)
+
+void OSA_TimeInit(void);
+
+//SCHED_run doesn't return: a task of its own leaves it at the end of a test
+static sched_task_t stop_task;
+static jmp_buf stop;
+
+//one interrupt source besides the tick: due at a core cycle count, it
+//wakes the WFI and is taken there, with PRIMASK as the idle loop left it
+static sched_task_t *irq_task;
+static uint64_t irq_at;
+static uint32_t irq_primask;        //PRIMASK after the ISR's SCHED_post
+static uint32_t wfis;
+
+static void wfi(void)
+{
+    //OSA_TimeIdle writes VAL before the WFI, which clears COUNTFLAG on the part
+    mock_systick_regs.CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+    wfis++;
+    while(!(mock_scb_regs.ICSR & SCB_ICSR_PENDSTSET_Msk))
+    {
+        if(irq_task && mock_systick_cycles >= irq_at)
+        {
+            SCHED_post(irq_task, EVENT_IRQ);
+            irq_primask = mock_primask;
+            irq_task = NULL;
+            return;
+        }
+        mock_systick_run(1);
+    }
+}
+
+static void stop_fn(sched_task_t *task, uint32_t events)
+{
+    (void)task;
+    (void)events;
+    longjmp(stop, 1);
+}
+
+static void reset(void)
+{
+    memset(&sched, 0, sizeof(sched));
+    mock_primask = 0;
+    mock_systick_step = 1;
+    mock_wfi = wfi;
+    OSA_TimeInit();
+    mock_scb_regs.ICSR = 0;
+    mock_systick_cycles = 0;
+    irq_task = NULL;
+    wfis = 0;
+}
+
+//runs the scheduler for ms from now, with the stop task added last
+static void run(uint32_t ms)
+{
+    SCHED_add(&stop_task, stop_fn);
+    SCHED_sleep(&stop_task, ms);
+    if(!setjmp(stop))
+        SCHED_run();
+}
+
+//each call of a recording task: when, and what it was given
+typedef struct
+{
+    sched_task_t task;
+    uint32_t calls;
+    uint32_t ms[8];
+    uint32_t events[8];
+}record_t;
+
+static void record(sched_task_t *task, uint32_t events)
+{
+    record_t *r = (record_t *)task;
+
+    if(r->calls < 8)
+    {
+        r->ms[r->calls] = OSA_TimeGetMsec();
+        r->events[r->calls] = events;
+    }
+    r->calls++;
+}
+
+static void test_post(void)
+{
+    //from an interrupt or a critical section PRIMASK must stay as it was
+    static record_t a;
+
+    reset();
+    memset(&a, 0, sizeof(a));
+    SCHED_add(&a.task, record);
+    mock_primask = 1;
+    SCHED_post(&a.task, EVENT_IRQ);
+    CHECK_EQ(mock_primask, 1);
+    mock_primask = 0;
+    SCHED_post(&a.task, EVENT_OTHER);
+    CHECK_EQ(mock_primask, 0);
+    CHECK_EQ(a.task.events, EVENT_IRQ | EVENT_OTHER);
+}
+
+static void test_events(void)
+{
+    //posts before a run are delivered together, once, to each task
+    static record_t a, b;
+    uint32_t start;
+
+    reset();
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    start = OSA_TimeGetMsec();
+    SCHED_add(&a.task, record);
+    SCHED_add(&b.task, record);
+    SCHED_post(&a.task, EVENT_IRQ);
+    SCHED_post(&b.task, EVENT_OTHER);
+    SCHED_post(&a.task, EVENT_OTHER);
+    run(5);
+    CHECK_EQ(a.calls, 1);
+    CHECK_EQ(a.events[0], EVENT_IRQ | EVENT_OTHER);
+    CHECK_EQ(b.calls, 1);
+    CHECK_EQ(b.events[0], EVENT_OTHER);
+    CHECK_EQ(a.task.runs, 1);
+    CHECK_EQ(OSA_TimeGetMsec() - start, 5);
+}
+
+static uint32_t woke[5];
+static uint32_t wakes;
+
+static void sleeper(sched_task_t *task, uint32_t events)
+{
+    (void)events;
+    PT_BEGIN(task);
+    for(wakes = 0; wakes < 5; wakes++)
+    {
+        PT_SLEEP(task, 10);
+        woke[wakes] = OSA_TimeGetMsec();
+    }
+    PT_END(task);
+}
+
+static void test_sleep(void)
+{
+    //a protothread sleeping 10 ms at a time wakes on each deadline, and
+    //the stretched tick keeps the core asleep in between
+    static sched_task_t task;
+    uint32_t start;
+
+    reset();
+    start = OSA_TimeGetMsec();
+    SCHED_add(&task, sleeper);
+    SCHED_post(&task, EVENT_OTHER);
+    run(55);
+    CHECK_EQ(wakes, 5);
+    for(uint32_t i = 0; i < 5; i++)
+        CHECK_EQ(woke[i] - start, 10 * (i + 1));
+    CHECK_EQ(task.lc, 0);
+    CHECK(sched.sleeps >= 6);
+    CHECK(wfis <= 12);
+}
+
+static void test_held(void)
+{
+    //an interrupt wakes the idle loop early; what it posts to a sleeping
+    //task waits for the timer, and comes on the run after it
+    static record_t a;
+    uint32_t start;
+
+    reset();
+    memset(&a, 0, sizeof(a));
+    start = OSA_TimeGetMsec();
+    SCHED_add(&a.task, record);
+    SCHED_sleep(&a.task, 10);
+    irq_task = &a.task;
+    irq_at = 2 * PERIOD + PERIOD / 2;
+    irq_primask = 0;
+    run(15);
+    CHECK(irq_task == NULL);
+    CHECK_EQ(irq_primask, 1);
+    CHECK_EQ(a.calls, 2);
+    CHECK_EQ(a.ms[0] - start, 10);
+    CHECK_EQ(a.events[0], SCHED_TIMER);
+    CHECK_EQ(a.ms[1] - start, 10);
+    CHECK_EQ(a.events[1], EVENT_IRQ);
+    CHECK_EQ(OSA_TimeGetMsec() - start, 15);
+}
+
+//periodic load: work ms of core time every period ms, on absolute deadlines
+typedef struct
+{
+    sched_task_t task;
+    const char *name;
+    uint32_t period;
+    uint32_t work;
+    uint32_t next;
+    uint32_t late_max;
+}periodic_t;
+
+static void periodic(sched_task_t *task, uint32_t events)
+{
+    periodic_t *p = (periodic_t *)task;
+    uint32_t late = OSA_TimeGetMsec() - p->next;
+
+    (void)events;
+    if(late > p->late_max)
+        p->late_max = late;
+    //in steps, as the mock takes at most one tick per call
+    for(uint32_t i = 0; i < p->work * 4; i++)
+        mock_systick_run(PERIOD / 4);
+    p->next += p->period;
+    SCHED_wake(task, p->next);
+}
+
+static void test_utilization(void)
+{
+    //two loads sharing the core for a second: the per task counters add
+    //up to the time that passed, and a long task only delays a short one
+    //by its own length
+    static periodic_t a = { .name = "10ms/2ms", .period = 10, .work = 2 };
+    static periodic_t b = { .name = "25ms/5ms", .period = 25, .work = 5 };
+    static periodic_t *load[] = { &a, &b };
+    uint64_t total;
+    uint64_t busy = 0;
+
+    reset();
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        periodic_t *p = load[i];
+
+        SCHED_add(&p->task, periodic);
+        p->next = OSA_TimeGetMsec() + p->period;
+        p->late_max = 0;
+        SCHED_wake(&p->task, p->next);
+    }
+    run(1000);
+    total = mock_systick_cycles;
+
+    printf("sched        %-9s %5s %8s\n", "task", "runs", "busy");
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        periodic_t *p = load[i];
+
+        printf("sched        %-9s %5" PRIu32 " %7.2f%%  late <= %" PRIu32 " ms\n", p->name,
+               p->task.runs, 100.0 * p->task.busy_cycles / total, p->late_max);
+        busy += p->task.busy_cycles;
+        CHECK_EQ(p->task.runs, 1000 / p->period);
+        CHECK(p->task.busy_cycles >= p->task.runs * p->work * PERIOD);
+        CHECK(p->task.busy_cycles - p->task.runs * p->work * PERIOD < p->task.runs * 16);
+        CHECK(p->late_max <= b.work);
+    }
+    printf("sched        %-9s %5" PRIu32 " %7.2f%%  (runs: sleeps)\n", "idle",
+           sched.sleeps, 100.0 * sched.idle_cycles / total);
+    printf("sched        %-9s %5s %7.2f%%\n", "overhead", "",
+           100.0 * (total - busy - sched.idle_cycles) / total);
+
+    //all but the scheduler's own scans are accounted for
+    CHECK(busy + sched.idle_cycles <= total);
+    CHECK(total - busy - sched.idle_cycles < total / 1000);
+}
+
+int main(void)
+{
+    test_post();
+    test_events();
+    test_sleep();
+    test_held();
+    test_utilization();
+    return CHECK_DONE("sched");
+}
@@ -0,0 +1,115 @@
+/*
+  test_sha256.c - SHA-256 known answers
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "sha256.h"
+#include "check.h"
+
+static void digest(const void *data, uint32_t size, uint8_t *out)
+{
+    sha256_t ctx;
+
+    SHA256_init(&ctx);
+    SHA256_update(&ctx, data, size);
+    SHA256_final(&ctx, out);
+}
+
+static void check_digest(const char *message, const char *expected)
+{
+    uint8_t out[SHA256_DIGEST_SIZE];
+    uint8_t want[SHA256_DIGEST_SIZE];
+
+    digest(message, strlen(message), out);
+    unhex(expected, want);
+    CHECK_MEM(out, want, sizeof(want));
+}
+
+//FIPS 180-2 appendix B
+static void test_fips(void)
+{
+    check_digest("abc",
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    check_digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    check_digest("",
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+}
+
+static void test_million(void)
+{
+    uint8_t chunk[1000];
+    uint8_t out[SHA256_DIGEST_SIZE];
+    uint8_t want[SHA256_DIGEST_SIZE];
+    sha256_t ctx;
+
+    memset(chunk, 'a', sizeof(chunk));
+    SHA256_init(&ctx);
+    for(int i = 0; i < 1000; i++)
+        SHA256_update(&ctx, chunk, sizeof(chunk));
+    SHA256_final(&ctx, out);
+    unhex("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", want);
+    CHECK_MEM(out, want, sizeof(want));
+}
+
+//the download hashes URDBLOCK chunks of any size: every split of the
+//input, across the padding boundaries at 55/56 and 64 bytes, must agree
+static void test_streaming(void)
+{
+    uint8_t data[200];
+    uint8_t whole[SHA256_DIGEST_SIZE];
+    uint8_t split[SHA256_DIGEST_SIZE];
+    uint32_t sizes[] = {0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 200};
+    sha256_t ctx;
+
+    for(uint32_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 7 + 3);
+
+    for(uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        uint32_t size = sizes[s];
+
+        digest(data, size, whole);
+        for(uint32_t cut = 0; cut <= size; cut++)
+        {
+            SHA256_init(&ctx);
+            SHA256_update(&ctx, data, cut);
+            SHA256_update(&ctx, data + cut, size - cut);
+            SHA256_final(&ctx, split);
+            CHECK_MEM(split, whole, sizeof(whole));
+        }
+
+        SHA256_init(&ctx);
+        for(uint32_t i = 0; i < size; i++)
+            SHA256_update(&ctx, &data[i], 1);
+        SHA256_final(&ctx, split);
+        CHECK_MEM(split, whole, sizeof(whole));
+    }
+}
+
+int main(void)
+{
+    test_fips();
+    test_million();
+    test_streaming();
+    return CHECK_DONE("sha256");
+}
@@ -0,0 +1,332 @@
+/*
+  test_stage.c - program unit coalescing against simulated flash
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "stage.h"
+#include "flash.h"
+#include "ext_flash.h"
+#include "perf.h"
+#include "check.h"
+
+#define INTERNAL_SIZE   (0x40000)
+#define EXT_SIZE        (0x20000)
+
+//NOR flash: erase sets a whole sector to 0xFF, program only clears bits,
+//must stay inside one page and cover whole program units (longwords on
+//FTFA, phrases on the user module over EZPort)
+typedef struct
+{
+    uint8_t *array;
+    uint32_t size;
+    uint32_t erase_size;
+    uint32_t unit_size;
+    uint32_t write_size;
+    uint32_t erases;
+    uint32_t programs;
+    uint32_t violations;    //unaligned, partial, straddling or over unerased bytes
+    bool     fail;          //next commands report failure
+}flash_sim_t;
+
+static uint8_t internal_array[INTERNAL_SIZE];
+static uint8_t ext_array[EXT_SIZE];
+static uint8_t user_array[EXT_SIZE];
+static flash_sim_t internal = {internal_array, INTERNAL_SIZE, FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE, FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE, PGM_SIZE_BYTE};
+static flash_sim_t ext = {ext_array, EXT_SIZE, EXT_SECTOR_SIZE, EXT_PAGE_SIZE, 1};
+static flash_sim_t user = {user_array, EXT_SIZE, EXT_SECTOR_SIZE, EXT_PAGE_SIZE, EXT_EZPORT_WRITE_SIZE};
+
+#define EXT_USER        (0)     //any SPI instance but EXT_STAGING is the EZPort
+
+static void sim_reset(flash_sim_t *sim)
+{
+    memset(sim->array, 0x00, sim->size);
+    sim->erases = 0;
+    sim->programs = 0;
+    sim->violations = 0;
+    sim->fail = false;
+}
+
+static void sim_erase(flash_sim_t *sim, uint32_t address)
+{
+    if(address % sim->erase_size || address >= sim->size)
+    {
+        sim->violations++;
+        return;
+    }
+    memset(&sim->array[address], 0xFF, sim->erase_size);
+    sim->erases++;
+}
+
+static void sim_program(flash_sim_t *sim, uint32_t address, const uint8_t *data, uint32_t size)
+{
+    uint32_t unit = address & ~(sim->unit_size - 1);
+
+    if(address + size > unit + sim->unit_size || address + size > sim->size ||
+            address % sim->write_size || size % sim->write_size)
+    {
+        sim->violations++;
+        return;
+    }
+    for(uint32_t i = 0; i < size; i++)
+    {
+        if(sim->array[address + i] != 0xFF && data[i] != 0xFF)
+            sim->violations++;
+        sim->array[address + i] &= data[i];
+    }
+    sim->programs++;
+}
+
+bool FLASH_erase_sector(uint32_t sector_address)
+{
+    sim_erase(&internal, sector_address);
+    return !internal.fail;
+}
+
+bool FLASH_write_block(uint32_t address, uint8_t *block, uint32_t size)
+{
+    sim_program(&internal, address, block, size);
+    return !internal.fail;
+}
+
+void EXT_erase_sector(uint32_t instance, uint32_t address)
+{
+    sim_erase(instance == EXT_STAGING ? &ext : &user, address);
+}
+
+void EXT_write_block(uint32_t instance, uint32_t address, uint8_t* buffer, uint32_t count)
+{
+    sim_program(instance == EXT_STAGING ? &ext : &user, address, buffer, count);
+}
+
+uint32_t PERF_start(void)
+{
+    return 0;
+}
+
+void PERF_stop(perf_timer_t id, uint32_t start)
+{
+    (void)id;
+    (void)start;
+}
+
+static uint8_t image[0x3000];
+
+static void fill_image(uint32_t seed)
+{
+    for(uint32_t i = 0; i < sizeof(image); i++)
+        image[i] = (uint8_t)(i * 31 + seed + (i >> 8));
+}
+
+//stream size bytes of image to address in chunk sized writes, the way the
+//URDBLOCK and HTTP loops do
+static bool stream(stage_t *stage, uint32_t address, uint32_t size, uint32_t chunk)
+{
+    bool ok = true;
+
+    for(uint32_t pos = 0; pos < size; pos += chunk)
+    {
+        uint32_t len = size - pos < chunk ? size - pos : chunk;
+        ok &= STAGE_write(stage, address + pos, &image[pos], len);
+    }
+    return ok;
+}
+
+static bool erased(const uint8_t *p, uint32_t size)
+{
+    while(size--)
+    {
+        if(*p++ != 0xFF)
+            return false;
+    }
+    return true;
+}
+
+//one erase and one program per sector however the chunks fall
+static void test_internal(void)
+{
+    uint32_t chunks[] = {32, 7, 100, 512, 1024, 3000};
+    stage_t stage;
+
+    for(uint32_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+    {
+        sim_reset(&internal);
+        fill_image(c);
+        STAGE_init(&stage, STAGE_INTERNAL);
+        CHECK(stream(&stage, 0x6000, 0x2000, chunks[c]));
+        CHECK(STAGE_flush(&stage));
+
+        CHECK_EQ(internal.erases, 8);
+        CHECK_EQ(internal.programs, 8);
+        CHECK_EQ(stage.erases, 8);
+        CHECK_EQ(stage.programs, 8);
+        CHECK_EQ(internal.violations, 0);
+        CHECK_MEM(&internal_array[0x6000], image, 0x2000);
+    }
+}
+
+//a short last sector is padded with 0xFF, and nothing past it is touched
+static void test_tail(void)
+{
+    stage_t stage;
+
+    sim_reset(&internal);
+    fill_image(1);
+    STAGE_init(&stage, STAGE_INTERNAL);
+    CHECK(stream(&stage, 0x8000, 1500, 32));
+    CHECK_EQ(internal.programs, 1);
+    CHECK(STAGE_flush(&stage));
+    CHECK(STAGE_flush(&stage));
+
+    CHECK_EQ(internal.erases, 2);
+    CHECK_EQ(internal.programs, 2);
+    CHECK_MEM(&internal_array[0x8000], image, 1500);
+    CHECK(erased(&internal_array[0x8000 + 1500], 2048 - 1500));
+    CHECK_EQ(internal_array[0x8800], 0x00);
+    CHECK_EQ(internal.violations, 0);
+}
+
+//a skipped range inside a unit reads back erased
+static void test_gap(void)
+{
+    stage_t stage;
+
+    sim_reset(&internal);
+    fill_image(2);
+    STAGE_init(&stage, STAGE_INTERNAL);
+    CHECK(STAGE_write(&stage, 0x6000, image, 64));
+    CHECK(STAGE_write(&stage, 0x6100, &image[0x100], 64));
+    CHECK(STAGE_flush(&stage));
+
+    CHECK_EQ(internal.programs, 1);
+    CHECK_MEM(&internal_array[0x6000], image, 64);
+    CHECK(erased(&internal_array[0x6040], 0x100 - 0x40));
+    CHECK_MEM(&internal_array[0x6100], &image[0x100], 64);
+    CHECK_EQ(internal.violations, 0);
+}
+
+//SPI staging flash: 256 byte pages under 4 KB erase sectors
+static void test_ext(void)
+{
+    stage_t stage;
+
+    sim_reset(&ext);
+    fill_image(3);
+    STAGE_init(&stage, EXT_STAGING);
+    CHECK(stream(&stage, 0x1000, 0x2100, 32));
+    CHECK(STAGE_flush(&stage));
+
+    CHECK_EQ(ext.erases, 3);
+    CHECK_EQ(ext.programs, 0x21);
+    CHECK_EQ(ext.violations, 0);
+    CHECK_MEM(&ext_array[0x1000], image, 0x2100);
+    CHECK(erased(&ext_array[0x3100], 0x4000 - 0x3100));
+}
+
+//held vectors stay erased, so the image can't boot, until released; the
+//hold is a whole program unit of the target, and goes back as one
+static void test_hold(void)
+{
+    uint32_t units[] = {STAGE_INTERNAL, EXT_STAGING, EXT_USER};
+    flash_sim_t *sims[] = {&internal, &ext, &user};
+    uint32_t holds[] = {8, 8, 16};
+
+    for(uint32_t u = 0; u < 3; u++)
+    {
+        flash_sim_t *sim = sims[u];
+        uint32_t base = units[u] == STAGE_INTERNAL ? 0x8000 : 0x4000;
+        stage_t stage;
+
+        sim_reset(sim);
+        fill_image(4 + u);
+        STAGE_init(&stage, units[u]);
+        CHECK_EQ(stage.hold_size, holds[u]);
+        STAGE_hold(&stage, base);
+        CHECK(stream(&stage, base, 0x1800, 32));
+        CHECK(STAGE_flush(&stage));
+
+        CHECK(erased(&sim->array[base], stage.hold_size));
+        CHECK_MEM(&sim->array[base + stage.hold_size], &image[stage.hold_size], 0x1800 - stage.hold_size);
+        CHECK_MEM(stage.hold, image, stage.hold_size);
+
+        uint32_t programs = sim->programs;
+        CHECK(STAGE_release(&stage));
+        CHECK_EQ(sim->programs, programs + 1);
+        CHECK_MEM(&sim->array[base], image, 0x1800);
+        CHECK_EQ(sim->violations, 0);
+
+        //once only
+        CHECK(STAGE_release(&stage));
+        CHECK_EQ(sim->programs, programs + 1);
+    }
+}
+
+//release flushes a partial unit before the held vectors go in
+static void test_release_flushes(void)
+{
+    stage_t stage;
+
+    sim_reset(&internal);
+    fill_image(6);
+    STAGE_init(&stage, STAGE_INTERNAL);
+    STAGE_hold(&stage, 0x6000);
+    CHECK(stream(&stage, 0x6000, 600, 32));
+    CHECK_EQ(internal.programs, 0);
+    CHECK(STAGE_release(&stage));
+
+    CHECK_EQ(internal.programs, 2);
+    CHECK_MEM(&internal_array[0x6000], image, 600);
+    CHECK(erased(&internal_array[0x6000 + 600], 1024 - 600));
+    CHECK_EQ(internal.violations, 0);
+}
+
+//a failed flash command sticks until the stage is restarted
+static void test_error(void)
+{
+    stage_t stage;
+
+    sim_reset(&internal);
+    fill_image(7);
+    STAGE_init(&stage, STAGE_INTERNAL);
+    CHECK(stream(&stage, 0x6000, 1024, 32));
+    internal.fail = true;
+    CHECK(!stream(&stage, 0x6400, 1024, 32));
+    internal.fail = false;
+    CHECK(!STAGE_write(&stage, 0x6800, image, 32));
+    CHECK(!STAGE_flush(&stage));
+    CHECK(!STAGE_release(&stage));
+
+    STAGE_init(&stage, STAGE_INTERNAL);
+    CHECK(stream(&stage, 0x7000, 1024, 32));
+    CHECK(STAGE_flush(&stage));
+}
+
+int main(void)
+{
+    test_internal();
+    test_tail();
+    test_gap();
+    test_ext();
+    test_hold();
+    test_release_flushes();
+    test_error();
+    return CHECK_DONE("stage");
+}
@@ -0,0 +1,259 @@
+/*
+  test_staged.c - installing from the staging flash against straight from the modem
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "check.h"
+#include "board.h"
+#include "modem.h"
+#include "flash1.h"
+#include "nor.h"
+
+//the loaders and their statics; VERSION_* come from the build
+#include "../Sources/boot.c"
+
+#define IMAGE_MAX       (128 * 1024)
+#define IMAGE_SIZE      (64 * 1024)
+#define STAGED_AT       (0x10000)   //where the system application copies it
+#define LATENCY_US      (5000)      //command to response, file system included
+
+//what PERIPH_init brings up for the loaders, as periph.c and Events.c do
+static uint32_t periph_up;
+
+void lpuartUblox_RxCallback(uint32_t instance, void *lpuartState)
+{
+    lpuart_state_t *ptr = (lpuart_state_t *)lpuartState;
+    (void)instance;
+    RING_push(&ublox_ring, *(ptr->rxBuff));
+}
+
+void PERIPH_init(uint32_t units)
+{
+    if((units & PERIPH_UBLOX) && !(periph_up & PERIPH_UBLOX))
+    {
+        LPUART_DRV_Init(FSL_LPUARTUBLOX, &lpuartUblox_State, &lpuartUblox_InitConfig0);
+        LPUART_DRV_InstallRxCallback(FSL_LPUARTUBLOX, lpuartUblox_RxCallback, ublox_rx, NULL, true);
+    }
+    periph_up |= units;
+}
+
+void PERIPH_deinit(uint32_t units)
+{
+    periph_up &= ~units;
+}
+
+void NVIC_SystemReset(void)
+{
+    CHECK(false);
+}
+
+static uint8_t image[IMAGE_MAX];
+static uint8_t digest[SHA256_DIGEST_SIZE];
+
+static mock_modem_file_t files[] = {
+    { "system.bin", image, 0 },
+    { NULL },
+};
+
+//the modem stays up across the reset into the bootloader: the system
+//application was using it a moment before
+static const mock_modem_config_t modem = {
+    .boot_ms = 0,
+    .latency_us = LATENCY_US,
+    .seed = 1,
+    .files = files,
+};
+
+static void make_image(uint32_t size)
+{
+    uint32_t seed = 0x2545F491;
+
+    for(uint32_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+    files[0].size = size;
+    SHA256_init(&sha);
+    SHA256_update(&sha, image, size);
+    SHA256_final(&sha, digest);
+}
+
+//power on: the staging flash erased, the modem up
+static void setup(void)
+{
+    board_reset();
+    mock_gpio_reset();
+    GPIO_DRV_Init(gpio1_InpConfig0, gpio1_OutConfig0);
+    mock_lpuart_reset();
+    mock_flash_reset();
+    mock_spi_reset();
+    mock_modem_init(&modem);
+    mock_nor_init();
+
+    periph_up = 0;
+    RING_flush(&ublox_ring);
+    ublox_ring.throttled = false;
+    ublox_ring.overruns = 0;
+    ublox_ring.stalls = 0;
+    memset(&ublox_stats, 0, sizeof(ublox_stats));
+    ublox_stats.read_size = UBLOX_READ_SIZE;
+    clean_reads = 0;
+    ublox_flow = 0;
+    ublox_flow_out = false;
+    image_source = BOOT_FLAG_ERASED;
+}
+
+//the system application's copy into the staging flash, while it keeps
+//running: the same reads and staged writes the bootloader makes
+static bool copy(uint32_t size)
+{
+    stage_t staging;
+    uint32_t pos = 0;
+
+    EXT_init(EXT_STAGING);
+    BOOT_ublox_wait_ready();
+    STAGE_init(&staging, EXT_STAGING);
+    while(pos < size)
+    {
+        uint32_t len = BOOT_ReadChunk("system.bin", 0, pos, size - pos);
+        if(len == 0 || !STAGE_write(&staging, STAGED_AT + pos, pgm_buffer, len))
+            return false;
+        pos += len;
+    }
+    return STAGE_flush(&staging);
+}
+
+//BOOT_CheckFlag with image_source BOOT_SOURCE_EXTERNAL, from the reset:
+//the device is offline from here until the vectors are programmed
+static bool install_staged(uint32_t size)
+{
+    periph_up = 0;
+    image_source = BOOT_SOURCE_EXTERNAL;
+    EXT_init(EXT_STAGING);
+    return BOOT_LoadSystemFromUblox("system.bin", size, STAGED_AT, digest);
+}
+
+//and with the images on the modem
+static bool install_direct(uint32_t size)
+{
+    image_source = BOOT_FLAG_ERASED;
+    BOOT_ublox_wait_ready();
+    return BOOT_LoadSystemFromUblox("system.bin", size, 0, digest);
+}
+
+//the copy lands whole, one erase per sector and one program per page,
+//and installs from there without a word to the modem
+static void test_staged(void)
+{
+    uint32_t commands;
+
+    make_image(IMAGE_SIZE);
+    setup();
+    CHECK(copy(IMAGE_SIZE));
+    CHECK_MEM(&mock_nor[STAGED_AT], image, IMAGE_SIZE);
+    CHECK_EQ(mock_nor_erases, IMAGE_SIZE / EXT_SECTOR_SIZE);
+    CHECK_EQ(mock_nor_programs, IMAGE_SIZE / EXT_PAGE_SIZE);
+
+    commands = mock_modem_stats.commands;
+    CHECK(install_staged(IMAGE_SIZE));
+    CHECK_MEM(&mock_flash[SYSTEM_APP_ADDRESS], image, IMAGE_SIZE);
+    CHECK_EQ(mock_modem_stats.commands, commands);
+    CHECK_EQ(mock_nor_violations, 0);
+    CHECK_EQ(mock_flash_violations, 0);
+}
+
+//the digest catches a bad copy, and the vectors stay erased
+static void test_damaged(void)
+{
+    make_image(IMAGE_SIZE);
+    setup();
+    CHECK(copy(IMAGE_SIZE));
+    mock_nor[STAGED_AT + IMAGE_SIZE / 2] ^= 0x10;
+    CHECK(!install_staged(IMAGE_SIZE));
+    CHECK(BOOT_Erased(&mock_flash[SYSTEM_APP_ADDRESS], STAGE_VECTORS_SIZE));
+    CHECK_EQ(mock_nor_violations, 0);
+}
+
+//the part keeps its power on protection until EXT_init's unlock
+static void test_locked(void)
+{
+    static const spi_master_user_config_t bus = { .bitsPerSec = 12000000U };
+    spi_master_state_t state;
+    uint32_t baud;
+
+    setup();
+    SPI_DRV_MasterInit(EXT_STAGING, &state);
+    SPI_DRV_MasterConfigureBus(EXT_STAGING, &bus, &baud);
+    EXT_erase_sector(EXT_STAGING, STAGED_AT);
+    CHECK_EQ(mock_nor_erases, 0);
+    CHECK_EQ(mock_nor_violations, 1);
+
+    EXT_init(EXT_STAGING);
+    EXT_erase_sector(EXT_STAGING, STAGED_AT);
+    CHECK_EQ(mock_nor_erases, 1);
+    CHECK_EQ(mock_nor_violations, 1);
+}
+
+//the offline window for each way in: from the reset to the vectors,
+//next to the internal flash's own erase and program time, which no
+//source can beat, and the staged copy made while still online
+static void bench(void)
+{
+    static const uint32_t sizes[] = { 16 * 1024, 64 * 1024, IMAGE_MAX };
+
+    printf("staged       %6s %9s %9s %9s %9s\n", "KB", "direct", "staged", "flash", "copy");
+    for(uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        uint64_t start, direct, staged, online, floor;
+        bool ok;
+
+        make_image(sizes[i]);
+        setup();
+        ok = install_direct(sizes[i]);
+        direct = board_ns;
+
+        setup();
+        ok = copy(sizes[i]) && ok;
+        online = board_ns;
+        mock_flash_reset();
+        start = board_ns;
+        ok = install_staged(sizes[i]) && ok;
+        staged = board_ns - start;
+        floor = (mock_flash_erases * MOCK_FLASH_ERASE_US + mock_flash_programs * MOCK_FLASH_PROGRAM_US) * BOARD_US;
+
+        printf("staged       %6" PRIu32 " %7.2f s %7.2f s %7.2f s %7.2f s\n", sizes[i] / 1024,
+               direct / 1e9, staged / 1e9, floor / 1e9, online / 1e9);
+        CHECK(ok);
+        CHECK_MEM(&mock_flash[SYSTEM_APP_ADDRESS], image, sizes[i]);
+        //the SPI reads add little to the programming itself
+        CHECK(staged < floor + floor / 4);
+        CHECK(staged < direct / 4);
+    }
+}
+
+int main(void)
+{
+    test_staged();
+    test_damaged();
+    test_locked();
+    bench();
+    return CHECK_DONE("staged");
+}
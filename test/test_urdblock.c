@@ -0,0 +1,286 @@
+/*
+  test_urdblock.c - URDBLOCK loading from the modem emulator, with faults
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "check.h"
+#include "board.h"
+#include "modem.h"
+#include "flash1.h"
+
+//the loaders and their statics; VERSION_* come from the build
+#include "../Sources/boot.c"
+
+#define IMAGE_SIZE      (16 * 1024)
+#define ATTEMPTS        (3)         //resets BOOT_CheckFlag gets to retry in
+#define LATENCY_US      (5000)      //command to response, file system included
+
+//what PERIPH_init brings up for the loaders, as periph.c and Events.c do
+static uint32_t periph_up;
+
+void lpuartUblox_RxCallback(uint32_t instance, void *lpuartState)
+{
+    lpuart_state_t *ptr = (lpuart_state_t *)lpuartState;
+    (void)instance;
+    RING_push(&ublox_ring, *(ptr->rxBuff));
+}
+
+void PERIPH_init(uint32_t units)
+{
+    if((units & PERIPH_UBLOX) && !(periph_up & PERIPH_UBLOX))
+    {
+        LPUART_DRV_Init(FSL_LPUARTUBLOX, &lpuartUblox_State, &lpuartUblox_InitConfig0);
+        LPUART_DRV_InstallRxCallback(FSL_LPUARTUBLOX, lpuartUblox_RxCallback, ublox_rx, NULL, true);
+    }
+    periph_up |= units;
+}
+
+void PERIPH_deinit(uint32_t units)
+{
+    periph_up &= ~units;
+}
+
+void NVIC_SystemReset(void)
+{
+    CHECK(false);
+}
+
+static uint8_t image[IMAGE_SIZE];
+static uint8_t framed[(IMAGE_SIZE / BOOT_FRAME_PAYLOAD + 1) * BOOT_FRAME_SIZE];
+static uint32_t framed_size;
+static uint8_t digest[SHA256_DIGEST_SIZE];
+
+static mock_modem_file_t files[] = {
+    { "system.bin", image, sizeof(image) },
+    { "system.frm", framed, 0 },
+    { NULL },
+};
+
+static void make_image(void)
+{
+    uint32_t seed = 0x2545F491;
+
+    for(uint32_t i = 0; i < sizeof(image); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+    SHA256_init(&sha);
+    SHA256_update(&sha, image, sizeof(image));
+    SHA256_final(&sha, digest);
+
+    //<len:2 LE><payload><crc16:2 LE over len+payload>, as the packager lays it out
+    for(uint32_t pos = 0; pos < sizeof(image); pos += BOOT_FRAME_PAYLOAD)
+    {
+        uint8_t *frame = &framed[framed_size];
+        uint32_t len = MIN(BOOT_FRAME_PAYLOAD, sizeof(image) - pos);
+
+        frame[0] = len;
+        frame[1] = len >> 8;
+        memcpy(&frame[2], &image[pos], len);
+        uint16_t crc = CRC_crc16(CRC16_INIT, frame, len + 2);
+        frame[len + 2] = crc;
+        frame[len + 3] = crc >> 8;
+        framed_size += len + BOOT_FRAME_OVERHEAD;
+    }
+    files[1].size = framed_size;
+}
+
+static void setup(const mock_modem_config_t *modem)
+{
+    board_reset();
+    mock_gpio_reset();
+    mock_lpuart_reset();
+    mock_flash_reset();
+    mock_spi_reset();
+    mock_modem_init(modem);
+
+    periph_up = 0;
+    RING_flush(&ublox_ring);
+    ublox_ring.throttled = false;
+    ublox_ring.overruns = 0;
+    ublox_ring.stalls = 0;
+    memset(&ublox_stats, 0, sizeof(ublox_stats));
+    ublox_stats.read_size = UBLOX_READ_SIZE;
+    clean_reads = 0;
+    ublox_flow = 0;
+    ublox_flow_out = false;
+    image_source = BOOT_FLAG_ERASED;
+}
+
+typedef struct
+{
+    bool ok;
+    uint32_t attempts;
+    uint64_t ns;
+}load_t;
+
+//what BOOT_CheckFlag does for a system image, the reset after a failed
+//load included: the flag stays set, so the next boot starts over
+static load_t load(const mock_modem_config_t *modem, uint32_t mode)
+{
+    load_t result = { false, 0, 0 };
+
+    setup(modem);
+    transfer_mode = mode;
+    while(!result.ok && result.attempts < ATTEMPTS)
+    {
+        result.attempts++;
+        BOOT_ublox_wait_ready();
+        result.ok = BOOT_LoadSystemFromUblox(mode == BOOT_TRANSFER_FRAMED ? "system.frm" : "system.bin",
+                sizeof(image), 0, digest);
+        if(!result.ok)
+        {
+            //an image that didn't check out never gets its vectors
+            CHECK(BOOT_Erased(&mock_flash[SYSTEM_APP_ADDRESS], STAGE_VECTORS_SIZE));
+        }
+    }
+    result.ns = board_ns;
+    CHECK_EQ(mock_flash_violations, 0);
+    CHECK_EQ(mock_spi_bytes[EXT_STAGING], 0);
+    if(result.ok)
+        CHECK_MEM(&mock_flash[SYSTEM_APP_ADDRESS], image, sizeof(image));
+    return result;
+}
+
+static const mock_modem_config_t clean = {
+    .boot_ms = 100,
+    .latency_us = LATENCY_US,
+    .seed = 1,
+    .files = files,
+};
+
+//a clean link grows the reads to the largest size and keeps them there
+static void test_clean(void)
+{
+    load_t result = load(&clean, BOOT_FLAG_ERASED);
+
+    CHECK(result.ok);
+    CHECK_EQ(result.attempts, 1);
+    CHECK_EQ(ublox_stats.read_size, UBLOX_READ_MAX);
+    CHECK_EQ(ublox_stats.read_errors, 0);
+    CHECK_EQ(ublox_stats.failed_chunks, 0);
+    CHECK_EQ(mock_modem_stats.errors, 0);
+    CHECK_EQ(mock_lpuart_overruns, 0);
+    CHECK_EQ(ublox_ring.overruns, 0);
+    //32, 64, 128 and 256 byte reads four times each, then 512s
+    CHECK_EQ(ublox_stats.reads, 16 + (IMAGE_SIZE - 4 * (32 + 64 + 128 + 256) + UBLOX_READ_MAX - 1) / UBLOX_READ_MAX);
+}
+
+//one damaged reply halves the read size, which grows back on clean ones
+static void test_shrink(void)
+{
+    mock_modem_config_t modem = clean;
+
+    modem.drop_ppm = 300;
+    load_t result = load(&modem, BOOT_FLAG_ERASED);
+
+    CHECK(result.ok);
+    CHECK(mock_modem_stats.faults > 0);
+    CHECK(ublox_stats.read_errors > 0);
+    CHECK_EQ(ublox_stats.failed_chunks, 0);
+    CHECK(ublox_stats.reads > 16 + (IMAGE_SIZE - 4 * (32 + 64 + 128 + 256) + UBLOX_READ_MAX - 1) / UBLOX_READ_MAX);
+}
+
+//a reply withheld past every retry gives up the chunk, and the load,
+//without programming the vectors
+static void test_give_up(void)
+{
+    mock_modem_config_t modem = clean;
+
+    setup(&modem);
+    transfer_mode = BOOT_FLAG_ERASED;
+    BOOT_ublox_wait_ready();
+    modem.stall_ppm = 1000000;
+    modem.stall_ms = 20000;
+    CHECK(!BOOT_LoadSystemFromUblox("system.bin", sizeof(image), 0, digest));
+    CHECK_EQ(ublox_stats.failed_chunks, 1);
+    CHECK_EQ(ublox_stats.reads, UBLOX_READ_RETRIES);
+    CHECK_EQ(ublox_stats.read_errors, UBLOX_READ_RETRIES);
+    CHECK_EQ(ublox_stats.read_size, UBLOX_READ_SIZE);
+    CHECK(BOOT_Erased(&mock_flash[SYSTEM_APP_ADDRESS], FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE));
+}
+
+//throughput of the plain and framed reads as the line gets worse: image
+//bytes over the time from power on to the last attempt, resets included
+static void bench(void)
+{
+    static const struct
+    {
+        const char *fault;
+        uint32_t drop_ppm;
+        uint32_t garble_ppm;
+        uint32_t insert_ppm;
+        uint32_t stall_ppm;
+    }rows[] = {
+        { "none",           0,     0,     0,      0 },
+        { "drop",         100,     0,     0,      0 },
+        { "drop",        1000,     0,     0,      0 },
+        { "drop",       10000,     0,     0,      0 },
+        { "garbage",        0,   100,   100,      0 },
+        { "garbage",        0,  1000,  1000,      0 },
+        { "garbage",        0, 10000, 10000,      0 },
+        { "late OK",        0,     0,     0,  10000 },
+        { "late OK",        0,     0,     0, 100000 },
+    };
+
+    printf("urdblock     %-8s %6s  %-6s %8s %4s %6s %6s %5s\n",
+           "fault", "ppm", "mode", "B/s", "runs", "reads", "errors", "size");
+    for(uint32_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++)
+    {
+        mock_modem_config_t modem = clean;
+        uint32_t ppm = rows[i].drop_ppm + rows[i].garble_ppm + rows[i].insert_ppm + rows[i].stall_ppm;
+
+        modem.drop_ppm = rows[i].drop_ppm;
+        modem.garble_ppm = rows[i].garble_ppm;
+        modem.insert_ppm = rows[i].insert_ppm;
+        modem.stall_ppm = rows[i].stall_ppm;
+        modem.stall_ms = 2000;
+        for(uint32_t framing = 0; framing < 2; framing++)
+        {
+            load_t result = load(&modem, framing ? BOOT_TRANSFER_FRAMED : BOOT_FLAG_ERASED);
+            char rate[16];
+
+            if(result.ok)
+                snprintf(rate, sizeof(rate), "%8.0f", IMAGE_SIZE * 1e9 / result.ns);
+            else
+                snprintf(rate, sizeof(rate), "%8s", "failed");
+            printf("urdblock     %-8s %6" PRIu32 "  %-6s %s %4" PRIu32 " %6" PRIu32 " %6" PRIu32 " %5" PRIu32 "\n",
+                   rows[i].fault, ppm, framing ? "framed" : "plain", rate, result.attempts,
+                   ublox_stats.reads, ublox_stats.read_errors, framing ? BOOT_FRAME_PAYLOAD : ublox_stats.read_size);
+
+            //up to one fault in a thousand bytes every load completes,
+            //but for plain reads of a garbled line: they can't see a bad
+            //payload byte, only the image digest can, and fail the load
+            if(ppm <= 1000 && (rows[i].garble_ppm == 0 || framing))
+                CHECK(result.ok);
+        }
+    }
+}
+
+int main(void)
+{
+    make_image();
+    test_clean();
+    test_shrink();
+    test_give_up();
+    bench();
+    return CHECK_DONE("urdblock");
+}
@@ -0,0 +1,354 @@
+/*
+  trace_replay.c - decode and replay a BOOT_TRACE capture on the host
+
+  https://hologram.io
+
+  Copyright (c) 2016 Konekt, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+//Reads the trace_t returned by I2C command 0x06 (READ_TRACE), or a
+//logic-analyzer export of "time_us,channel,data" lines, and
+//  - prints the timeline (-l)
+//  - writes each channel's byte stream to <prefix>_<channel>.bin (-x)
+//  - replays the modem's bytes into the bootloader's ring (ring.c, with
+//    ublox_ring's size and watermarks) at their captured times, drained
+//    at a modelled rate, and reports fill, XOFF stalls and overruns.
+//
+//The bytes are pushed when the modem actually sent them, so a capture
+//already throttled on the target replays as throttled; the replay shows
+//what the ring does with that traffic under a different drain rate.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "ring.h"
+
+#define REPLAY_RING_SIZE    (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE*2)
+#define REPLAY_RING_HIGH    (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE*3/2)
+#define REPLAY_RING_LOW     (FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE/2)
+#define XON                 (0x11)
+#define XOFF                (0x13)
+
+typedef struct
+{
+    uint64_t us;
+    uint8_t  channel;
+    uint8_t  data;
+}event_t;
+
+static uint64_t now_us;
+
+static event_t *events;
+static uint32_t event_count;
+
+uint32_t OSA_TimeGetMsec(void)
+{
+    return (uint32_t)(now_us / 1000);
+}
+
+static const char *channel_name(uint8_t channel)
+{
+    switch(channel)
+    {
+    case TRACE_UART_RX:     return "uart_rx";
+    case TRACE_UART_TX:     return "uart_tx";
+    case TRACE_I2C_RX:      return "i2c_rx";
+    case TRACE_I2C_TX:      return "i2c_tx";
+    case TRACE_I2C_EVENT:   return "i2c_event";
+    case TRACE_BOOT:        return "boot";
+    default:                return NULL;
+    }
+}
+
+static int channel_parse(const char *name)
+{
+    for(int channel = 0; channel < 0x100; channel++)
+    {
+        const char *known = channel_name(channel);
+        if(known && strcmp(known, name) == 0)
+            return channel;
+    }
+    return (int)strtol(name, NULL, 0);
+}
+
+static void event_add(uint64_t us, uint8_t channel, uint8_t data)
+{
+    static uint32_t capacity;
+
+    if(event_count == capacity)
+    {
+        capacity = capacity ? capacity * 2 : 4096;
+        events = realloc(events, capacity * sizeof(event_t));
+        if(!events)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    events[event_count].us = us;
+    events[event_count].channel = channel;
+    events[event_count].data = data;
+    event_count++;
+}
+
+//the ring's oldest record is at head once it has wrapped
+static bool load_trace(const trace_t *trace)
+{
+    uint32_t first = 0;
+    uint32_t records = trace->count;
+    uint64_t us = 0;
+
+    if(trace->magic != TRACE_MAGIC || trace->head >= TRACE_RECORDS)
+        return false;
+    if(records >= TRACE_RECORDS)
+    {
+        first = trace->head;
+        records = TRACE_RECORDS;
+    }
+
+    for(uint32_t i = 0; i < records; i++)
+    {
+        const trace_record_t *record = &trace->record[(first + i) % TRACE_RECORDS];
+
+        if(record->channel == TRACE_GAP)
+        {
+            us += (uint64_t)record->dt << 16;
+            continue;
+        }
+        us += record->dt;
+        event_add(us, record->channel, record->data);
+    }
+    if(trace->count > TRACE_RECORDS)
+        fprintf(stderr, "%u records lost to the ring, replay starts mid-capture\n",
+                trace->count - TRACE_RECORDS);
+    return true;
+}
+
+static bool load_csv(FILE *file)
+{
+    char line[128];
+    char name[32];
+    unsigned long long us;
+    unsigned int data;
+
+    while(fgets(line, sizeof(line), file))
+    {
+        if(line[0] == '#' || line[0] == '\n')
+            continue;
+        if(sscanf(line, "%llu , %31[^,] , %i", &us, name, &data) != 3)
+        {
+            fprintf(stderr, "bad line: %s", line);
+            return false;
+        }
+        event_add(us, (uint8_t)channel_parse(name), (uint8_t)data);
+    }
+    return true;
+}
+
+static bool load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    static trace_t trace;
+    bool loaded;
+
+    if(!file)
+    {
+        perror(path);
+        return false;
+    }
+    if(fread(&trace, 1, sizeof(trace), file) == sizeof(trace) && trace.magic == TRACE_MAGIC)
+    {
+        loaded = load_trace(&trace);
+    }
+    else
+    {
+        rewind(file);
+        loaded = load_csv(file);
+    }
+    fclose(file);
+    return loaded;
+}
+
+static void list(void)
+{
+    for(uint32_t i = 0; i < event_count; i++)
+    {
+        const char *name = channel_name(events[i].channel);
+
+        if(name)
+            printf("%12llu %-9s 0x%02X\n", (unsigned long long)events[i].us, name, events[i].data);
+        else
+            printf("%12llu 0x%02X      0x%02X\n", (unsigned long long)events[i].us, events[i].channel, events[i].data);
+    }
+}
+
+static bool extract(const char *prefix)
+{
+    FILE *files[0x100] = {0};
+    char path[256];
+
+    for(uint32_t i = 0; i < event_count; i++)
+    {
+        uint8_t channel = events[i].channel;
+
+        if(!channel_name(channel) || channel == TRACE_BOOT)
+            continue;
+        if(!files[channel])
+        {
+            snprintf(path, sizeof(path), "%s_%s.bin", prefix, channel_name(channel));
+            files[channel] = fopen(path, "wb");
+            if(!files[channel])
+            {
+                perror(path);
+                return false;
+            }
+        }
+        fputc(events[i].data, files[channel]);
+    }
+    for(int channel = 0; channel < 0x100; channel++)
+    {
+        if(files[channel])
+            fclose(files[channel]);
+    }
+    return true;
+}
+
+static uint32_t replay_xoffs;
+
+static void replay_throttle(bool stop)
+{
+    if(stop)
+        replay_xoffs++;
+}
+
+//rate in bytes per ms, 0 drains everything each ms; every sector drained
+//then holds the consumer for sector_us, like an erase and program
+static void replay(uint32_t rate, uint32_t sector_us)
+{
+    static uint8_t storage[REPLAY_RING_SIZE];
+    uint8_t *buffer = storage;
+    ring_t ring;
+    uint32_t next = 0;
+    uint32_t peak = 0;
+    uint32_t bytes = 0;
+    uint32_t drained = 0;
+    uint32_t captured_xoffs = 0;
+    uint64_t first_us = 0;
+    uint64_t last_us = 0;
+    uint64_t busy_until = 0;
+
+    RING_init(&ring, &buffer, sizeof(storage));
+    ring.high = REPLAY_RING_HIGH;
+    ring.low = REPLAY_RING_LOW;
+    ring.throttle = replay_throttle;
+
+    for(uint32_t i = 0; i < event_count; i++)
+    {
+        if(events[i].channel == TRACE_UART_TX && events[i].data == XOFF)
+            captured_xoffs++;
+    }
+
+    //1 ms steps of the bootloader's timebase
+    for(now_us = 0; next < event_count || RING_available(&ring); now_us += 1000)
+    {
+        while(next < event_count && events[next].us <= now_us)
+        {
+            if(events[next].channel == TRACE_UART_RX)
+            {
+                if(!bytes)
+                    first_us = events[next].us;
+                last_us = events[next].us;
+                bytes++;
+                RING_push(&ring, events[next].data);
+            }
+            next++;
+        }
+        if(RING_available(&ring) > peak)
+            peak = RING_available(&ring);
+
+        if(now_us < busy_until)
+            continue;
+        for(uint32_t n = 0; (rate == 0 || n < rate) && RING_pop(&ring) >= 0; n++)
+        {
+            if(sector_us && ++drained % FSL_FEATURE_FLASH_PFLASH_BLOCK_SECTOR_SIZE == 0)
+            {
+                busy_until = now_us + sector_us;
+                break;
+            }
+        }
+    }
+
+    printf("modem bytes     %u in %.3f s", bytes, (last_us - first_us) / 1e6);
+    if(last_us > first_us)
+        printf(", %.1f kB/s captured", bytes * 1000.0 / (last_us - first_us));
+    printf("\nreplay drained  %.3f s\n", now_us / 1e6);
+    printf("ring peak       %u of %u\n", peak, (uint32_t)sizeof(storage) - 1);
+    printf("XOFF            %u replayed, %u captured\n", replay_xoffs, captured_xoffs);
+    printf("overruns        %u\n", ring.overruns);
+}
+
+static void usage(const char *self)
+{
+    fprintf(stderr,
+        "usage: %s [-l] [-x prefix] [-r bytes_per_ms] [-s sector_us] capture\n"
+        "  capture    raw READ_TRACE reply, or time_us,channel,data lines\n"
+        "  -l         print the decoded timeline\n"
+        "  -x prefix  write each channel to prefix_<channel>.bin\n"
+        "  -r rate    drain the ring at this many bytes per ms (default all)\n"
+        "  -s us      hold the drain this long after each 1 KB sector\n",
+        self);
+}
+
+int main(int argc, char **argv)
+{
+    bool listing = false;
+    const char *prefix = NULL;
+    uint32_t rate = 0;
+    uint32_t sector_us = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "lx:r:s:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'l': listing = true; break;
+        case 'x': prefix = optarg; break;
+        case 'r': rate = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 's': sector_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if(optind != argc - 1)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if(!load(argv[optind]))
+        return 1;
+    if(listing)
+        list();
+    if(prefix && !extract(prefix))
+        return 1;
+    replay(rate, sector_us);
+    return 0;
+}